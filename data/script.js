@@ -4,6 +4,11 @@ var websocket;
 var gaugeTemp = null;
 var gaugeHumi = null;
 
+// Binary MessagePack subprotocol, text JSON stays as the fallback
+const WS_PROTO_MSGPACK = "iot.msgpack";
+var useMsgPack = localStorage.getItem('wsProto') !== 'json';
+var msgPackFailures = 0;
+
 window.addEventListener('load', onLoad);
 
 function onLoad(event) {
@@ -11,25 +16,143 @@ function onLoad(event) {
 }
 
 function onOpen(event) {
-    console.log('Connection opened');
+    msgPackFailures = 0;
+    console.log('Connection opened (' + (websocket.protocol || 'json') + ')');
 }
 
 function onClose(event) {
     console.log('Connection closed');
+    // Give up on binary mode if it never manages to open
+    if (useMsgPack && websocket.protocol !== WS_PROTO_MSGPACK && ++msgPackFailures >= 2) {
+        console.warn("⚠️ MessagePack không khả dụng, chuyển về JSON");
+        useMsgPack = false;
+    }
     setTimeout(initWebSocket, 2000);
 }
 
 function initWebSocket() {
     console.log('Trying to open a WebSocket connection…');
-    websocket = new WebSocket(gateway);
+    websocket = useMsgPack ? new WebSocket(gateway, [WS_PROTO_MSGPACK]) : new WebSocket(gateway);
+    websocket.binaryType = 'arraybuffer';
     websocket.onopen = onOpen;
     websocket.onclose = onClose;
     websocket.onmessage = onMessage;
 }
 
+// ==================== MESSAGEPACK ====================
+// Minimal codec for the subset the firmware emits (ArduinoJson MsgPack)
+function msgpackDecode(buffer) {
+    const view = new DataView(buffer);
+    const utf8 = new TextDecoder();
+    let pos = 0;
+
+    function str(len) {
+        const s = utf8.decode(new Uint8Array(buffer, pos, len));
+        pos += len;
+        return s;
+    }
+    function map(len) {
+        const obj = {};
+        for (let i = 0; i < len; i++) {
+            const key = read();
+            obj[key] = read();
+        }
+        return obj;
+    }
+    function arr(len) {
+        const out = [];
+        for (let i = 0; i < len; i++) out.push(read());
+        return out;
+    }
+    function read() {
+        const b = view.getUint8(pos++);
+        let v;
+        if (b <= 0x7f) return b;
+        if (b >= 0xe0) return b - 0x100;
+        if ((b & 0xe0) === 0xa0) return str(b & 0x1f);
+        if ((b & 0xf0) === 0x80) return map(b & 0x0f);
+        if ((b & 0xf0) === 0x90) return arr(b & 0x0f);
+        switch (b) {
+            case 0xc0: return null;
+            case 0xc2: return false;
+            case 0xc3: return true;
+            case 0xca: v = view.getFloat32(pos); pos += 4; return v;
+            case 0xcb: v = view.getFloat64(pos); pos += 8; return v;
+            case 0xcc: return view.getUint8(pos++);
+            case 0xcd: v = view.getUint16(pos); pos += 2; return v;
+            case 0xce: v = view.getUint32(pos); pos += 4; return v;
+            case 0xd0: return view.getInt8(pos++);
+            case 0xd1: v = view.getInt16(pos); pos += 2; return v;
+            case 0xd2: v = view.getInt32(pos); pos += 4; return v;
+            case 0xd9: return str(view.getUint8(pos++));
+            case 0xda: v = view.getUint16(pos); pos += 2; return str(v);
+            case 0xdb: v = view.getUint32(pos); pos += 4; return str(v);
+            case 0xdc: v = view.getUint16(pos); pos += 2; return arr(v);
+            case 0xdd: v = view.getUint32(pos); pos += 4; return arr(v);
+            case 0xde: v = view.getUint16(pos); pos += 2; return map(v);
+            case 0xdf: v = view.getUint32(pos); pos += 4; return map(v);
+        }
+        throw new Error("Unsupported MessagePack type 0x" + b.toString(16));
+    }
+    return read();
+}
+
+function msgpackEncode(value) {
+    const bytes = [];
+    const utf8 = new TextEncoder();
+
+    function write(v) {
+        if (v === null || v === undefined) {
+            bytes.push(0xc0);
+        } else if (typeof v === 'boolean') {
+            bytes.push(v ? 0xc3 : 0xc2);
+        } else if (typeof v === 'number' && Number.isInteger(v) && v >= -32 && v <= 0x7fff) {
+            if (v >= 0 && v <= 0x7f) bytes.push(v);
+            else if (v < 0) bytes.push(v & 0xff);
+            else bytes.push(0xcd, v >> 8, v & 0xff);
+        } else if (typeof v === 'number') {
+            const b = new DataView(new ArrayBuffer(8));
+            b.setFloat64(0, v);
+            bytes.push(0xcb);
+            for (let i = 0; i < 8; i++) bytes.push(b.getUint8(i));
+        } else if (typeof v === 'string') {
+            const s = utf8.encode(v);
+            if (s.length < 32) bytes.push(0xa0 | s.length);
+            else if (s.length <= 0xff) bytes.push(0xd9, s.length);
+            else if (s.length <= 0xffff) bytes.push(0xda, s.length >> 8, s.length & 0xff);
+            else { bytes.push(0xdb); length32(s.length); }
+            s.forEach(c => bytes.push(c));
+        } else if (Array.isArray(v)) {
+            header(v.length, 0x90, 0xdc);
+            v.forEach(write);
+        } else {
+            const keys = Object.keys(v);
+            header(keys.length, 0x80, 0xde);
+            keys.forEach(k => { write(k); write(v[k]); });
+        }
+    }
+
+    // fixarray/fixmap up to 15 entries, then the 16 and 32 bit length forms
+    function header(n, fix, type16) {
+        if (n < 16) bytes.push(fix | n);
+        else if (n <= 0xffff) bytes.push(type16, n >> 8, n & 0xff);
+        else { bytes.push(type16 + 1); length32(n); }
+    }
+
+    function length32(n) {
+        bytes.push((n >>> 24) & 0xff, (n >>> 16) & 0xff, (n >>> 8) & 0xff, n & 0xff);
+    }
+    write(value);
+    return new Uint8Array(bytes);
+}
+
 function Send_Data(data) {
     if (websocket && websocket.readyState === WebSocket.OPEN) {
-        websocket.send(data);
+        if (websocket.protocol === WS_PROTO_MSGPACK) {
+            websocket.send(msgpackEncode(JSON.parse(data)));
+        } else {
+            websocket.send(data);
+        }
         console.log("📤 Gửi:", data);
     } else {
         console.warn("⚠️ WebSocket chưa sẵn sàng!");
@@ -40,7 +163,9 @@ function Send_Data(data) {
 function onMessage(event) {
     console.log("📩 Nhận:", event.data);
     try {
-        var data = JSON.parse(event.data);
+        var data = (event.data instanceof ArrayBuffer)
+            ? msgpackDecode(event.data)
+            : JSON.parse(event.data);
         var page = data.page;
         var value = data.value;
 
@@ -4,10 +4,99 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include "global.h"
-#include <PubSubClient.h>
-#include <ArduinoJson.h>
+#include "task_check_info.h"
+#include <ThingsBoard.h>
+#ifdef COREIOT_ARDUINO_MQTT
+#include <Arduino_MQTT_Client.h>
+#else
+#include <Espressif_MQTT_Client.h>
+#endif
 
+// The one CoreIOT (ThingsBoard) session: coreiot_task owns the MQTT client,
+// its buffer and the reconnects. Telemetry, attributes, RPC and provisioning
+// go through the coreiot_* calls below over that session; coreiot_task itself
+// subscribes for firmware updates (COREIOT_FW_TITLE).
+//
+// MQTT backend: esp-mqtt by default, socket I/O and the outbox run on its own
+// task; received messages are queued and handed to ThingsBoard by tb.loop() in
+// coreiot_task, so RPC, attribute and OTA callbacks run there on both backends.
+// -DCOREIOT_ARDUINO_MQTT uses the blocking WiFiClient + PubSubClient backend,
+// which adds MQTT 5 topic aliases and payloads written without a buffer copy.
+#define COREIOT_DEFAULT_SERVER "app.coreiot.io"
+#define COREIOT_DEFAULT_PORT 1883
+#define COREIOT_MAX_MESSAGE_SIZE 1024
+#define COREIOT_RECEIVE_QUEUE_SIZE (6 * COREIOT_MAX_MESSAGE_SIZE) // esp-mqtt: messages waiting for tb.loop(), OTA requests 4 chunks at once
+
+// Token used while none is stored from the settings page, e.g.
+// -DCOREIOT_DEFAULT_TOKEN='"abc"'. Building with -DCOREIOT_PROVISION_KEY and
+// -DCOREIOT_PROVISION_SECRET (device profile provisioning credentials) makes a
+// unit without a stored token provision itself instead: it logs in as
+// "provision", and the token it gets back is stored with Save_info_File.
+#ifndef COREIOT_DEFAULT_TOKEN
+#define COREIOT_DEFAULT_TOKEN "drx8pb6mjnq99pacxaez"
+#endif
+// Firmware this build reports to CoreIOT. coreiot_task installs packages
+// assigned with the same title and another version, full images and
+// tools/delta_patch.py patches alike, e.g. -DCOREIOT_FW_VERSION='"1.1.0"'
+#ifndef COREIOT_FW_TITLE
+#define COREIOT_FW_TITLE "yolo_uno"
+#endif
+#ifndef COREIOT_FW_VERSION
+#define COREIOT_FW_VERSION "1.0.0"
+#endif
+#define COREIOT_FW_RESTART_DELAY_MS 1000 // Lets the UPDATED state go out before the reboot
+
+#define COREIOT_TELEMETRY_INTERVAL_MS 1000
+#define COREIOT_RETRY_MS 5000
+#define COREIOT_LOCK_TIMEOUT_MS 100 // coreiot_* calls give up while a connect holds the session
+#define COREIOT_STATS_PERIOD_MS 60000
+#define COREIOT_MQTT_TASK_PRIORITY 5
+#define COREIOT_MQTT_TASK_STACK 6144
+
+// client.loop() interval. Under POWER_SAVE_ENABLE the task runs on the shared
+// power_waitNextPeriod() grid instead, so it wakes with the sensor task; the
+// PubSubClient backend can only see RPCs and PUBACKs by polling its socket,
+// so without power save the shorter interval keeps RPC latency low
+#define COREIOT_POLL_MS 100
+
+// Telemetry is QoS 1: samples published during a TCP stall are resent after
+// the reconnect instead of being lost. PubSubClient keeps them in this window,
+// esp-mqtt in its outbox until they expire (CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS).
+#define COREIOT_INFLIGHT_WINDOW 4
+
+// Low-bandwidth uplink: -DCOREIOT_MQTT5 lets repeated topics go out as MQTT 5
+// topic aliases (PubSubClient backend), -DCOREIOT_SHORT_TOPICS sends the
+// periodic telemetry on ThingsBoard's v2 short topic
+#ifdef COREIOT_SHORT_TOPICS
+#define COREIOT_TELEMETRY_TOPIC "v2/t"
+#else
+#define COREIOT_TELEMETRY_TOPIC "v1/devices/me/telemetry"
+#endif
+
+typedef struct
+{
+  uint32_t publishes;
+  uint32_t publishAvgUs; // Time the calling task spends in one coreiot_send*
+  uint32_t publishMaxUs;
+  uint32_t loopUs;       // Time spent in the client loop during the last period
+  uint32_t periodMs;
+} CoreIotStats_t;
 
 void coreiot_task(void *pvParameters);
 
-#endif
\ No newline at end of file
+// Safe from any task, and from RPC, attribute and OTA callbacks (they run in
+// coreiot_task, which already holds the session). They return false while the
+// session is down or busy connecting; nothing is queued on this side.
+bool coreiot_connected();
+bool coreiot_sendTelemetry(float temperature, float humidity);
+bool coreiot_sendTelemetry(const Telemetry *data, size_t count);
+bool coreiot_sendAttributes(const Attribute *data, size_t count);
+bool coreiot_subscribeSharedAttributes(const Shared_Attribute_Callback &callback);
+
+// Only answered while the session is logged in as "provision" (see
+// COREIOT_PROVISION_KEY); the callback gets the credentials
+bool coreiot_requestProvision(const Provision_Callback &callback);
+
+void getCoreIotStats(CoreIotStats_t *stats);
+
+#endif
@@ -5,6 +5,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include <vector>
 
 // Shared data structure for sensor readings
@@ -30,10 +31,35 @@ typedef struct
     boolean neoOverride;
     boolean relayOverride;
 
-    SemaphoreHandle_t xBinarySemaphoreInternet;
+    // Bumped by Save_info_File when the group changes; network tasks compare
+    // against the value they last applied and reconfigure in place
+    uint32_t wifiConfigVersion;
+    uint32_t brokerConfigVersion;
+
     SemaphoreHandle_t mutex; // Mutex for protecting WiFi data
 } WifiConfig_t;
 
+// Startup dependencies: each task waits only for the bits it needs instead of
+// a fixed delay. bootMilestone() sets a bit and logs its esp_timer time.
+#define BOOT_FS_READY BIT0         // LittleFS mounted, config loaded
+#define BOOT_NET_READY BIT1        // WiFi mode set, TCP/IP stack usable (AP or STA)
+#define BOOT_WIFI_UP BIT2          // STA associated with an IP
+#define BOOT_I2C_READY BIT3        // Wire started on the sensor pins
+#define BOOT_SENSOR_PRIMED BIT4    // First reading in g_sensorData
+#define BOOT_FIRST_TELEMETRY BIT5  // First telemetry published
+#define BOOT_WEB_READY BIT6        // AsyncWebServer listening
+
+extern EventGroupHandle_t g_bootEvents;
+
+// Connectivity state, published by the network supervisor (task_network.cpp)
+// and the MQTT task; other tasks wait on these instead of polling WiFi
+#define NET_STA_CONNECTED BIT0  // STA has an IP
+#define NET_AP_ACTIVE BIT1      // Provisioning AP is up
+#define NET_WEB_RUNNING BIT2    // AsyncWebServer listening
+#define NET_MQTT_CONNECTED BIT3 // CoreIOT session up
+
+extern EventGroupHandle_t g_netEvents;
+
 // Global pointer to shared sensor data (initialized in setup)
 extern SensorData_t *g_sensorData;
 extern WifiConfig_t *g_wifiConfig;
@@ -43,5 +69,7 @@ extern std::vector<int> g_userPins;
 void initSharedData();
 void setSensorData(float temp, float humi);
 void getSensorData(float *temp, float *humi);
+void bootMilestone(EventBits_t bit, const char *name);
+EventBits_t waitBootEvents(EventBits_t bits);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef __POWER_MANAGER_H__
+#define __POWER_MANAGER_H__
+
+#include <Arduino.h>
+#include "global.h"
+
+// -DPOWER_SAVE_ENABLE: dynamic frequency scaling, automatic light sleep when
+// the SDK is built with tickless idle, and WiFi max modem sleep. Periodic
+// tasks share one aligned period either way, so they wake together.
+#define POWER_PERIOD_MS 1000
+#define POWER_MAX_FREQ_MHZ 240
+#define POWER_MIN_FREQ_MHZ 40 // XTAL
+
+typedef struct
+{
+    float idlePercent[portNUM_PROCESSORS]; // Share of ticks spent in the idle task
+    float wakeupsPerSec;                   // Idle-loop re-entries, both cores
+    bool lightSleep;                       // Automatic light sleep accepted by esp_pm
+} PowerStats_t;
+
+void power_init();
+
+// vTaskDelayUntil() onto the shared POWER_PERIOD_MS grid. Start with
+// *lastWake = 0; the first call snaps it to the grid.
+void power_waitNextPeriod(TickType_t *lastWake);
+
+// Counters since the previous call (call at a steady interval)
+void getPowerStats(PowerStats_t *stats);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef __SENSOR_HISTORY_H__
+#define __SENSOR_HISTORY_H__
+
+#include <Arduino.h>
+#include "global.h"
+
+// RAM ring of raw sensor samples, oldest overwritten first. 24 h at 1 Hz when
+// PSRAM is available, otherwise the last HISTORY_INTERNAL_SAMPLES readings.
+#define HISTORY_PSRAM_SAMPLES 86400
+#ifndef HISTORY_INTERNAL_SAMPLES
+#define HISTORY_INTERNAL_SAMPLES 2048
+#endif
+
+// Upper bound on buckets per /api/history request
+#define HISTORY_MAX_BUCKETS 86400
+
+// One downsampled bucket; count == 0 means no samples fell into it
+typedef struct
+{
+    uint32_t start; // Bucket start time (seconds)
+    uint32_t count;
+    float tempMin;
+    float tempMax;
+    float tempAvg;
+    float humiMin;
+    float humiMax;
+    float humiAvg;
+} HistoryBucket_t;
+
+void history_init();
+
+// Timestamps are Unix seconds. Until SNTP has set the clock time(NULL) only
+// counts from boot, so history_append() (and the ts_store caller) drop samples
+// rather than store times that overlap the previous boot's
+#define HISTORY_MIN_VALID_TIME 1704067200 // 2024-01-01
+bool history_timeValid();
+uint32_t history_now();
+void history_append(float temp, float humi);
+
+// Aggregate all samples in [from, to) into *bucket
+bool history_aggregate(uint32_t from, uint32_t to, HistoryBucket_t *bucket);
+
+// Oldest stored sample time and number of samples held
+void history_range(uint32_t *oldest, uint32_t *count);
+
+#endif
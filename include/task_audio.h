@@ -0,0 +1,50 @@
+#ifndef __TASK_AUDIO_H__
+#define __TASK_AUDIO_H__
+
+#include <Arduino.h>
+#include "global.h"
+
+// I2S microphone wiring (INMP441 / SPH0645 style, left channel)
+#ifndef AUDIO_I2S_PORT
+#define AUDIO_I2S_PORT I2S_NUM_0
+#endif
+#ifndef AUDIO_I2S_BCLK_PIN
+#define AUDIO_I2S_BCLK_PIN 4
+#endif
+#ifndef AUDIO_I2S_WS_PIN
+#define AUDIO_I2S_WS_PIN 5
+#endif
+#ifndef AUDIO_I2S_DATA_PIN
+#define AUDIO_I2S_DATA_PIN 6
+#endif
+
+// Frontend parameters (match the TFLM micro_speech defaults)
+#define AUDIO_SAMPLE_RATE 16000
+#define AUDIO_WINDOW_MS 30
+#define AUDIO_STEP_MS 20
+#define AUDIO_FEATURE_SIZE 40  // Filterbank channels per slice
+#define AUDIO_FEATURE_COUNT 49 // Slices per model window (~1 s)
+#define AUDIO_FRAME_SAMPLES (AUDIO_SAMPLE_RATE * AUDIO_STEP_MS / 1000)
+
+// Pipeline counters, readable from any task
+typedef struct
+{
+    uint32_t framesCaptured;
+    uint32_t framesDropped;
+    uint32_t slicesGenerated;
+    uint32_t windowsInvoked;
+    uint32_t lastProcessUs; // Frontend time for the last frame
+} AudioStats_t;
+
+// Called with a full spectrogram window (AUDIO_FEATURE_COUNT x AUDIO_FEATURE_SIZE,
+// oldest slice first) every time a new slice arrives. Weak default only logs;
+// override it to run an anomaly model on the features.
+void audio_model_invoke(const int8_t *features, size_t length);
+
+void getAudioStats(AudioStats_t *stats);
+
+// Capture task reads I2S into the frame pool, feature task runs the frontend
+void audio_capture_task(void *pvParameters);
+void audio_feature_task(void *pvParameters);
+
+#endif
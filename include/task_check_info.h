@@ -6,10 +6,49 @@
 #include "global.h"
 #include "task_wifi.h"
 
+// Binary config record: ConfigHeader_t followed by TLV fields
+// (type u8, length u8, value). Unknown types are skipped on load, so new
+// fields only need a new type id; CONFIG_VERSION changes on layout breaks.
+#define CONFIG_FILE "/config.bin"
+#define CONFIG_BACKUP_FILE "/config.bak" // Previous commit, used if CONFIG_FILE is missing or bad
+#define CONFIG_TEMP_FILE "/config.tmp"
+#define CONFIG_LEGACY_FILE "/info.dat"   // Old JSON config, migrated once
+#define CONFIG_MAGIC 0x47464349          // "ICFG"
+#define CONFIG_VERSION 1
+#define CONFIG_FIELD_MAX 128 // Longer values are refused, not truncated
+// Header, the four text fields at their longest and the port
+#define CONFIG_MAX_SIZE (sizeof(ConfigHeader_t) + 4 * (2 + CONFIG_FIELD_MAX) + 2 + 2)
+
+enum ConfigField_t
+{
+  CFG_WIFI_SSID = 1,
+  CFG_WIFI_PASS = 2,
+  CFG_CORE_IOT_TOKEN = 3,
+  CFG_CORE_IOT_SERVER = 4,
+  CFG_CORE_IOT_PORT = 5, // u16 little endian
+};
+
+typedef struct __attribute__((packed))
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t length; // TLV bytes after the header
+  uint32_t crc;    // CRC32 of the TLV bytes
+} ConfigHeader_t;
+
+// Save_info_File result: which groups of settings actually changed
+#define CONFIG_CHANGED_WIFI 0x01
+#define CONFIG_CHANGED_BROKER 0x02
 
 bool check_info_File(bool check);
 void Load_info_File();
 void Delete_info_File();
-void Save_info_File(String WIFI_SSID, String WIFI_PASS, String CORE_IOT_TOKEN, String CORE_IOT_SERVER, String CORE_IOT_PORT);
+uint8_t Save_info_File(String WIFI_SSID, String WIFI_PASS, String CORE_IOT_TOKEN, String CORE_IOT_SERVER, String CORE_IOT_PORT);
+
+// Hot reload: start reconfiguring the changed groups (drops the STA link for
+// CONFIG_CHANGED_WIFI; MQTT clients pick up brokerConfigVersion themselves).
+// The task that restores a group calls Config_reloadDone to log the downtime.
+void Apply_info_Changes(uint8_t changed);
+void Config_reloadDone(uint8_t group);
 
-#endif
\ No newline at end of file
+#endif
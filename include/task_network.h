@@ -0,0 +1,22 @@
+#ifndef __TASK_NETWORK_H__
+#define __TASK_NETWORK_H__
+
+#include <WiFi.h>
+#include "global.h"
+#include "task_wifi.h"
+#include "task_webserver.h"
+
+// Supervisor wake-ups besides WiFi events: reconnect steps while the link is
+// down, ElegantOTA / config checks while it is up
+#define NET_RECONNECT_POLL_MS 250
+#define NET_IDLE_POLL_MS 1000
+
+// UTC wall clock for the sensor history; lwIP keeps re-syncing once started
+#define NET_NTP_SERVER1 "pool.ntp.org"
+#define NET_NTP_SERVER2 "time.google.com"
+
+// Single owner of the WiFi link and the web server lifecycle. State changes
+// are published on g_netEvents (NET_* bits in global.h).
+void network_supervisor_task(void *pvParameters);
+
+#endif
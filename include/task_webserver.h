@@ -25,18 +25,102 @@ typedef struct
     int port;
 } SettingsCommand;
 
+// Minified, gzipped, content-hashed dashboard (tools/build_web_assets.py)
+#define WEB_BUNDLE_DIR "/www/"
+#define WEB_BUNDLE_INDEX "/www/index.html.gz"
+
+// Same bundle compiled into flash (-DWEB_ASSETS_EMBEDDED); the table is
+// generated into .pio/webgen/web_assets_embedded.h by the same script
+typedef struct
+{
+    const char *uri;
+    const char *contentType;
+    const uint8_t *data; // gzipped body
+    size_t length;
+    const char *etag;    // CRC32 of the uncompressed body, like the LittleFS .gz ETag
+    bool immutable;      // content-hashed name, cache forever
+} EmbeddedWebAsset_t;
+
+// Binary WebSocket subprotocol (MessagePack frames); plain text JSON otherwise
+#define WS_PROTO_MSGPACK "iot.msgpack"
+#define WS_MAX_PROTO_CLIENTS 8
+#define WS_CLOSE_TRY_AGAIN_LATER 1013 // Close code for an iot.msgpack client without a slot
+
+// Sensor frames are held back (newest wins) while a client has this many
+// messages queued; device events are always queued
+#define WS_BACKPRESSURE_QUEUE_LEN 2
+
+// /events SSE stream: broadcasts kept in RAM for Last-Event-ID resume
+#define WS_SSE_HISTORY 64
+#define WS_SSE_EVENT_SIZE 96
+#define WS_SSE_RETRY_MS 2000
+
+// Pre-allocated broadcast buffers shared by every client queue
+#define WS_BROADCAST_POOL_SIZE 8
+#define WS_BROADCAST_BUFFER_SIZE 256
+
+// Bytes on air and encode time per encoding, for comparing the two modes
+typedef struct
+{
+    uint32_t jsonMessages;
+    uint32_t jsonBytes;
+    uint32_t jsonEncodeUs;
+    uint32_t msgpackMessages;
+    uint32_t msgpackBytes;
+    uint32_t msgpackEncodeUs;
+    uint32_t broadcasts;
+    uint32_t broadcastUs; // Encode + enqueue to all clients
+    uint32_t poolMisses;  // Broadcasts that had to fall back to the heap
+} WsProtocolStats_t;
+
+// Flow-control state kept for every connected WebSocket client
+typedef struct
+{
+    uint32_t id = 0; // 0 = free slot
+    bool msgpack = false;
+    AsyncWebSocketSharedBuffer pending; // Newest sensor frame not yet queued
+    uint32_t pendingSinceMs = 0;
+    uint32_t framesSent = 0;
+    uint32_t framesDropped = 0; // Stale sensor frames replaced before sending
+    uint32_t maxQueueLen = 0;
+    uint32_t maxLagMs = 0;
+    uint32_t lastSentMs = 0; // millis() of the last frame queued to the client
+} WsClientState_t;
+
+// Snapshot of one client's lag metrics
+typedef struct
+{
+    uint32_t id;
+    bool msgpack;
+    size_t queueLen;
+    size_t sendSpace; // Free TCP send window in bytes
+    uint32_t framesSent;
+    uint32_t framesDropped;
+    uint32_t maxQueueLen;
+    uint32_t maxLagMs;
+    uint32_t pendingAgeMs;
+    uint32_t lastSentAgeMs; // Time since anything was queued to the client
+} WsClientMetrics_t;
+
 extern AsyncWebServer server;
 extern AsyncWebSocket ws;
+extern AsyncEventSource events;
 
 void Webserver_stop();
 void Webserver_reconnect();
 void Webserver_sendata(String data);
+void Webserver_sendDocument(const JsonDocument &doc, bool latestOnly = false);
+void Webserver_flushPending();
+size_t getWsClientMetrics(WsClientMetrics_t *metrics, size_t maxCount);
+void getWsProtocolStats(WsProtocolStats_t *stats);
 
 extern QueueHandle_t xQueueRelayControl;
 extern QueueHandle_t xQueueSettings;
+extern QueueSetHandle_t xQueueDeviceSet; // Both queues above
 
 void connnectWSV();
 void handleWebSocketMessage(String message);
+void handleWebSocketDocument(JsonDocument &doc);
 void Webserver_RTOS_Task(void *pvParameters);
 
 #endif
\ No newline at end of file
@@ -5,7 +5,45 @@
 #include <task_check_info.h>
 #include <task_webserver.h>
 
+// Reconnect timing
+#define WIFI_DIRECT_TIMEOUT_MS 3000  // Cached BSSID/channel attempt before falling back
+#define WIFI_SCAN_TIMEOUT_MS 15000   // Full scan + DHCP attempt
+#define WIFI_RETRY_BACKOFF_MS 5000   // Pause after a failed attempt
+
+// Optional static address, e.g. -DWIFI_STATIC_IP='"192.168.1.50"' together
+// with WIFI_STATIC_GATEWAY, WIFI_STATIC_SUBNET and WIFI_STATIC_DNS
+
+// Last successful association, reused for the direct-connect attempt: only
+// the BSSID and channel, so the scan is skipped but the address still comes
+// from DHCP (and gets renewed). A failed direct attempt falls back to a full
+// scan.
+#define WIFI_CACHE_FILE "/wifi.bin"
+#define WIFI_CACHE_MAGIC 0x4E4B4C57 // "WLKN"
+
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t crc; // CRC32 of everything above
+} WifiLinkCache_t;
+
+// Connect duration histogram, bucket limits 250/500/1k/2k/5k/10k/20k ms
+#define WIFI_HISTOGRAM_BUCKETS 8
+
+typedef struct
+{
+    uint32_t histogram[WIFI_HISTOGRAM_BUCKETS];
+    uint32_t direct;   // Connects via the cached BSSID/channel
+    uint32_t scan;     // Connects after a full scan
+    uint32_t timeouts; // Attempts that ended in backoff
+    uint32_t lastMs;
+} WifiReconnectStats_t;
+
+// Non-blocking: starts or advances a reconnect, returns true while connected
 extern bool Wifi_reconnect();
 extern void startAP();
+void getWifiReconnectStats(WifiReconnectStats_t *stats);
 
-#endif
\ No newline at end of file
+#endif
@@ -4,6 +4,9 @@
 #include "LiquidCrystal_I2C.h"
 #include "DHT20.h"
 #include "global.h"
+#include "sensor_history.h"
+#include "ts_store.h"
+#include "power_manager.h"
 
 // LCD I2C address and dimensions
 #define LCD_ADDRESS 33
@@ -0,0 +1,72 @@
+#ifndef __TS_STORE_H__
+#define __TS_STORE_H__
+
+#include <Arduino.h>
+#include "LittleFS.h"
+#include "global.h"
+
+// Persistent sensor history on LittleFS, decoded on the host by
+// tools/ts_export.py (keep the two in sync).
+//
+// /ts/NNNNNNNN.tsd  data segment: TS_BLOCKS_PER_FILE fixed-size blocks
+// /ts/NNNNNNNN.tsi  index: one TsIndexEntry_t per block, for time-range seeks
+//
+// A block is a TsBlockHeader_t followed by an MSB-first bitstream:
+//   sample 0   : temp, humi as raw float32 (time is in the header)
+//   sample n   : timestamp delta-of-delta, then temp, humi XOR-coded
+// Timestamp delta-of-delta:
+//   '0'                       dod == 0
+//   '10'   + 7 bits (+63)     -63..64
+//   '110'  + 9 bits (+255)    -255..256
+//   '1110' + 12 bits (+2047)  -2047..2048
+//   '1111' + 32 bits          anything else
+// Value XOR against the previous value of the same channel:
+//   '0'                                     same value
+//   '10' + meaningful bits                  fits the previous leading/trailing window
+//   '11' + 5 bits leading + 5 bits (len-1) + len bits
+#define TS_DIR "/ts"
+#define TS_BLOCK_SIZE 512
+#define TS_BLOCK_MAGIC 0x5354 // "TS"
+#define TS_BLOCK_VERSION 1
+#define TS_CHANNELS 2
+#ifndef TS_BLOCKS_PER_FILE
+#define TS_BLOCKS_PER_FILE 64 // 32 KB per segment
+#endif
+#ifndef TS_MAX_FILES
+#define TS_MAX_FILES 16 // Oldest segment is deleted beyond this
+#endif
+
+typedef struct __attribute__((packed))
+{
+    uint16_t magic;
+    uint8_t version;
+    uint8_t channels;
+    uint16_t count; // Samples in this block
+    uint16_t bits;  // Used payload bits
+    uint32_t firstTime;
+    uint32_t lastTime;
+} TsBlockHeader_t;
+
+typedef struct __attribute__((packed))
+{
+    uint32_t firstTime;
+    uint32_t lastTime;
+} TsIndexEntry_t;
+
+typedef struct
+{
+    uint32_t samples;      // Samples in sealed blocks
+    uint32_t blocks;       // Blocks written since boot
+    uint32_t payloadBytes; // Compressed bitstream bytes in those blocks
+    uint32_t fsBytes;      // Bytes handed to LittleFS (blocks + index entries)
+    uint32_t rotations;
+} TsStoreStats_t;
+
+bool ts_store_begin();
+
+// Buffers the sample in the open block; a full block is written in one go
+void ts_store_append(uint32_t time, float temp, float humi);
+
+void getTsStoreStats(TsStoreStats_t *stats);
+
+#endif
@@ -8,6 +8,28 @@
 #include "PubSubClient.h"
 #include "Arduino.h"
 
+// MQTT 5 property identifiers used here
+#define MQTT_PROP_TOPIC_ALIAS_MAXIMUM 0x22
+#define MQTT_PROP_TOPIC_ALIAS         0x23
+// Largest PUBLISH property block written here: length byte + topic alias
+#define MQTT_PUBLISH_PROPS_SIZE(version) ((version) == MQTT_VERSION_5 ? 4 : 0)
+
+// decodes a variable byte integer; returns its size, 0 if it runs past end
+static uint8_t readVarInt(const uint8_t* buf, uint32_t pos, uint32_t end, uint32_t* value) {
+    uint32_t multiplier = 1;
+    uint8_t size = 0;
+    *value = 0;
+    while (pos + size < end && size < 4) {
+        uint8_t digit = buf[pos + size++];
+        *value += (digit & 127) * multiplier;
+        if ((digit & 128) == 0) {
+            return size;
+        }
+        multiplier <<= 7;
+    }
+    return 0;
+}
+
 PubSubClient::PubSubClient() {
     this->_state = MQTT_DISCONNECTED;
     this->_client = NULL;
@@ -160,6 +182,8 @@ PubSubClient::PubSubClient(const char* domain, uint16_t port, MQTT_CALLBACK_SIGN
 
 PubSubClient::~PubSubClient() {
   free(this->buffer);
+  free(this->inflight);
+  free(this->inflightStore);
 }
 
 boolean PubSubClient::connect(const char *id) {
@@ -203,7 +227,7 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
             uint8_t d[9] = {0x00,0x06,'M','Q','I','s','d','p', MQTT_VERSION};
 #define MQTT_HEADER_VERSION_LENGTH 9
 #elif MQTT_VERSION == MQTT_VERSION_3_1_1
-            uint8_t d[7] = {0x00,0x04,'M','Q','T','T',MQTT_VERSION};
+            uint8_t d[7] = {0x00,0x04,'M','Q','T','T',this->protocolVersion};
 #define MQTT_HEADER_VERSION_LENGTH 7
 #endif
             for (j = 0;j<MQTT_HEADER_VERSION_LENGTH;j++) {
@@ -231,10 +255,16 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
 
             this->buffer[length++] = ((this->keepAlive) >> 8);
             this->buffer[length++] = ((this->keepAlive) & 0xFF);
+            if (this->protocolVersion == MQTT_VERSION_5) {
+                this->buffer[length++] = 0; // No CONNECT properties
+            }
 
             CHECK_STRING_LENGTH(length,id)
             length = writeString(id,this->buffer,length);
             if (willTopic) {
+                if (this->protocolVersion == MQTT_VERSION_5) {
+                    this->buffer[length++] = 0; // No will properties
+                }
                 CHECK_STRING_LENGTH(length,willTopic)
                 length = writeString(willTopic,this->buffer,length);
                 CHECK_STRING_LENGTH(length,willMessage)
@@ -254,28 +284,49 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
 
             lastInActivity = lastOutActivity = millis();
 
+            boolean refused = false;
             while (!_client->available()) {
                 unsigned long t = millis();
+                if (this->protocolVersion == MQTT_VERSION_5 && !_client->connected()) {
+                    // Closed without a CONNACK: how some 3.1.1 brokers refuse level 5
+                    refused = true;
+                    break;
+                }
                 if (t-lastInActivity >= ((int32_t) this->socketTimeout*1000UL)) {
                     _state = MQTT_CONNECTION_TIMEOUT;
                     _client->stop();
                     return false;
                 }
             }
-            uint8_t llen;
-            uint32_t len = readPacket(&llen);
+            uint8_t llen = 1;
+            uint32_t len = refused ? 0 : readPacket(&llen);
 
-            if (len == 4) {
-                if (buffer[3] == 0) {
+            // 3.1.1: flags, return code. 5: flags, reason code, properties
+            if (len == 4 || (len > 4 && this->protocolVersion == MQTT_VERSION_5)) {
+                uint8_t code = buffer[llen+2];
+                if (code == 0) {
                     lastInActivity = millis();
                     pingOutstanding = false;
                     _state = MQTT_CONNECTED;
+                    // Aliases only live as long as the network connection
+                    memset(this->topicAliases, 0, sizeof(this->topicAliases));
+                    this->topicAliasMax = 0;
+                    if (this->protocolVersion == MQTT_VERSION_5) {
+                        readConnackProperties(llen+3, len < this->bufferSize ? len : this->bufferSize);
+                    }
+                    resendInflight();
                     return true;
                 } else {
-                    _state = buffer[3];
+                    _state = code;
+                    // 0x01 comes from a 3.1.1 broker, 0x84 from an MQTT 5 one
+                    refused = this->protocolVersion == MQTT_VERSION_5 && (code == 0x01 || code == 0x84);
                 }
             }
             _client->stop();
+            if (refused) {
+                this->protocolVersion = MQTT_VERSION_3_1_1;
+                return connect(id,user,pass,willTopic,willQos,willRetain,willMessage,cleanSession);
+            }
         } else {
             _state = MQTT_CONNECT_FAILED;
         }
@@ -309,6 +360,25 @@ boolean PubSubClient::readByte(uint8_t * result, uint16_t * index){
   return false;
 }
 
+// reads up to length bytes in one call, waiting up to socketTimeout for the
+// first one; returns the number read, 0 on timeout
+uint32_t PubSubClient::readBytes(uint8_t * result, uint32_t length) {
+   uint32_t previousMillis = millis();
+   int available;
+   while((available = _client->available()) <= 0) {
+     yield();
+     uint32_t currentMillis = millis();
+     if(currentMillis - previousMillis >= ((int32_t) this->socketTimeout * 1000)){
+       return 0;
+     }
+   }
+   if ((uint32_t)available < length) {
+     length = available;
+   }
+   int rc = _client->read(result, length);
+   return rc > 0 ? rc : 0;
+}
+
 uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
     uint16_t len = 0;
     if(!readByte(this->buffer, &len)) return 0;
@@ -339,26 +409,64 @@ uint32_t PubSubClient::readPacket(uint8_t* lengthLength) {
         if(!readByte(this->buffer, &len)) return 0;
         skip = (this->buffer[*lengthLength+1]<<8)+this->buffer[*lengthLength+2];
         start = 2;
-        if (this->buffer[0]&MQTTQOS1) {
-            // skip message id
+        if ((this->buffer[0]&0x06) == MQTTQOS1) {
+            // skip message id, it sits between the topic and the MQTT 5 properties;
+            // same QoS test as loop(), which parses the buffered copy
             skip += 2;
         }
     }
     uint32_t idx = len;
-
-    for (uint32_t i = start;i<length;i++) {
-        if(!readByte(&digit)) return 0;
-        if (this->stream) {
-            if (isPublish && idx-*lengthLength-2>skip) {
-                this->stream->write(digit);
+    uint32_t remaining = length > start ? length - start : 0;
+    // First payload byte of a publish, the only part handed to the stream
+    uint32_t streamFrom = *lengthLength + 3 + skip;
+
+    if (this->stream && isPublish && this->protocolVersion == MQTT_VERSION_5) {
+        // MQTT 5 puts properties between the topic / packet id and the
+        // payload; read up to their length so the stream can skip them
+        uint32_t propLength = 0;
+        uint32_t multiplier = 1;
+        uint8_t propLengthSize = 0;
+        boolean more = true;
+        while (remaining > 0 && more) {
+            if(!readByte(&digit)) return 0;
+            if (len < this->bufferSize) {
+                this->buffer[len++] = digit;
+            }
+            if (idx >= streamFrom) {
+                propLength += (digit & 127) * multiplier;
+                multiplier <<= 7;
+                propLengthSize++;
+                more = (digit & 128) && propLengthSize < 4;
             }
+            idx++;
+            remaining--;
         }
+        streamFrom += propLengthSize + propLength;
+    }
+    uint8_t scratch[MQTT_READ_CHUNK_SIZE];
 
+    // Bulk reads straight into the buffer; whatever does not fit goes
+    // through scratch so it can still be streamed, then is dropped
+    while (remaining > 0) {
+        uint8_t* dest = scratch;
+        uint32_t room = sizeof(scratch);
         if (len < this->bufferSize) {
-            this->buffer[len] = digit;
-            len++;
+            dest = this->buffer + len;
+            room = this->bufferSize - len;
+        }
+        uint32_t n = readBytes(dest, remaining < room ? remaining : room);
+        if (n == 0) return 0;
+
+        if (this->stream && isPublish && idx + n > streamFrom) {
+            uint32_t offset = idx < streamFrom ? streamFrom - idx : 0;
+            this->stream->write(dest + offset, n - offset);
         }
-        idx++;
+
+        if (dest != scratch) {
+            len += n;
+        }
+        idx += n;
+        remaining -= n;
     }
 
     if (!this->stream && idx > this->bufferSize) {
@@ -398,22 +506,43 @@ boolean PubSubClient::loop() {
                         memmove(this->buffer+llen+2,this->buffer+llen+3,tl); /* move topic inside buffer 1 byte to front */
                         this->buffer[llen+2+tl] = 0; /* end the topic as a 'C' string with \x00 */
                         char *topic = (char*) this->buffer+llen+2;
+                        uint32_t pos = llen+3+tl;
+                        // The callback may publish, which reuses the buffer
+                        boolean qos1 = (this->buffer[0]&0x06) == MQTTQOS1;
                         // msgId only present for QOS>0
-                        if ((this->buffer[0]&0x06) == MQTTQOS1) {
-                            msgId = (this->buffer[llen+3+tl]<<8)+this->buffer[llen+3+tl+1];
-                            payload = this->buffer+llen+3+tl+2;
-                            callback(topic,payload,len-llen-3-tl-2);
-
+                        if (qos1) {
+                            msgId = (this->buffer[pos]<<8)+this->buffer[pos+1];
+                            pos += 2;
+                        }
+                        if (this->protocolVersion == MQTT_VERSION_5) {
+                            // Skip the properties; none of them are used here
+                            uint32_t propLength = 0;
+                            pos += readVarInt(this->buffer, pos, len, &propLength);
+                            pos += propLength;
+                            if (pos > len) {
+                                pos = len;
+                            }
+                        }
+                        payload = this->buffer+pos;
+                        callback(topic,payload,len-pos);
+                        if (qos1) {
                             this->buffer[0] = MQTTPUBACK;
                             this->buffer[1] = 2;
                             this->buffer[2] = (msgId >> 8);
                             this->buffer[3] = (msgId & 0xFF);
                             _client->write(this->buffer,4);
                             lastOutActivity = t;
-
-                        } else {
-                            payload = this->buffer+llen+3+tl;
-                            callback(topic,payload,len-llen-3-tl);
+                        }
+                    }
+                } else if (type == MQTTPUBACK) {
+                    if (len >= (uint16_t)(llen + 3)) {
+                        msgId = (this->buffer[llen+1]<<8)+this->buffer[llen+2];
+                        for (uint8_t i = 0; i < this->inflightWindow; i++) {
+                            if (this->inflight[i].msgId == msgId) {
+                                this->inflight[i].msgId = 0;
+                                this->inflightCount--;
+                                break;
+                            }
                         }
                     }
                 } else if (type == MQTTPINGREQ) {
@@ -447,19 +576,17 @@ boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigne
 
 boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained) {
     if (connected()) {
-        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + plength) {
+        if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + MQTT_PUBLISH_PROPS_SIZE(this->protocolVersion) + plength) {
             // Too long
             return false;
         }
         // Leave room in the buffer for header and variable length field
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        length = writeString(topic,this->buffer,length);
+        length = writePublishHeader(topic,this->buffer,length,0,true);
 
         // Add payload
-        uint16_t i;
-        for (i=0;i<plength;i++) {
-            this->buffer[length++] = payload[i];
-        }
+        memcpy(this->buffer+length, payload, plength);
+        length += plength;
 
         // Write the header
         uint8_t header = MQTTPUBLISH;
@@ -471,6 +598,86 @@ boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigne
     return false;
 }
 
+boolean PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int plength, boolean retained, uint8_t qos) {
+    if (qos == 0) {
+        return publish(topic, payload, plength, retained);
+    }
+    if (qos > 1 || !connected()) {
+        return false;
+    }
+    uint8_t slot;
+    for (slot = 0; slot < this->inflightWindow; slot++) {
+        if (this->inflight[slot].msgId == 0) {
+            break;
+        }
+    }
+    if (slot == this->inflightWindow) {
+        // Window full: the caller retries after loop() has taken some PUBACKs
+        return false;
+    }
+    if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + 2 + MQTT_PUBLISH_PROPS_SIZE(this->protocolVersion) + plength) {
+        // Too long
+        return false;
+    }
+
+    // The store keeps the full topic: aliases do not survive a reconnect
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    uint16_t msgId = nextPublishId();
+    length = writePublishHeader(topic,this->buffer,length,msgId,false);
+    memcpy(this->buffer+length, payload, plength);
+    length += plength;
+
+    uint8_t header = MQTTPUBLISH | MQTTQOS1;
+    if (retained) {
+        header |= 1;
+    }
+    size_t hlen = buildHeader(header, this->buffer, length-MQTT_MAX_HEADER_SIZE);
+    uint16_t total = length-MQTT_MAX_HEADER_SIZE+hlen;
+    if (total + (this->protocolVersion == MQTT_VERSION_5 ? 0 : 2) > MQTT_INFLIGHT_SLOT_SIZE) {
+        // Would not fit the retransmit store, or not once re-encoded for a
+        // later MQTT 5 connection (property byte and a longer length field)
+        return false;
+    }
+    memcpy(this->inflightStore + slot*MQTT_INFLIGHT_SLOT_SIZE, this->buffer+(MQTT_MAX_HEADER_SIZE-hlen), total);
+    this->inflight[slot].msgId = msgId;
+    this->inflight[slot].length = total;
+    this->inflight[slot].seq = this->inflightSeq++;
+    this->inflight[slot].version = this->protocolVersion;
+    this->inflightCount++;
+
+    if (this->topicAliasMax > 0) {
+        // First transmission can still use the alias on this connection
+        length = writePublishHeader(topic,this->buffer,MQTT_MAX_HEADER_SIZE,msgId,true);
+        memcpy(this->buffer+length, payload, plength);
+        length += plength;
+    }
+
+    // A failed write is not an error here: the message stays in the window
+    // and goes out again with DUP set once the connection is re-established
+    write(header,this->buffer,length-MQTT_MAX_HEADER_SIZE);
+    return true;
+}
+
+boolean PubSubClient::publish(const char* topic, const MQTTSegment* segments, size_t count, boolean retained) {
+    size_t plength = 0;
+    for (size_t i = 0; i < count; i++) {
+        plength += segments[i].length;
+    }
+    if (!beginPublish(topic, plength, retained)) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].length > 0 && write(segments[i].data, segments[i].length) != segments[i].length) {
+            // The header announced the full length; a partial packet would
+            // desynchronise the stream, so the connection has to go
+            _client->stop();
+            _state = MQTT_CONNECTION_LOST;
+            return false;
+        }
+    }
+    return endPublish();
+}
+
 boolean PubSubClient::publish_P(const char* topic, const char* payload, boolean retained) {
     return publish_P(topic, (const uint8_t*)payload, payload ? strnlen(payload, this->bufferSize) : 0, retained);
 }
@@ -491,13 +698,14 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
     }
 
     tlen = strnlen(topic, this->bufferSize);
+    uint8_t props = this->protocolVersion == MQTT_VERSION_5 ? 1 : 0;
 
     header = MQTTPUBLISH;
     if (retained) {
         header |= 1;
     }
     this->buffer[pos++] = header;
-    len = plength + 2 + tlen;
+    len = plength + 2 + tlen + props;
     do {
         digit = len  & 127; //digit = len %128
         len >>= 7; //len = len / 128
@@ -509,6 +717,9 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
     } while(len>0);
 
     pos = writeString(topic,this->buffer,pos);
+    if (props) {
+        this->buffer[pos++] = 0; // No properties
+    }
 
     rc += _client->write(this->buffer,pos);
 
@@ -518,16 +729,20 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
 
     lastOutActivity = millis();
 
-    expectedLength = 1 + llen + 2 + tlen + plength;
+    expectedLength = 1 + llen + 2 + tlen + props + plength;
 
     return (rc == expectedLength);
 }
 
 boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, boolean retained) {
+    if (this->bufferSize < MQTT_MAX_HEADER_SIZE + 2+strnlen(topic, this->bufferSize) + MQTT_PUBLISH_PROPS_SIZE(this->protocolVersion)) {
+        // Topic too long
+        return false;
+    }
     if (connected()) {
         // Send the header and variable length field
         uint16_t length = MQTT_MAX_HEADER_SIZE;
-        length = writeString(topic,this->buffer,length);
+        length = writePublishHeader(topic,this->buffer,length,0,true);
         uint8_t header = MQTTPUBLISH;
         if (retained) {
             header |= 1;
@@ -554,12 +769,12 @@ size_t PubSubClient::write(const uint8_t *buffer, size_t size) {
     return _client->write(buffer,size);
 }
 
-size_t PubSubClient::buildHeader(uint8_t header, uint8_t* buf, uint16_t length) {
+size_t PubSubClient::buildHeader(uint8_t header, uint8_t* buf, uint32_t length) {
     uint8_t lenBuf[4];
     uint8_t llen = 0;
     uint8_t digit;
     uint8_t pos = 0;
-    uint16_t len = length;
+    uint32_t len = length;
     do {
 
         digit = len  & 127; //digit = len %128
@@ -627,6 +842,9 @@ boolean PubSubClient::subscribe(const char* topic, uint8_t qos) {
         }
         this->buffer[length++] = (nextMsgId >> 8);
         this->buffer[length++] = (nextMsgId & 0xFF);
+        if (this->protocolVersion == MQTT_VERSION_5) {
+            this->buffer[length++] = 0; // No properties
+        }
         length = writeString((char*)topic, this->buffer,length);
         this->buffer[length++] = qos;
         return write(MQTTSUBSCRIBE|MQTTQOS1,this->buffer,length-MQTT_MAX_HEADER_SIZE);
@@ -651,6 +869,9 @@ boolean PubSubClient::unsubscribe(const char* topic) {
         }
         this->buffer[length++] = (nextMsgId >> 8);
         this->buffer[length++] = (nextMsgId & 0xFF);
+        if (this->protocolVersion == MQTT_VERSION_5) {
+            this->buffer[length++] = 0; // No properties
+        }
         length = writeString(topic, this->buffer,length);
         return write(MQTTUNSUBSCRIBE|MQTTQOS1,this->buffer,length-MQTT_MAX_HEADER_SIZE);
     }
@@ -667,6 +888,179 @@ void PubSubClient::disconnect() {
     lastInActivity = lastOutActivity = millis();
 }
 
+// next packet id that is not held by an in-flight publish
+uint16_t PubSubClient::nextPublishId() {
+    while (true) {
+        nextMsgId++;
+        if (nextMsgId == 0) {
+            nextMsgId = 1;
+        }
+        uint8_t i;
+        for (i = 0; i < this->inflightWindow; i++) {
+            if (this->inflight[i].msgId == nextMsgId) {
+                break;
+            }
+        }
+        if (i == this->inflightWindow) {
+            return nextMsgId;
+        }
+    }
+}
+
+// resends every unacknowledged QoS 1 publish, oldest first, with DUP set
+void PubSubClient::resendInflight() {
+    boolean first = true;
+    uint32_t after = 0;
+    for (uint8_t n = 0; n < this->inflightCount; n++) {
+        int oldest = -1;
+        for (uint8_t i = 0; i < this->inflightWindow; i++) {
+            if (this->inflight[i].msgId == 0 || (!first && this->inflight[i].seq <= after)) {
+                continue;
+            }
+            if (oldest < 0 || this->inflight[i].seq < this->inflight[oldest].seq) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0) {
+            break;
+        }
+        if (this->inflight[oldest].version != this->protocolVersion) {
+            // Stored on a connection at the other level (fallback to 3.1.1 or
+            // a broker change): as it is, the broker would misparse it
+            reencodeInflight(oldest);
+        }
+        uint8_t* packet = this->inflightStore + oldest*MQTT_INFLIGHT_SLOT_SIZE;
+        packet[0] |= MQTTDUP;
+        _client->write(packet, this->inflight[oldest].length);
+        after = this->inflight[oldest].seq;
+        first = false;
+    }
+    lastOutActivity = millis();
+}
+
+void PubSubClient::reencodeInflight(uint8_t slot) {
+    uint8_t* packet = this->inflightStore + slot*MQTT_INFLIGHT_SLOT_SIZE;
+    uint16_t length = this->inflight[slot].length;
+    uint16_t hlen = 1;
+    while (packet[hlen++] & 0x80) {
+    }
+    // Properties follow the topic and the packet id
+    uint16_t pos = hlen + 2 + ((packet[hlen] << 8) | packet[hlen+1]) + 2;
+    if (this->protocolVersion == MQTT_VERSION_5) {
+        memmove(packet+pos+1, packet+pos, length-pos);
+        packet[pos] = 0; // No properties
+        length++;
+    } else {
+        // Stored without an alias, so the block is at most a few bytes
+        uint16_t props = 1 + packet[pos];
+        memmove(packet+pos, packet+pos+props, length-pos-props);
+        length -= props;
+    }
+    size_t newHlen = buildHeader(packet[0], this->buffer, length-hlen);
+    memmove(packet+newHlen, packet+hlen, length-hlen);
+    memcpy(packet, this->buffer+(MQTT_MAX_HEADER_SIZE-newHlen), newHlen);
+    this->inflight[slot].length = length-hlen+newHlen;
+    this->inflight[slot].version = this->protocolVersion;
+}
+
+// alias for topic on this MQTT 5 connection, 0 for none. *sendTopic is false
+// when the broker already has the mapping; otherwise the least recently used
+// alias is (re)assigned and has to go out together with the topic
+uint16_t PubSubClient::topicAlias(const char* topic, boolean* sendTopic) {
+    *sendTopic = true;
+    if (this->topicAliasMax == 0 || topic[0] == 0 || strnlen(topic, MQTT_TOPIC_ALIAS_LENGTH) >= MQTT_TOPIC_ALIAS_LENGTH) {
+        return 0;
+    }
+    uint16_t oldest = 0;
+    for (uint16_t i = 0; i < this->topicAliasMax; i++) {
+        if (strcmp(this->topicAliases[i].topic, topic) == 0) {
+            this->topicAliases[i].lastUse = ++this->topicAliasClock;
+            *sendTopic = false;
+            return i + 1;
+        }
+        if (this->topicAliases[i].lastUse < this->topicAliases[oldest].lastUse) {
+            oldest = i;
+        }
+    }
+    strcpy(this->topicAliases[oldest].topic, topic);
+    this->topicAliases[oldest].lastUse = ++this->topicAliasClock;
+    return oldest + 1;
+}
+
+uint16_t PubSubClient::writePublishHeader(const char* topic, uint8_t* buf, uint16_t pos, uint16_t msgId, boolean useAlias) {
+    boolean sendTopic = true;
+    uint16_t alias = useAlias ? topicAlias(topic, &sendTopic) : 0;
+    pos = writeString(sendTopic ? topic : "", buf, pos);
+    if (msgId != 0) {
+        buf[pos++] = (msgId >> 8);
+        buf[pos++] = (msgId & 0xFF);
+    }
+    if (this->protocolVersion == MQTT_VERSION_5) {
+        if (alias != 0) {
+            buf[pos++] = 3;
+            buf[pos++] = MQTT_PROP_TOPIC_ALIAS;
+            buf[pos++] = (alias >> 8);
+            buf[pos++] = (alias & 0xFF);
+        } else {
+            buf[pos++] = 0; // No properties
+        }
+    }
+    return pos;
+}
+
+// picks the broker's Topic Alias Maximum out of the CONNACK properties
+void PubSubClient::readConnackProperties(uint16_t pos, uint16_t end) {
+    uint32_t propLength = 0;
+    uint8_t size = readVarInt(this->buffer, pos, end, &propLength);
+    if (size == 0) {
+        return;
+    }
+    pos += size;
+    if (pos + propLength < end) {
+        end = pos + propLength;
+    }
+    while (pos < end) {
+        uint8_t id = this->buffer[pos++];
+        uint32_t skip;
+        switch (id) {
+        case MQTT_PROP_TOPIC_ALIAS_MAXIMUM:
+            if (pos + 2 <= end) {
+                uint16_t brokerMax = (this->buffer[pos]<<8)+this->buffer[pos+1];
+                this->topicAliasMax = brokerMax < MQTT_MAX_TOPIC_ALIASES ? brokerMax : MQTT_MAX_TOPIC_ALIASES;
+            }
+            skip = 2;
+            break;
+        case 0x13: // Server Keep Alive: the broker's value wins
+            if (pos + 2 <= end) {
+                this->keepAlive = (this->buffer[pos]<<8)+this->buffer[pos+1];
+            }
+            skip = 2;
+            break;
+        case 0x21: // Receive Maximum
+            skip = 2;
+            break;
+        case 0x11: case 0x27: // Session Expiry Interval, Maximum Packet Size
+            skip = 4;
+            break;
+        case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A: // Byte flags
+            skip = 1;
+            break;
+        case 0x12: case 0x15: case 0x1A: case 0x1C: case 0x1F: case 0x16: // Strings, binary data
+            skip = 2 + ((pos + 2 <= end) ? (this->buffer[pos]<<8)+this->buffer[pos+1] : 0);
+            break;
+        case 0x26: { // User Property: string pair
+            uint32_t keyLength = (pos + 2 <= end) ? (this->buffer[pos]<<8)+this->buffer[pos+1] : 0;
+            uint32_t valuePos = pos + 2 + keyLength;
+            skip = 4 + keyLength + ((valuePos + 2 <= end) ? (this->buffer[valuePos]<<8)+this->buffer[valuePos+1] : 0);
+            break;
+        }
+        default:
+            return; // Not a CONNACK property: stop rather than misparse
+        }
+        pos += skip;
+    }
+}
+
 uint16_t PubSubClient::writeString(const char* string, uint8_t* buf, uint16_t pos) {
     const char* idp = string;
     uint16_t i = 0;
@@ -759,6 +1153,55 @@ boolean PubSubClient::setBufferSize(uint16_t size) {
 uint16_t PubSubClient::getBufferSize() {
     return this->bufferSize;
 }
+
+boolean PubSubClient::setInflightWindow(uint8_t window) {
+    if (window > MQTT_MAX_INFLIGHT || this->inflightCount > 0) {
+        return false;
+    }
+    free(this->inflight);
+    free(this->inflightStore);
+    this->inflight = NULL;
+    this->inflightStore = NULL;
+    this->inflightWindow = 0;
+    if (window == 0) {
+        return true;
+    }
+    this->inflight = (InflightSlot*)calloc(window, sizeof(InflightSlot));
+    this->inflightStore = (uint8_t*)malloc(window*MQTT_INFLIGHT_SLOT_SIZE);
+    if (this->inflight == NULL || this->inflightStore == NULL) {
+        free(this->inflight);
+        free(this->inflightStore);
+        this->inflight = NULL;
+        this->inflightStore = NULL;
+        return false;
+    }
+    this->inflightWindow = window;
+    return true;
+}
+
+boolean PubSubClient::setProtocolVersion(uint8_t version) {
+#if MQTT_VERSION == MQTT_VERSION_3_1_1
+    if (version == MQTT_VERSION_3_1_1 || version == MQTT_VERSION_5) {
+#else
+    if (version == MQTT_VERSION) {
+#endif
+        this->protocolVersion = version;
+        return true;
+    }
+    return false;
+}
+
+uint8_t PubSubClient::getProtocolVersion() {
+    return this->protocolVersion;
+}
+
+uint8_t PubSubClient::getInflightWindow() {
+    return this->inflightWindow;
+}
+
+uint8_t PubSubClient::getInflightCount() {
+    return this->inflightCount;
+}
 PubSubClient& PubSubClient::setKeepAlive(uint16_t keepAlive) {
     this->keepAlive = keepAlive;
     return *this;
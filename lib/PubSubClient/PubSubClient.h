@@ -14,6 +14,7 @@
 
 #define MQTT_VERSION_3_1      3
 #define MQTT_VERSION_3_1_1    4
+#define MQTT_VERSION_5        5
 
 // MQTT_VERSION : Pick the version
 //#define MQTT_VERSION MQTT_VERSION_3_1
@@ -21,6 +22,16 @@
 #define MQTT_VERSION MQTT_VERSION_3_1_1
 #endif
 
+// MQTT_MAX_TOPIC_ALIASES : outbound topic aliases kept per MQTT 5 connection
+//  (setProtocolVersion(MQTT_VERSION_5)), capped by the broker's Topic Alias
+//  Maximum. Topics longer than MQTT_TOPIC_ALIAS_LENGTH - 1 are never aliased.
+#ifndef MQTT_MAX_TOPIC_ALIASES
+#define MQTT_MAX_TOPIC_ALIASES 4
+#endif
+#ifndef MQTT_TOPIC_ALIAS_LENGTH
+#define MQTT_TOPIC_ALIAS_LENGTH 48
+#endif
+
 // MQTT_MAX_PACKET_SIZE : Maximum packet size. Override with setBufferSize().
 #ifndef MQTT_MAX_PACKET_SIZE
 #define MQTT_MAX_PACKET_SIZE 256
@@ -41,6 +52,23 @@
 //  pass the entire MQTT packet in each write call.
 //#define MQTT_MAX_TRANSFER_SIZE 80
 
+// MQTT_READ_CHUNK_SIZE : stack scratch used to drain (or stream) the part of an
+//  incoming packet that does not fit in the buffer. The rest of the packet is
+//  read straight into the buffer with bulk read(buf, n) calls.
+#ifndef MQTT_READ_CHUNK_SIZE
+#define MQTT_READ_CHUNK_SIZE 64
+#endif
+
+// MQTT_MAX_INFLIGHT : largest window accepted by setInflightWindow(). Each slot
+//  keeps a copy of one outbound QoS 1 PUBLISH of up to MQTT_INFLIGHT_SLOT_SIZE
+//  bytes until its PUBACK arrives, and is resent with DUP set after a reconnect.
+#ifndef MQTT_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT 16
+#endif
+#ifndef MQTT_INFLIGHT_SLOT_SIZE
+#define MQTT_INFLIGHT_SLOT_SIZE 256
+#endif
+
 // Possible values for client.state()
 #define MQTT_CONNECTION_TIMEOUT     -4
 #define MQTT_CONNECTION_LOST        -3
@@ -72,6 +100,7 @@
 #define MQTTQOS0        (0 << 1)
 #define MQTTQOS1        (1 << 1)
 #define MQTTQOS2        (2 << 1)
+#define MQTTDUP         (1 << 3)
 
 // Maximum size of fixed header and variable length size header
 #define MQTT_MAX_HEADER_SIZE 5
@@ -83,6 +112,13 @@
 #define MQTT_CALLBACK_SIGNATURE void (*callback)(char*, uint8_t*, unsigned int)
 #endif
 
+// One piece of a scatter-gather publish() payload, written to the network
+// client as-is
+struct MQTTSegment {
+   const uint8_t* data;
+   size_t length;
+};
+
 #define CHECK_STRING_LENGTH(l,s) if (l+2+strnlen(s, this->bufferSize) > this->bufferSize) {_client->stop();return false;}
 
 class PubSubClient : public Print {
@@ -100,13 +136,45 @@ private:
    uint32_t readPacket(uint8_t*);
    boolean readByte(uint8_t * result);
    boolean readByte(uint8_t * result, uint16_t * index);
+   uint32_t readBytes(uint8_t * result, uint32_t length);
    boolean write(uint8_t header, uint8_t* buf, uint16_t length);
    uint16_t writeString(const char* string, uint8_t* buf, uint16_t pos);
    // Build up the header ready to send
    // Returns the size of the header
    // Note: the header is built at the end of the first MQTT_MAX_HEADER_SIZE bytes, so will start
    //       (MQTT_MAX_HEADER_SIZE - <returned size>) bytes into the buffer
-   size_t buildHeader(uint8_t header, uint8_t* buf, uint16_t length);
+   size_t buildHeader(uint8_t header, uint8_t* buf, uint32_t length);
+   // Outbound QoS 1 window: slot i stores its packet at
+   // inflightStore + i * MQTT_INFLIGHT_SLOT_SIZE; msgId 0 marks a free slot
+   struct InflightSlot {
+      uint16_t msgId;
+      uint16_t length;
+      uint32_t seq; // Send order, so resends keep the original order
+      uint8_t version; // Protocol level the stored packet is encoded for
+   };
+   InflightSlot* inflight = NULL;
+   uint8_t* inflightStore = NULL;
+   uint8_t inflightWindow = 0;
+   uint8_t inflightCount = 0;
+   uint32_t inflightSeq = 0;
+   uint16_t nextPublishId();
+   void resendInflight();
+   // Re-encodes the stored packet of slot for protocolVersion: adds or drops
+   // the property block, which moves the payload and can change the length field
+   void reencodeInflight(uint8_t slot);
+   uint8_t protocolVersion = MQTT_VERSION; // Drops to 3.1.1 if the broker refuses 5
+   struct TopicAlias {
+      char topic[MQTT_TOPIC_ALIAS_LENGTH]; // Empty = alias not set up yet
+      uint32_t lastUse;
+   };
+   TopicAlias topicAliases[MQTT_MAX_TOPIC_ALIASES];
+   uint16_t topicAliasMax = 0; // Usable aliases on this connection
+   uint32_t topicAliasClock = 0;
+   uint16_t topicAlias(const char* topic, boolean* sendTopic);
+   void readConnackProperties(uint16_t pos, uint16_t end);
+   // Writes the PUBLISH variable header at pos: topic (empty if it already has
+   // an alias), packet id when msgId != 0 and, on MQTT 5, the property block
+   uint16_t writePublishHeader(const char* topic, uint8_t* buf, uint16_t pos, uint16_t msgId, boolean useAlias);
    IPAddress ip;
    const char* domain;
    uint16_t port;
@@ -142,6 +210,20 @@ public:
    boolean setBufferSize(uint16_t size);
    uint16_t getBufferSize();
 
+   // MQTT_VERSION_5 negotiates topic aliases for outbound publishes; a broker
+   // that refuses the protocol level gets one immediate retry at 3.1.1, which
+   // sticks until this is called again. Takes effect on the next connect().
+   boolean setProtocolVersion(uint8_t version);
+   // Version of the current (or last) session
+   uint8_t getProtocolVersion();
+
+   // QoS 1 publishes that may await PUBACK at once, up to MQTT_MAX_INFLIGHT
+   // (0 disables QoS 1 publish). Allocates window * MQTT_INFLIGHT_SLOT_SIZE
+   // bytes; fails while messages are in flight.
+   boolean setInflightWindow(uint8_t window);
+   uint8_t getInflightWindow();
+   uint8_t getInflightCount();
+
    boolean connect(const char* id);
    boolean connect(const char* id, const char* user, const char* pass);
    boolean connect(const char* id, const char* willTopic, uint8_t willQos, boolean willRetain, const char* willMessage);
@@ -152,6 +234,15 @@ public:
    boolean publish(const char* topic, const char* payload, boolean retained);
    boolean publish(const char* topic, const uint8_t * payload, unsigned int plength);
    boolean publish(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
+   // qos 0 or 1. A QoS 1 message occupies a window slot until loop() handles
+   // its PUBACK; returns false if the window is full (or 0) or the packet is
+   // larger than MQTT_INFLIGHT_SLOT_SIZE (less 2 bytes on 3.1.1, room to
+   // resend it on MQTT 5). Once accepted it is never dropped.
+   boolean publish(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained, uint8_t qos);
+   // QoS 0 scatter-gather: the header and topic go out from the buffer, then
+   // each segment straight from the caller's memory, so bufferSize only has
+   // to fit the topic and the payload is never copied
+   boolean publish(const char* topic, const MQTTSegment* segments, size_t count, boolean retained);
    boolean publish_P(const char* topic, const char* payload, boolean retained);
    boolean publish_P(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
    // Start to publish a message.
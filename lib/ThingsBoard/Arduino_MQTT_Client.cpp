@@ -19,6 +19,10 @@ void Arduino_MQTT_Client::set_client(Client& transport_client) {
     m_mqtt_client.setClient(transport_client);
 }
 
+PubSubClient& Arduino_MQTT_Client::get_client() {
+    return m_mqtt_client;
+}
+
 void Arduino_MQTT_Client::set_callback(function cb) {
     m_mqtt_client.setCallback(cb);
 }
@@ -35,6 +39,14 @@ void Arduino_MQTT_Client::set_server(const char *domain, const uint16_t& port) {
     m_mqtt_client.setServer(domain, port);
 }
 
+bool Arduino_MQTT_Client::set_protocol_version(const uint8_t& version) {
+    return m_mqtt_client.setProtocolVersion(version);
+}
+
+uint8_t Arduino_MQTT_Client::get_protocol_version() {
+    return m_mqtt_client.getProtocolVersion();
+}
+
 bool Arduino_MQTT_Client::connect(const char *client_id, const char *user_name, const char *password) {
     return m_mqtt_client.connect(client_id, user_name, password);
 }
@@ -48,7 +60,9 @@ bool Arduino_MQTT_Client::loop() {
 }
 
 bool Arduino_MQTT_Client::publish(const char *topic, const uint8_t *payload, const size_t& length) {
-    return m_mqtt_client.publish(topic, payload, length, false);
+    // Already serialized by ThingsBoard: send it from there instead of copying it into the MQTT buffer
+    MQTTSegment segment = {payload, length};
+    return m_mqtt_client.publish(topic, &segment, 1, false);
 }
 
 bool Arduino_MQTT_Client::subscribe(const char *topic) {
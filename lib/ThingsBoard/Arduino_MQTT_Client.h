@@ -27,6 +27,11 @@ class Arduino_MQTT_Client : public IMQTT_Client {
     /// but the actual type of connection does not matter (Ethernet or WiFi)
     void set_client(Client& transport_client);
 
+    /// @brief Gets the underlying PubSubClient, for features that are not part of the IMQTT_Client interface,
+    /// like QoS 1 publishes with its in-flight window. Do not connect or disconnect it directly
+    /// @return Reference to the underlying PubSubClient
+    PubSubClient& get_client();
+
     void set_callback(function cb) override;
 
     bool set_buffer_size(const uint16_t& buffer_size) override;
@@ -35,6 +40,10 @@ class Arduino_MQTT_Client : public IMQTT_Client {
 
     void set_server(const char *domain, const uint16_t& port) override;
 
+    bool set_protocol_version(const uint8_t& version) override;
+
+    uint8_t get_protocol_version() override;
+
     bool connect(const char *client_id, const char *user_name, const char *password) override;
 
     void disconnect() override;
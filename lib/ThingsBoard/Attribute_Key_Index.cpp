@@ -0,0 +1,138 @@
+// Header include.
+#include "Attribute_Key_Index.h"
+
+// Library includes.
+#include <string.h>
+
+// Initial amount of slots, the table doubles whenever it would become more than half full
+constexpr size_t MINIMUM_SLOT_COUNT = 16U;
+constexpr uint32_t FNV_OFFSET_BASIS = 2166136261U;
+constexpr uint32_t FNV_PRIME = 16777619U;
+
+constexpr uint16_t Attribute_Key_Index::NO_ENTRY;
+
+Attribute_Key_Index::Attribute_Key_Index() :
+    m_characters(),
+    m_keys(),
+    m_entries(),
+    m_slots()
+{
+    // Nothing to do
+}
+
+void Attribute_Key_Index::clear() {
+    m_characters.clear();
+    m_keys.clear();
+    m_entries.clear();
+    m_slots.clear();
+}
+
+bool Attribute_Key_Index::add(const uint16_t& callback_index, const char *key, const size_t& length) {
+    if (key == nullptr || m_entries.size() >= NO_ENTRY || length >= NO_ENTRY) {
+        return false;
+    }
+    // Empty names, for example from two consecutive commas, can never match a received key
+    else if (length == 0U) {
+        return true;
+    }
+
+    const uint32_t key_hash = hash(key, length);
+    uint16_t key_index = m_slots.empty() ? NO_ENTRY : find_key(key, length, key_hash);
+
+    if (key_index == NO_ENTRY) {
+        if (m_keys.size() >= NO_ENTRY) {
+            return false;
+        }
+        Key interned;
+        interned.hash = key_hash;
+        interned.offset = m_characters.size();
+        interned.length = length;
+        interned.first = NO_ENTRY;
+        for (size_t i = 0; i < length; i++) {
+            m_characters.push_back(key[i]);
+        }
+        key_index = m_keys.size();
+        m_keys.push_back(interned);
+
+        // Keep the table at most half full, so probe sequences stay short
+        if (m_keys.size() * 2U > m_slots.size()) {
+            rehash(m_slots.empty() ? MINIMUM_SLOT_COUNT : m_slots.size() * 2U);
+        }
+        else {
+            size_t slot = key_hash & (m_slots.size() - 1U);
+            while (m_slots[slot] != NO_ENTRY) {
+                slot = (slot + 1U) & (m_slots.size() - 1U);
+            }
+            m_slots[slot] = key_index;
+        }
+    }
+
+    Key& interned = m_keys[key_index];
+    // Keys are added callback by callback, so a duplicate from the same callback is always at the head of the list
+    if (interned.first != NO_ENTRY && m_entries[interned.first].callback == callback_index) {
+        return true;
+    }
+    Entry entry;
+    entry.callback = callback_index;
+    entry.next = interned.first;
+    interned.first = m_entries.size();
+    m_entries.push_back(entry);
+    return true;
+}
+
+uint16_t Attribute_Key_Index::find(const char *key) const {
+    if (key == nullptr || m_slots.empty()) {
+        return NO_ENTRY;
+    }
+    const size_t length = strlen(key);
+    const uint16_t key_index = find_key(key, length, hash(key, length));
+    return key_index == NO_ENTRY ? NO_ENTRY : m_keys[key_index].first;
+}
+
+uint16_t Attribute_Key_Index::get_callback_index(const uint16_t& entry) const {
+    return m_entries[entry].callback;
+}
+
+uint16_t Attribute_Key_Index::get_next(const uint16_t& entry) const {
+    return m_entries[entry].next;
+}
+
+size_t Attribute_Key_Index::get_key_count() const {
+    return m_keys.size();
+}
+
+uint32_t Attribute_Key_Index::hash(const char *key, const size_t& length) {
+    uint32_t key_hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < length; i++) {
+        key_hash ^= static_cast<uint8_t>(key[i]);
+        key_hash *= FNV_PRIME;
+    }
+    return key_hash;
+}
+
+uint16_t Attribute_Key_Index::find_key(const char *key, const size_t& length, const uint32_t& key_hash) const {
+    const size_t mask = m_slots.size() - 1U;
+    // The table is never full, so an empty slot always ends the probe sequence
+    for (size_t slot = key_hash & mask; m_slots[slot] != NO_ENTRY; slot = (slot + 1U) & mask) {
+        const Key& interned = m_keys[m_slots[slot]];
+        if (interned.hash == key_hash && interned.length == length && memcmp(&m_characters[interned.offset], key, length) == 0) {
+            return m_slots[slot];
+        }
+    }
+    return NO_ENTRY;
+}
+
+void Attribute_Key_Index::rehash(const size_t& slot_count) {
+    m_slots.clear();
+    for (size_t i = 0; i < slot_count; i++) {
+        m_slots.push_back(NO_ENTRY);
+    }
+    const size_t mask = slot_count - 1U;
+    for (size_t key_index = 0; key_index < m_keys.size(); key_index++) {
+        size_t slot = m_keys[key_index].hash & mask;
+        while (m_slots[slot] != NO_ENTRY) {
+            slot = (slot + 1U) & mask;
+        }
+        m_slots[slot] = key_index;
+    }
+}
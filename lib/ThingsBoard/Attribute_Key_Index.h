@@ -0,0 +1,95 @@
+#ifndef Attribute_Key_Index_h
+#define Attribute_Key_Index_h
+
+// Local includes.
+#include "Configuration.h"
+#if !THINGSBOARD_ENABLE_STL
+#include "Vector.h"
+#endif // !THINGSBOARD_ENABLE_STL
+
+// Library includes.
+#include <stdint.h>
+#include <stddef.h>
+#if THINGSBOARD_ENABLE_STL
+#include <vector>
+#endif // THINGSBOARD_ENABLE_STL
+
+
+/// @brief Index from attribute key to the callbacks that subscribed to it, used to match incoming shared attribute updates.
+/// Every distinct key is interned once into a contiguous character table and found over a small open addressing hash table (FNV-1a, linear probing),
+/// each key then points to a linked list of the indexes of the callbacks that requested it. Matching an update with K keys therefore costs K lookups,
+/// independent of the amount of subscribed callbacks and without any String allocations. Adding keys allocates, looking them up does not,
+/// which is why the index is meant to be rebuilt whenever the subscribed callbacks change and then only read while messages are received
+class Attribute_Key_Index {
+  public:
+    /// @brief Returned by find() and get_next() if there is no (further) callback for the key
+    static constexpr uint16_t NO_ENTRY = UINT16_MAX;
+
+    /// @brief Constructor
+    Attribute_Key_Index();
+
+    /// @brief Removes all keys and callbacks, but keeps the allocated memory to be reused for the next build of the index
+    void clear();
+
+    /// @brief Adds the given key as requested by the callback with the given index. Keys have to be added callback by callback,
+    /// so that a key listed multiple times by the same callback only results in one entry
+    /// @param callback_index Index of the callback in the container it is stored in
+    /// @param key Key the callback wants to be informed about, does not need to be null-terminated
+    /// @param length Amount of characters in the key
+    /// @return Whether the key was added, fails if the index already contains the maximum amount of keys or callbacks
+    bool add(const uint16_t& callback_index, const char *key, const size_t& length);
+
+    /// @brief Looks up the given key
+    /// @param key Null-terminated key received from the server
+    /// @return Handle of the first callback that requested the key, or NO_ENTRY if no callback requested it
+    uint16_t find(const char *key) const;
+
+    /// @brief Gets the index of the callback a handle returned by find() or get_next() refers to
+    /// @param entry Handle that is not NO_ENTRY
+    /// @return Index of the callback in the container it is stored in
+    uint16_t get_callback_index(const uint16_t& entry) const;
+
+    /// @brief Gets the next callback that requested the same key
+    /// @param entry Handle that is not NO_ENTRY
+    /// @return Handle of the next callback, or NO_ENTRY if there is none
+    uint16_t get_next(const uint16_t& entry) const;
+
+    /// @brief Gets the amount of distinct keys in the index
+    /// @return Amount of interned keys
+    size_t get_key_count() const;
+
+  private:
+#if THINGSBOARD_ENABLE_STL
+    template<typename T>
+    using Vector = std::vector<T>;
+#endif // THINGSBOARD_ENABLE_STL
+
+    struct Key {
+        uint32_t hash;      // FNV-1a hash of the key, compared before the characters
+        uint32_t offset;    // Start of the key in m_characters
+        uint16_t length;    // Amount of characters in the key
+        uint16_t first;     // First entry in m_entries for this key
+    };
+
+    struct Entry {
+        uint16_t callback;  // Index of the callback that requested the key
+        uint16_t next;      // Next entry for the same key or NO_ENTRY
+    };
+
+    Vector<char> m_characters; // All interned keys, without null termination
+    Vector<Key> m_keys;        // Distinct keys in the order they were added
+    Vector<Entry> m_entries;   // Callback lists, one linked list per key
+    Vector<uint16_t> m_slots;  // Open addressing table of indexes into m_keys, size is always a power of two
+
+    /// @brief Calculates the FNV-1a hash of the given characters
+    static uint32_t hash(const char *key, const size_t& length);
+
+    /// @brief Searches the slot table for the given key
+    /// @return Index into m_keys or NO_ENTRY
+    uint16_t find_key(const char *key, const size_t& length, const uint32_t& key_hash) const;
+
+    /// @brief Recreates the slot table with the given amount of slots and inserts all keys again
+    void rehash(const size_t& slot_count);
+};
+
+#endif // Attribute_Key_Index_h
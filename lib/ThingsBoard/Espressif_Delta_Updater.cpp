@@ -0,0 +1,358 @@
+// Header include.
+#include "Espressif_Delta_Updater.h"
+
+#if THINGSBOARD_ENABLE_OTA
+
+#if THINGSBOARD_USE_ESP_PARTITION
+
+// Library includes.
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <sdkconfig.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if CONFIG_IDF_TARGET_ESP32
+#include <esp32/rom/miniz.h>
+#elif CONFIG_IDF_TARGET_ESP32S2
+#include <esp32s2/rom/miniz.h>
+#elif CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/rom/miniz.h>
+#elif CONFIG_IDF_TARGET_ESP32C3
+#include <esp32c3/rom/miniz.h>
+#endif
+
+constexpr char DELTA_MAGIC[] = "TBD1";
+// Inflate window, tools/delta_patch.py compresses with the same window (WINDOW_BITS = 12),
+// tinfl refuses streams whose header announces a larger one. Has to be a power of two
+constexpr size_t DELTA_DICTIONARY_SIZE = 4096U;
+constexpr size_t SHA256_SIZE = 32U;
+
+constexpr size_t Espressif_Delta_Updater::HEADER_SIZE;
+constexpr size_t Espressif_Delta_Updater::CONTROL_SIZE;
+constexpr size_t Espressif_Delta_Updater::SOURCE_BLOCK_SIZE;
+
+static uint32_t Read_Le32(const uint8_t *data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8U) | (static_cast<uint32_t>(data[2]) << 16U) | (static_cast<uint32_t>(data[3]) << 24U);
+}
+
+Espressif_Delta_Updater::Espressif_Delta_Updater() :
+    m_state(Patch_State::HEADER),
+    m_firmware_size(0U),
+    m_full_image(),
+    m_ota_handle(0U),
+    m_source_partition(nullptr),
+    m_update_partition(nullptr),
+    m_inflator(nullptr),
+    m_dictionary(nullptr),
+    m_dictionary_offset(0U),
+    m_inflate_done(false),
+    m_fields(),
+    m_fields_size(0U),
+    m_source_block(),
+    m_source_size(0U),
+    m_target_size(0U),
+    m_target_hash(),
+    m_source_offset(0U),
+    m_written(0U),
+    m_diff_remaining(0U),
+    m_extra_remaining(0U),
+    m_seek(0),
+    m_hash()
+{
+    // Nothing to do
+}
+
+Espressif_Delta_Updater::~Espressif_Delta_Updater() {
+    Release_Inflator();
+}
+
+bool Espressif_Delta_Updater::begin(const size_t& firmware_size) {
+    reset();
+    if (firmware_size < HEADER_SIZE) {
+        return false;
+    }
+
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *configured = esp_ota_get_boot_partition();
+
+    if (running == nullptr || configured != running) {
+        return false;
+    }
+
+    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(nullptr);
+
+    if (update_partition == nullptr) {
+        return false;
+    }
+
+    // Writing into the update partition only starts once the header showed the patch fits the running firmware
+    m_firmware_size = firmware_size;
+    m_source_partition = running;
+    m_update_partition = update_partition;
+    return true;
+}
+
+size_t Espressif_Delta_Updater::write(uint8_t* payload, const size_t& total_bytes) {
+    if (m_state == Patch_State::FAILED || m_update_partition == nullptr) {
+        return 0U;
+    }
+    if (m_state == Patch_State::FULL_IMAGE) {
+        return m_full_image.write(payload, total_bytes);
+    }
+
+    size_t consumed = 0U;
+    if (m_state == Patch_State::HEADER) {
+        consumed = HEADER_SIZE - m_fields_size;
+        if (consumed > total_bytes) {
+            consumed = total_bytes;
+        }
+        memcpy(m_fields + m_fields_size, payload, consumed);
+        m_fields_size += consumed;
+        if (m_fields_size < HEADER_SIZE) {
+            return total_bytes;
+        }
+        m_fields_size = 0U;
+        if (memcmp(m_fields, DELTA_MAGIC, 4U) != 0) {
+            if (!Start_Full_Image()) {
+                m_state = Patch_State::FAILED;
+                return 0U;
+            }
+            const size_t remaining = total_bytes - consumed;
+            return (m_full_image.write(payload + consumed, remaining) == remaining) ? total_bytes : 0U;
+        }
+        if (!Start_Patch()) {
+            m_state = Patch_State::FAILED;
+            return 0U;
+        }
+    }
+
+    if (!Inflate(payload + consumed, total_bytes - consumed)) {
+        m_state = Patch_State::FAILED;
+        return 0U;
+    }
+    return total_bytes;
+}
+
+void Espressif_Delta_Updater::reset() {
+    if (m_state == Patch_State::FULL_IMAGE) {
+        m_full_image.reset();
+    }
+    if (m_ota_handle != 0U) {
+        (void)esp_ota_abort(m_ota_handle);
+    }
+    Release_Inflator();
+    m_state = Patch_State::HEADER;
+    m_ota_handle = 0U;
+    m_source_partition = nullptr;
+    m_update_partition = nullptr;
+    m_fields_size = 0U;
+    m_inflate_done = false;
+}
+
+bool Espressif_Delta_Updater::end() {
+    if (m_state == Patch_State::FULL_IMAGE) {
+        // The OTA_Handler already compared the checksum of the complete binary, esp_ota_end() additionally validates the image
+        m_state = Patch_State::HEADER;
+        return m_full_image.end();
+    }
+
+    // The last record has to be complete, its seek already applied, and the zlib stream has to have ended with a matching Adler-32
+    const bool complete = m_state == Patch_State::CONTROL && m_fields_size == 0U && m_inflate_done && m_written == m_target_size;
+    Release_Inflator();
+
+    if (!complete || !Hash_Matches(m_target_hash)) {
+        reset();
+        return false;
+    }
+
+    esp_err_t error = esp_ota_end(m_ota_handle);
+    m_ota_handle = 0U;
+    if (error != ESP_OK) {
+        return false;
+    }
+
+    error = esp_ota_set_boot_partition(static_cast<const esp_partition_t*>(m_update_partition));
+    return error == ESP_OK;
+}
+
+bool Espressif_Delta_Updater::Start_Full_Image() {
+    if (!m_full_image.begin(m_firmware_size)) {
+        return false;
+    }
+    if (m_full_image.write(m_fields, HEADER_SIZE) != HEADER_SIZE) {
+        m_full_image.reset();
+        return false;
+    }
+    m_state = Patch_State::FULL_IMAGE;
+    return true;
+}
+
+bool Espressif_Delta_Updater::Start_Patch() {
+    const esp_partition_t *source = static_cast<const esp_partition_t*>(m_source_partition);
+    const esp_partition_t *update = static_cast<const esp_partition_t*>(m_update_partition);
+
+    m_source_size = Read_Le32(m_fields + 4U);
+    m_target_size = Read_Le32(m_fields + 8U);
+    if (memcmp(m_fields, DELTA_MAGIC, 4U) != 0 || m_source_size > source->size || m_target_size > update->size) {
+        return false;
+    }
+    memcpy(m_target_hash, m_fields + 12U + SHA256_SIZE, SHA256_SIZE);
+
+    // A patch only reconstructs the new firmware on top of exactly the image it was created from
+    m_hash.start(MBEDTLS_MD_SHA256);
+    for (uint32_t offset = 0U; offset < m_source_size; offset += SOURCE_BLOCK_SIZE) {
+        const size_t length = (m_source_size - offset < SOURCE_BLOCK_SIZE) ? m_source_size - offset : SOURCE_BLOCK_SIZE;
+        if (esp_partition_read(source, offset, m_source_block, length) != ESP_OK || !m_hash.update(m_source_block, length)) {
+            return false;
+        }
+    }
+    if (!Hash_Matches(m_fields + 12U)) {
+        return false;
+    }
+
+    m_inflator = malloc(sizeof(tinfl_decompressor));
+    m_dictionary = static_cast<uint8_t*>(malloc(DELTA_DICTIONARY_SIZE));
+    if (m_inflator == nullptr || m_dictionary == nullptr) {
+        return false;
+    }
+    tinfl_init(static_cast<tinfl_decompressor*>(m_inflator));
+
+    esp_ota_handle_t ota_handle;
+    if (esp_ota_begin(update, m_target_size, &ota_handle) != ESP_OK) {
+        return false;
+    }
+
+    m_ota_handle = ota_handle;
+    m_state = Patch_State::CONTROL;
+    m_dictionary_offset = 0U;
+    m_source_offset = 0U;
+    m_written = 0U;
+    m_hash.start(MBEDTLS_MD_SHA256);
+    return true;
+}
+
+bool Espressif_Delta_Updater::Inflate(const uint8_t *data, size_t length) {
+    while (!m_inflate_done) {
+        size_t in_bytes = length;
+        size_t out_bytes = DELTA_DICTIONARY_SIZE - m_dictionary_offset;
+        const tinfl_status status = tinfl_decompress(static_cast<tinfl_decompressor*>(m_inflator), data, &in_bytes, m_dictionary, m_dictionary + m_dictionary_offset, &out_bytes,
+                                                     TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        data += in_bytes;
+        length -= in_bytes;
+
+        if (status < TINFL_STATUS_DONE || !Apply_Records(m_dictionary + m_dictionary_offset, out_bytes)) {
+            return false;
+        }
+        m_dictionary_offset = (m_dictionary_offset + out_bytes) & (DELTA_DICTIONARY_SIZE - 1U);
+        m_inflate_done = status == TINFL_STATUS_DONE;
+
+        // Any other status means the dictionary was full and has to be applied before inflating the rest of the input
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            return true;
+        }
+    }
+    // Bytes after the end of the zlib stream would not be part of the image
+    return length == 0U;
+}
+
+bool Espressif_Delta_Updater::Apply_Records(const uint8_t *data, size_t length) {
+    while (length > 0U) {
+        size_t chunk = 0U;
+        switch (m_state) {
+            case Patch_State::CONTROL:
+                chunk = CONTROL_SIZE - m_fields_size;
+                if (chunk > length) {
+                    chunk = length;
+                }
+                memcpy(m_fields + m_fields_size, data, chunk);
+                m_fields_size += chunk;
+                if (m_fields_size == CONTROL_SIZE) {
+                    m_fields_size = 0U;
+                    m_diff_remaining = Read_Le32(m_fields);
+                    m_extra_remaining = Read_Le32(m_fields + 4U);
+                    m_seek = static_cast<int32_t>(Read_Le32(m_fields + 8U));
+                    if (m_diff_remaining > m_source_size - m_source_offset || m_diff_remaining > m_target_size - m_written || m_extra_remaining > m_target_size - m_written - m_diff_remaining) {
+                        return false;
+                    }
+                    m_state = Patch_State::DIFF;
+                }
+                break;
+            case Patch_State::DIFF:
+                chunk = (length < SOURCE_BLOCK_SIZE) ? length : SOURCE_BLOCK_SIZE;
+                if (chunk > m_diff_remaining) {
+                    chunk = m_diff_remaining;
+                }
+                if (esp_partition_read(static_cast<const esp_partition_t*>(m_source_partition), m_source_offset, m_source_block, chunk) != ESP_OK) {
+                    return false;
+                }
+                for (size_t i = 0U; i < chunk; i++) {
+                    m_source_block[i] += data[i];
+                }
+                if (!Write_Target(m_source_block, chunk)) {
+                    return false;
+                }
+                m_source_offset += chunk;
+                m_diff_remaining -= chunk;
+                break;
+            case Patch_State::EXTRA:
+                chunk = (length < m_extra_remaining) ? length : m_extra_remaining;
+                if (!Write_Target(data, chunk)) {
+                    return false;
+                }
+                m_extra_remaining -= chunk;
+                break;
+            default:
+                return false;
+        }
+        data += chunk;
+        length -= chunk;
+
+        if (!Advance_Record()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Espressif_Delta_Updater::Advance_Record() {
+    if (m_state == Patch_State::DIFF && m_diff_remaining == 0U) {
+        m_state = Patch_State::EXTRA;
+    }
+    if (m_state == Patch_State::EXTRA && m_extra_remaining == 0U) {
+        const int64_t source_offset = static_cast<int64_t>(m_source_offset) + m_seek;
+        if (source_offset < 0 || source_offset > m_source_size) {
+            return false;
+        }
+        m_source_offset = static_cast<uint32_t>(source_offset);
+        m_state = Patch_State::CONTROL;
+    }
+    return true;
+}
+
+bool Espressif_Delta_Updater::Write_Target(const uint8_t *data, const size_t& length) {
+    if (esp_ota_write(m_ota_handle, data, length) != ESP_OK || !m_hash.update(data, length)) {
+        return false;
+    }
+    m_written += length;
+    return true;
+}
+
+bool Espressif_Delta_Updater::Hash_Matches(const uint8_t *expected) {
+    char expected_string[SHA256_SIZE * 2U + 1U];
+    for (size_t i = 0U; i < SHA256_SIZE; i++) {
+        snprintf(expected_string + i * 2U, 3U, "%02x", expected[i]);
+    }
+    return m_hash.get_hash_string().compare(expected_string) == 0;
+}
+
+void Espressif_Delta_Updater::Release_Inflator() {
+    free(m_inflator);
+    free(m_dictionary);
+    m_inflator = nullptr;
+    m_dictionary = nullptr;
+}
+
+#endif // THINGSBOARD_USE_ESP_PARTITION
+
+#endif // THINGSBOARD_ENABLE_OTA
@@ -0,0 +1,111 @@
+#ifndef Espressif_Delta_Updater_h
+#define Espressif_Delta_Updater_h
+
+// Local include.
+#include "Configuration.h"
+
+#if THINGSBOARD_ENABLE_OTA
+
+#if THINGSBOARD_USE_ESP_PARTITION
+
+// Local includes.
+#include "IUpdater.h"
+#include "Espressif_Updater.h"
+#include "HashGenerator.h"
+
+
+/// @brief IUpdater implementation that receives a delta patch created with tools/delta_patch.py instead of the complete firmware binary.
+/// The patch describes the new firmware as its difference to the firmware that is currently running, releases that mostly leave the libraries untouched
+/// therefore only need to transfer a few percent of the image. The patch is applied while it is received, its body is inflated with the zlib decompressor in the ESP ROM
+/// and every record adds its diff bytes onto the bytes read from the running partition, the result is written into the next OTA partition
+/// with the Over the Air Update API from Espressif (https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/system/ota.html), like the Espressif_Updater does with a complete binary.
+/// The patch header contains the SHA-256 hash of both images, the running partition is hashed before anything is written to detect a patch that was created for another release,
+/// and the reconstructed image is hashed before it is marked as the boot partition. Both hashes use the HashGenerator, the patch itself is still verified by the OTA_Handler with the checksum sent by the server.
+/// A package that does not start with the patch magic is a complete firmware binary, it is handed to an Espressif_Updater unchanged,
+/// so the same updater can stay subscribed whether the server assigns a patch or a full image
+class Espressif_Delta_Updater : public IUpdater {
+  public:
+    Espressif_Delta_Updater();
+
+    ~Espressif_Delta_Updater();
+
+    bool begin(const size_t& firmware_size) override;
+
+    size_t write(uint8_t* payload, const size_t& total_bytes) override;
+
+    void reset() override;
+
+    bool end() override;
+
+  private:
+    static constexpr size_t HEADER_SIZE = 76U;      // Magic, source size, target size and the SHA-256 hash of both images
+    static constexpr size_t CONTROL_SIZE = 12U;     // Diff length, extra length and seek of one record
+    static constexpr size_t SOURCE_BLOCK_SIZE = 256U;
+
+    enum class Patch_State : const uint8_t {
+        HEADER,     // Collecting the uncompressed patch header
+        CONTROL,    // Collecting the control fields of the next record
+        DIFF,       // Adding inflated bytes onto the running partition
+        EXTRA,      // Copying inflated bytes as they are
+        FULL_IMAGE, // Package is a complete binary, passed on to m_full_image
+        FAILED      // Patch is invalid or writing failed, everything is ignored until reset() is called
+    };
+
+    Patch_State m_state;
+    size_t m_firmware_size;
+    Espressif_Updater m_full_image;
+    uint32_t m_ota_handle;
+    const void *m_source_partition;
+    const void *m_update_partition;
+    void *m_inflator;                           // ROM tinfl_decompressor, only allocated while a patch is applied
+    uint8_t *m_dictionary;                      // Circular inflate output, also holds the history back references point into
+    size_t m_dictionary_offset;
+    bool m_inflate_done;
+    uint8_t m_fields[HEADER_SIZE];              // Header or control fields that did not arrive in one piece
+    size_t m_fields_size;
+    uint8_t m_source_block[SOURCE_BLOCK_SIZE];  // Running partition bytes the current diff bytes are added onto
+    uint32_t m_source_size;
+    uint32_t m_target_size;
+    uint8_t m_target_hash[32U];
+    uint32_t m_source_offset;
+    uint32_t m_written;
+    uint32_t m_diff_remaining;
+    uint32_t m_extra_remaining;
+    int32_t m_seek;
+    HashGenerator m_hash;
+
+    /// @brief Checks the completely received header against the running partition and starts writing the next OTA partition
+    /// @return Whether the patch was created for the running firmware and the update could be started
+    bool Start_Patch();
+
+    /// @brief Starts writing a package without the patch magic as a complete binary, beginning with the already received header bytes
+    /// @return Whether the update could be started and the header bytes were written
+    bool Start_Full_Image();
+
+    /// @brief Inflates the given part of the patch body and applies the resulting records
+    /// @return Whether the data was valid and the output could be written
+    bool Inflate(const uint8_t *data, size_t length);
+
+    /// @brief Applies the given inflated bytes, which may end in the middle of a record
+    /// @return Whether all records were in bounds and the output could be written
+    bool Apply_Records(const uint8_t *data, size_t length);
+
+    /// @brief Moves on to the next part of the record once the current one is done
+    /// @return Whether the source position stayed inside of the running image
+    bool Advance_Record();
+
+    /// @brief Writes reconstructed bytes into the next OTA partition and adds them to the hash
+    bool Write_Target(const uint8_t *data, const size_t& length);
+
+    /// @brief Compares the hash calculated by m_hash with the given SHA-256 hash from the patch header
+    bool Hash_Matches(const uint8_t *expected);
+
+    /// @brief Frees the inflate state and dictionary
+    void Release_Inflator();
+};
+
+#endif // THINGSBOARD_USE_ESP_PARTITION
+
+#endif // THINGSBOARD_ENABLE_OTA
+
+#endif // Espressif_Delta_Updater_h
@@ -8,6 +8,10 @@
 // Therefore we have to check if the value is smaller or equal to the MQTT_FAILURE_MESSAGE_ID,
 // to ensure other errors are indentified as well
 constexpr int MQTT_FAILURE_MESSAGE_ID = -1;
+// Bits of m_connection_events, the failure bit is set by the disconnected event that follows every failed connection attempt
+constexpr EventBits_t MQTT_CONNECTED_BIT = BIT0;
+constexpr EventBits_t MQTT_DISCONNECTED_BIT = BIT1;
+constexpr uint16_t DEFAULT_CONNECT_TIMEOUT = 10000U;
 
 Espressif_MQTT_Client *Espressif_MQTT_Client::m_instance = nullptr;
 
@@ -16,7 +20,10 @@ Espressif_MQTT_Client::Espressif_MQTT_Client() :
     m_connected(false),
     m_enqueue_messages(false),
     m_mqtt_configuration(),
-    m_mqtt_client(nullptr)
+    m_mqtt_client(nullptr),
+    m_connection_events(xEventGroupCreate()),
+    m_connect_timeout(DEFAULT_CONNECT_TIMEOUT),
+    m_receive_queue(nullptr)
 {
     m_instance = this;
 }
@@ -24,6 +31,10 @@ Espressif_MQTT_Client::Espressif_MQTT_Client() :
 Espressif_MQTT_Client::~Espressif_MQTT_Client() {
     m_instance = nullptr;
     (void)esp_mqtt_client_destroy(m_mqtt_client);
+    vEventGroupDelete(m_connection_events);
+    if (m_receive_queue != nullptr) {
+        vRingbufferDelete(m_receive_queue);
+    }
 }
 
 bool Espressif_MQTT_Client::set_server_certificate(const char *server_certificate_pem) {
@@ -104,27 +115,80 @@ void Espressif_MQTT_Client::set_enqueue_messages(const bool& enqueue_messages) {
     m_enqueue_messages = enqueue_messages;
 }
 
+void Espressif_MQTT_Client::set_connect_timeout(const uint16_t& connect_timeout_milliseconds) {
+    m_connect_timeout = connect_timeout_milliseconds;
+}
+
+bool Espressif_MQTT_Client::set_receive_queue_size(const size_t& receive_queue_size) {
+    if (m_mqtt_client != nullptr) {
+        return false;
+    }
+    if (m_receive_queue != nullptr) {
+        vRingbufferDelete(m_receive_queue);
+        m_receive_queue = nullptr;
+    }
+    if (receive_queue_size == 0U) {
+        return true;
+    }
+    m_receive_queue = xRingbufferCreate(receive_queue_size, RINGBUF_TYPE_NOSPLIT);
+    return m_receive_queue != nullptr;
+}
+
 void Espressif_MQTT_Client::set_callback(function callback) {
     m_received_data_callback = callback;
 }
 
 bool Espressif_MQTT_Client::set_buffer_size(const uint16_t& buffer_size) {
+    // esp_mqtt_set_config() adjusts the underlying mqtt client to the changed values, but not the buffer_size,
+    // this results in the buffer size only being able to be changed when initally creating the mqtt client.
+    // If the mqtt client is reinitalized this causes disconnected and reconnects tough and the connection becomes unstable.
+    // Therefore this workaround can also not be used, instead we report the failure, so the caller knows messages bigger than the current buffer
+    // are still received in multiple parts, which are discarded, and can for example request smaller OTA chunks instead.
+    // See https://github.com/espressif/esp-mqtt/issues/267 for more information on the issue 
+    if (m_mqtt_client != nullptr && buffer_size != get_buffer_size()) {
+        return false;
+    }
+
     // ESP_IDF_VERSION_MAJOR Version 5 is a major breaking changes were the complete esp_mqtt_client_config_t structure changed completely
 #if ESP_IDF_VERSION_MAJOR < 5
     m_mqtt_configuration.buffer_size = buffer_size;
 #else
     m_mqtt_configuration.buffer.size = buffer_size;
 #endif // ESP_IDF_VERSION_MAJOR < 5
+    return update_configuration();
+}
 
-    // Calls esp_mqtt_set_config(), which should adjust the underlying mqtt client to the changed values.
-    // Which it does but not for the buffer_size, this results in the buffer size only being able to be changed when initally creating the mqtt client.
-    // If the mqtt client is reinitalized this causes disconnected and reconnects tough and the connection becomes unstable.
-    // Therefore this workaround can also not be used. Instead we expect the esp_mqtt_set_config(), to do what the name implies and therefore still call it
-    // and created an issue revolving around the aformentioned problem so it might get fixed in future version of the esp_mqtt client.
-    // See https://github.com/espressif/esp-mqtt/issues/267 for more information on the issue 
+bool Espressif_MQTT_Client::set_protocol_version(const uint8_t& version) {
+    // ESP_IDF_VERSION_MAJOR Version 5 is a major breaking changes were the complete esp_mqtt_client_config_t structure changed completely
+#if ESP_IDF_VERSION_MAJOR < 5
+    if (version != 4U) {
+        return false;
+    }
+    m_mqtt_configuration.protocol_ver = MQTT_PROTOCOL_V_3_1_1;
+#else
+    if (version == 4U) {
+        m_mqtt_configuration.session.protocol_ver = MQTT_PROTOCOL_V_3_1_1;
+    }
+#if CONFIG_MQTT_PROTOCOL_5
+    else if (version == 5U) {
+        m_mqtt_configuration.session.protocol_ver = MQTT_PROTOCOL_V_5;
+    }
+#endif // CONFIG_MQTT_PROTOCOL_5
+    else {
+        return false;
+    }
+#endif // ESP_IDF_VERSION_MAJOR < 5
     return update_configuration();
 }
 
+uint8_t Espressif_MQTT_Client::get_protocol_version() {
+#if ESP_IDF_VERSION_MAJOR >= 5 && CONFIG_MQTT_PROTOCOL_5
+    return m_mqtt_configuration.session.protocol_ver == MQTT_PROTOCOL_V_5 ? 5U : 4U;
+#else
+    return 4U;
+#endif // ESP_IDF_VERSION_MAJOR >= 5 && CONFIG_MQTT_PROTOCOL_5
+}
+
 uint16_t Espressif_MQTT_Client::get_buffer_size() {
     // ESP_IDF_VERSION_MAJOR Version 5 is a major breaking changes were the complete esp_mqtt_client_config_t structure changed completely
 #if ESP_IDF_VERSION_MAJOR < 5
@@ -171,15 +235,31 @@ bool Espressif_MQTT_Client::connect(const char *client_id, const char *user_name
     m_mqtt_configuration.credentials.username = user_name;
     m_mqtt_configuration.credentials.authentication.password = password;
 #endif // ESP_IDF_VERSION_MAJOR < 5
+    // Messages still queued from the previous session answer requests that session made, they are not handed to the callback anymore
+    if (m_receive_queue != nullptr) {
+        size_t item_size = 0U;
+        void *item = nullptr;
+        while ((item = xRingbufferReceive(m_receive_queue, &item_size, 0)) != nullptr) {
+            vRingbufferReturnItem(m_receive_queue, item);
+        }
+    }
+
     // Update configuration is called to ensure that if we connected previously and call connect again with other credentials,
     // then we also update the client_id, username and password we connect with. Especially important for the provisioning workflow to work correctly
     update_configuration();
+    (void)xEventGroupClearBits(m_connection_events, MQTT_CONNECTED_BIT | MQTT_DISCONNECTED_BIT);
 
     // Check wheter the client has been initalzed before already, it it has we do not want to reinitalize,
     // but simply force reconnection with the client because it has lost that connection
     if (m_mqtt_client != nullptr) {
-        const esp_err_t error = esp_mqtt_client_reconnect(m_mqtt_client);
-        return error == ESP_OK;
+        esp_err_t error = esp_mqtt_client_reconnect(m_mqtt_client);
+        // Reconnecting only works while the client task waits for its next automatic attempt,
+        // with auto reconnect disabled or after disconnect() the task has to be restarted instead
+        if (error != ESP_OK) {
+            (void)esp_mqtt_client_stop(m_mqtt_client);
+            error = esp_mqtt_client_start(m_mqtt_client);
+        }
+        return error == ESP_OK && wait_for_connection();
     }
 
     // The client is first initalized once the connect has actually been called, this is done because the passed setting are required for the client inizialitation structure,
@@ -195,7 +275,7 @@ bool Espressif_MQTT_Client::connect(const char *client_id, const char *user_name
     }
 
     error = esp_mqtt_client_start(m_mqtt_client);
-    return error == ESP_OK;
+    return error == ESP_OK && wait_for_connection();
 }
 
 void Espressif_MQTT_Client::disconnect() {
@@ -203,16 +283,32 @@ void Espressif_MQTT_Client::disconnect() {
 }
 
 bool Espressif_MQTT_Client::loop() {
-    // Unused because the esp mqtt client uses its own task to handle receiving and sending of data, therefore we do not need to do anything in the loop method.
+    // The esp mqtt client uses its own task to handle receiving and sending of data, therefore the loop method only has to hand over the messages in the receive queue, if there is one.
     // Because the loop method is meant for clients that do not have their own process method but instead rely on the upper level code calling a loop method to provide processsing time.
+    if (m_receive_queue != nullptr) {
+        size_t item_size = 0U;
+        uint8_t *item = nullptr;
+        while ((item = static_cast<uint8_t*>(xRingbufferReceive(m_receive_queue, &item_size, 0))) != nullptr) {
+            char *topic = reinterpret_cast<char*>(item);
+            const size_t topic_size = strlen(topic) + 1U;
+            if (m_received_data_callback != nullptr) {
+                m_received_data_callback(topic, item + topic_size, item_size - topic_size);
+            }
+            vRingbufferReturnItem(m_receive_queue, item);
+        }
+    }
     return m_connected;
 }
 
 bool Espressif_MQTT_Client::publish(const char *topic, const uint8_t *payload, const size_t& length) {
+    return publish(topic, payload, length, 0U);
+}
+
+bool Espressif_MQTT_Client::publish(const char *topic, const uint8_t *payload, const size_t& length, const uint8_t& qos) {
     int message_id = MQTT_FAILURE_MESSAGE_ID;
 
     if (m_enqueue_messages) {
-        message_id = esp_mqtt_client_enqueue(m_mqtt_client, topic, reinterpret_cast<const char*>(payload), length, 0U, 0U, true);
+        message_id = esp_mqtt_client_enqueue(m_mqtt_client, topic, reinterpret_cast<const char*>(payload), length, qos, 0U, true);
         return message_id > MQTT_FAILURE_MESSAGE_ID;
     }
 
@@ -222,7 +318,7 @@ bool Espressif_MQTT_Client::publish(const char *topic, const uint8_t *payload, c
     // to ensure the sending is done in the mqtt event context instead of the users task context.
     // Allows to use the publish method without having to worry about any CPU overhead, so it can even be used in callbacks or high priority tasks, without starving other tasks,
     // but compared to the other method esp_mqtt_client_enqueue() requires to save the message in the outbox, which increases the memory requirements for the internal buffer size
-    message_id = esp_mqtt_client_publish(m_mqtt_client, topic, reinterpret_cast<const char*>(payload), length, 0U, 0U);
+    message_id = esp_mqtt_client_publish(m_mqtt_client, topic, reinterpret_cast<const char*>(payload), length, qos, 0U);
     return message_id > MQTT_FAILURE_MESSAGE_ID;
 }
 
@@ -240,6 +336,14 @@ bool Espressif_MQTT_Client::connected() {
     return m_connected;
 }
 
+bool Espressif_MQTT_Client::wait_for_connection() {
+    if (m_connect_timeout == 0U) {
+        return true;
+    }
+    const EventBits_t bits = xEventGroupWaitBits(m_connection_events, MQTT_CONNECTED_BIT | MQTT_DISCONNECTED_BIT, pdFALSE, pdFALSE, pdMS_TO_TICKS(m_connect_timeout));
+    return (bits & MQTT_CONNECTED_BIT) != 0;
+}
+
 bool Espressif_MQTT_Client::update_configuration() {
     // Check if the client has been initalized, because if it did not the value should still be nullptr
     // and updating the config makes no sense because the changed settings will be applied anyway when the client is first intialized
@@ -257,9 +361,11 @@ void Espressif_MQTT_Client::mqtt_event_handler(void *handler_args, esp_event_bas
     switch (event_id) {
         case esp_mqtt_event_id_t::MQTT_EVENT_CONNECTED:
             m_connected = true;
+            (void)xEventGroupSetBits(m_connection_events, MQTT_CONNECTED_BIT);
             break;
         case esp_mqtt_event_id_t::MQTT_EVENT_DISCONNECTED:
             m_connected = false;
+            (void)xEventGroupSetBits(m_connection_events, MQTT_DISCONNECTED_BIT);
             break;
         case esp_mqtt_event_id_t::MQTT_EVENT_SUBSCRIBED:
             // Nothing to do
@@ -277,8 +383,25 @@ void Espressif_MQTT_Client::mqtt_event_handler(void *handler_args, esp_event_bas
                 break;
             }
 
-            if (m_received_data_callback != nullptr) {
-                m_received_data_callback(event->topic, reinterpret_cast<uint8_t*>(event->data), event->data_len);
+            if (m_receive_queue != nullptr) {
+                // Copied as the null-terminated topic directly followed by the payload, loop() hands it to the callback.
+                // A full queue discards the message, the same as a message that is received in multiple chunks
+                void *item = nullptr;
+                if (xRingbufferSendAcquire(m_receive_queue, &item, event->topic_len + 1U + event->data_len, 0) != pdTRUE) {
+                    break;
+                }
+                uint8_t *bytes = static_cast<uint8_t*>(item);
+                memcpy(bytes, event->topic, event->topic_len);
+                bytes[event->topic_len] = '\0';
+                memcpy(bytes + event->topic_len + 1U, event->data, event->data_len);
+                (void)xRingbufferSendComplete(m_receive_queue, item);
+            } else if (m_received_data_callback != nullptr) {
+                // The topic points into the receive buffer directly followed by the payload and is therefore not null-terminated,
+                // copy it so the callback and the topic comparisons in ThingsBoard only see the topic itself
+                char topic[event->topic_len + 1U];
+                memcpy(topic, event->topic, event->topic_len);
+                topic[event->topic_len] = '\0';
+                m_received_data_callback(topic, reinterpret_cast<uint8_t*>(event->data), event->data_len);
             }
             break;
         case esp_mqtt_event_id_t::MQTT_EVENT_ERROR:
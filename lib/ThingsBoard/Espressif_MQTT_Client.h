@@ -11,6 +11,10 @@
 
 // Library includes.
 #include <mqtt_client.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/ringbuf.h>
 
 
 /// @brief MQTT Client interface implementation that uses the offical ESP MQTT client from Espressif (https://github.com/espressif/esp-mqtt),
@@ -87,6 +91,22 @@ class Espressif_MQTT_Client : public IMQTT_Client {
     /// @param enqueue_messages Whether to enqueue published messages or not, where setting the value to true means that the messages are enqueued and therefor non blocking on the called from task
     void set_enqueue_messages(const bool& enqueue_messages);
 
+    /// @brief Sets how long connect() waits for the MQTT client task to report the outcome of the connection attempt.
+    /// The underlying client connects asynchronously on its own task, waiting allows connect() to keep the same meaning as for the blocking clients,
+    /// so the subscriptions ThingsBoard sends directly afterwards are not rejected because the client has not connected yet.
+    /// Setting the value to 0 returns directly after the connection attempt has been started, default = 10000 milliseconds
+    /// @param connect_timeout_milliseconds Maximum time connect() blocks the calling task
+    void set_connect_timeout(const uint16_t& connect_timeout_milliseconds);
+
+    /// @brief Sets whether received messages are handed to the callback from the MQTT client task or from loop().
+    /// By default the callback is called from the MQTT client task, which means ThingsBoard is used from that task and from the task that owns it at the same time.
+    /// With a receive queue every received message is instead copied into a ring buffer and only handed to the callback once loop() is called, from the task that calls it,
+    /// like with the blocking clients. Messages that do not fit into the free part of the queue are discarded, so it should hold a few messages of the internal buffer size,
+    /// for example as many OTA chunks as are requested at once. Has to be called before connecting
+    /// @param receive_queue_size Size of the ring buffer in bytes, 0 hands received messages to the callback from the MQTT client task directly, default = 0
+    /// @return Whether creating the ring buffer was successful or not
+    bool set_receive_queue_size(const size_t& receive_queue_size);
+
     void set_callback(function callback) override;
 
     bool set_buffer_size(const uint16_t& buffer_size) override;
@@ -95,6 +115,11 @@ class Espressif_MQTT_Client : public IMQTT_Client {
 
     void set_server(const char *domain, const uint16_t& port) override;
 
+    /// esp-mqtt only supports MQTT 5 from Espressif IDF v5 on, with CONFIG_MQTT_PROTOCOL_5 enabled, and does not fall back to 3.1.1 on its own
+    bool set_protocol_version(const uint8_t& version) override;
+
+    uint8_t get_protocol_version() override;
+
     bool connect(const char *client_id, const char *user_name, const char *password) override;
 
     void disconnect() override;
@@ -103,6 +128,12 @@ class Espressif_MQTT_Client : public IMQTT_Client {
 
     bool publish(const char *topic, const uint8_t *payload, const size_t& length) override;
 
+    /// @brief Publishes with the given QoS level instead of QoS 0. QoS 1 messages stay in the outbox of the MQTT client until the broker acknowledged them,
+    /// and are sent again after a reconnect, or until they expire (CONFIG_MQTT_OUTBOX_EXPIRED_TIMEOUT_MS)
+    /// @param qos QoS level of the message, 0 or 1
+    /// @return Whether the message was sent or enqueued successfully
+    bool publish(const char *topic, const uint8_t *payload, const size_t& length, const uint8_t& qos);
+
     bool subscribe(const char *topic) override;
 
     bool unsubscribe(const char *topic) override;
@@ -115,6 +146,9 @@ private:
     bool m_enqueue_messages;                       // Whether we enqueue messages making nearly all ThingsBoard calls non blocking or wheter we publish instead
     esp_mqtt_client_config_t m_mqtt_configuration; // Configuration of the underlying mqtt client, saved as a private variable to allow changes after inital configuration with the same options for all non changed settings
     esp_mqtt_client_handle_t m_mqtt_client;        // Handle to the underlying mqtt client, used to establish the communication
+    EventGroupHandle_t m_connection_events;        // Set from the mqtt client task once a connection attempt succeeded or failed, connect() waits on it
+    uint16_t m_connect_timeout;                    // Maximum time in milliseconds connect() waits for one of the connection events
+    RingbufHandle_t m_receive_queue;               // Received messages waiting for loop(), each one the null-terminated topic directly followed by the payload, nullptr to call the callback from the MQTT client task
 
     static Espressif_MQTT_Client *m_instance;      // Instance to the created class, will be set once the constructor has been called and reset once the destructor has been called, used to call private member method from static callback
 
@@ -124,6 +158,10 @@ private:
     /// @return Whether updating the configuration with the changed settings was successfull or not
     bool update_configuration();
 
+    /// @brief Blocks the calling task until the mqtt client task reports that the connection attempt started by connect() succeeded or failed, or m_connect_timeout elapsed
+    /// @return Whether the client is connected
+    bool wait_for_connection();
+
     /// @brief Event handler registered to receive MQTT events. Is called by the MQTT client event loop, whenever a new event occurs
     /// @param handler_args User data registered to the event
     /// @param base Event base for the handler
@@ -19,11 +19,12 @@ HashGenerator::~HashGenerator(void) {
 }
 
 void HashGenerator::start(const mbedtls_md_type_t& type) {
-    // MBEDTLS Version 3 is a major breaking changes were accessing the internal structures requires the MBEDTLS_PRIVATE macro
+    // MBEDTLS Version 3 is a major breaking changes were accessing the internal structures requires the MBEDTLS_PRIVATE macro.
+    // The hmac context is never allocated, because the context is setup without hmac, so only the md_info shows whether a previous hash has to be freed
 #if MBEDTLS_VERSION_MAJOR < 3
-    if (m_ctx.hmac_ctx != nullptr && m_ctx.md_ctx != nullptr && m_ctx.md_info != nullptr) {
+    if (m_ctx.md_info != nullptr) {
 #else
-    if (m_ctx.MBEDTLS_PRIVATE(hmac_ctx) != nullptr && m_ctx.MBEDTLS_PRIVATE(md_ctx) != nullptr && m_ctx.MBEDTLS_PRIVATE(md_info) != nullptr) {
+    if (m_ctx.MBEDTLS_PRIVATE(md_info) != nullptr) {
 #endif
         mbedtls_md_free(&m_ctx);
     }
@@ -71,6 +71,17 @@ class IMQTT_Client {
     /// See https://stackoverflow.blog/2020/12/14/security-considerations-for-ota-software-updates-for-iot-gateway-devices/ for more information on the aforementioned security risk
     virtual void set_server(const char *domain, const uint16_t& port) = 0;
 
+    /// @brief Selects the MQTT protocol level used by the next call to connect(), 4 for MQTT 3.1.1 or 5 for MQTT 5.
+    /// With MQTT 5 the client may send repeated publish topics as topic aliases, which saves most of the topic bytes on every message after the first one.
+    /// Implementations that can detect a broker refusing protocol level 5 should fall back to 3.1.1 on their own
+    /// @param version Protocol level that should be requested from the broker
+    /// @return Whether the given protocol level is supported by the client
+    virtual bool set_protocol_version(const uint8_t& version) = 0;
+
+    /// @brief Gets the protocol level of the current or last connection, which can be lower than requested after a fallback
+    /// @return Protocol level, 4 for MQTT 3.1.1 or 5 for MQTT 5
+    virtual uint8_t get_protocol_version() = 0;
+
     /// @brief Connects to the previously with set_server configured server instance that should be connected to over the previously defined port
     /// @param id Client identification code, that allows to differentiate which MQTT device is sending the traffic to the MQTT broker
     /// @param user Client username that is used to authenticate, who is connecting over MQTT
@@ -13,6 +13,11 @@
 #include "OTA_Update_Callback.h"
 #include "OTA_Failure_Response.h"
 
+// Library includes.
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
 
 /// ---------------------------------
 /// Constant strings in flash memory.
@@ -86,8 +91,13 @@ class OTA_Handler {
         , m_fw_checksum()
         , m_fw_checksum_algorithm()
         , m_hash()
+        , m_chunk_size(0U)
         , m_total_chunks(0U)
         , m_requested_chunks(0U)
+        , m_next_request(0U)
+        , m_window(1U)
+        , m_reorder_buffer()
+        , m_reorder_lengths()
         , m_retries(0U)
         , m_watchdog(std::bind(&OTA_Handler::Handle_Request_Timeout, this))
     {
@@ -100,10 +110,14 @@ class OTA_Handler {
     /// @param fw_algorithm String of the algorithm type used to hash the firmware binary
     /// @param fw_checksum Checksum of the complete firmware binary, should be the same as the actually written data in the end
     /// @param fw_checksum_algorithm Algorithm type used to hash the firmware binary
-    inline void Start_Firmware_Update(const OTA_Update_Callback *fw_callback, const size_t& fw_size, const std::string& fw_algorithm, const std::string& fw_checksum, const mbedtls_md_type_t& fw_checksum_algorithm) {
+    /// @param chunk_size Size of the chunks that are requested, might be smaller than the one configured in the callback if the receive buffer of the client could not fit those
+    inline void Start_Firmware_Update(const OTA_Update_Callback *fw_callback, const size_t& fw_size, const std::string& fw_algorithm, const std::string& fw_checksum, const mbedtls_md_type_t& fw_checksum_algorithm, const uint16_t& chunk_size) {
         m_fw_callback = fw_callback;
         m_fw_size = fw_size;
-        m_total_chunks = (m_fw_size / m_fw_callback->Get_Chunk_Size()) + 1U;
+        m_chunk_size = chunk_size;
+        m_total_chunks = (m_fw_size / m_chunk_size) + 1U;
+        m_window = (m_fw_callback->Get_Request_Window() > 0U) ? m_fw_callback->Get_Request_Window() : 1U;
+        Release_Reorder_Buffer();
         m_fw_algorithm = fw_algorithm;
         m_fw_checksum = fw_checksum;
         m_fw_checksum_algorithm = fw_checksum_algorithm;
@@ -130,59 +144,43 @@ class OTA_Handler {
     }
 
     /// @brief Uses the given firmware packet data and process it. Starting with writing the given amount of bytes of the packet data into flash memory and
-    /// into a hash function that will be used to compare the expected complete binary file and the actually received binary file
+    /// into a hash function that will be used to compare the expected complete binary file and the actually received binary file.
+    /// Multiple chunks are requested at once, a chunk that arrives before the one that has to be written next is kept in the reorder buffer until it is its turn
     /// @param current_chunk Index of the chunk we recieved the binary data for
-    /// @param payload Firmware packet data of the current chunk
+    /// @param payload Firmware packet data of the current chunk, may point directly into the receive buffer of the client,
+    /// which some clients reuse to send messages, therefore nothing is published before the payload has been written or buffered
     /// @param total_bytes Amount of bytes in the current firmware packet data
     inline void Process_Firmware_Packet(const size_t& current_chunk, uint8_t *payload, const size_t& total_bytes) {
-        (void)m_send_fw_state_callback(FW_STATE_DOWNLOADING, nullptr);
-
-        if (current_chunk != m_requested_chunks) {
+        // Chunks outside of the outstanding requests are late responses to requests that have been retried in the meantime
+        if (current_chunk < m_requested_chunks || current_chunk >= m_next_request || total_bytes > m_chunk_size) {
           char message[Helper::detectSize(RECEIVED_UNEXPECTED_CHUNK, current_chunk, m_requested_chunks)];
           snprintf_P(message, sizeof(message), RECEIVED_UNEXPECTED_CHUNK, current_chunk, m_requested_chunks);
           Logger::log(message);
           return;
         }
-
-        m_watchdog.detach();
-
-        char message[Helper::detectSize(FW_CHUNK, current_chunk, total_bytes)];
-        snprintf_P(message, sizeof(message), FW_CHUNK, current_chunk, total_bytes);
-        Logger::log(message);
-
-        if (current_chunk == 0U) {
-            // Initialize Flash
-            if (!m_fw_updater->begin(m_fw_size)) {
-              Logger::log(ERROR_UPDATE_BEGIN);
-              (void)m_send_fw_state_callback(FW_STATE_FAILED, ERROR_UPDATE_BEGIN);
-              return Handle_Failure(OTA_Failure_Response::RETRY_UPDATE);
-            }
+        else if (current_chunk != m_requested_chunks) {
+          Buffer_Firmware_Packet(current_chunk, payload, total_bytes);
+          (void)m_send_fw_state_callback(FW_STATE_DOWNLOADING, nullptr);
+          return;
         }
 
-        // Write received binary data to flash partition
-        const size_t written_bytes = m_fw_updater->write(payload, total_bytes);
-        if (written_bytes != total_bytes) {
-            char message[Helper::detectSize(ERROR_UPDATE_WRITE, written_bytes, total_bytes)];
-            snprintf_P(message, sizeof(message), ERROR_UPDATE_WRITE, written_bytes, total_bytes);
-            Logger::log(message);
-            (void)m_send_fw_state_callback(FW_STATE_FAILED, message);
-            return Handle_Failure(OTA_Failure_Response::RETRY_UPDATE);
-        }
+        m_watchdog.detach();
 
-        // Update value only if writing to flash was a success
-        if (!m_hash.update(payload, total_bytes)) {
-            Logger::log(UPDATING_HASH_FAILED);
-            (void)m_send_fw_state_callback(FW_STATE_FAILED, UPDATING_HASH_FAILED);
-            return Handle_Failure(OTA_Failure_Response::RETRY_UPDATE);
+        if (!Write_Firmware_Packet(current_chunk, payload, total_bytes)) {
+          return;
         }
 
-        m_requested_chunks = current_chunk + 1;
-        m_fw_callback->Call_Progress_Callback<Logger>(m_requested_chunks, m_total_chunks);
-
-        // Ensure to check if the update was cancelled during the progress callback,
-        // if it was the callback variable was reset and there is no need to request the next firmware packet
-        if (m_fw_callback == nullptr) {
-          return;
+        // Write the chunks that arrived early and directly follow the one we just wrote
+        while (!m_reorder_lengths.empty() && m_requested_chunks < m_next_request) {
+          const size_t slot = m_requested_chunks % m_window;
+          const size_t length = m_reorder_lengths[slot];
+          if (length == SIZE_MAX) {
+            break;
+          }
+          m_reorder_lengths[slot] = SIZE_MAX;
+          if (!Write_Firmware_Packet(m_requested_chunks, &m_reorder_buffer[slot * m_chunk_size], length)) {
+            return;
+          }
         }
 
         // Reset retries as the current chunk has been downloaded and handled successfully
@@ -201,14 +199,21 @@ class OTA_Handler {
     mbedtls_md_type_t m_fw_checksum_algorithm;                                // Algorithm type used to hash the firmware binary
     IUpdater *m_fw_updater;                                                   // Interface implementation that writes received firmware binary data onto the given device
     HashGenerator m_hash;                                                     // Class instance that allows to generate a hash from received firmware binary data
+    uint16_t m_chunk_size;                                                    // Size of the requested chunks, only the last chunk can be smaller
     size_t m_total_chunks;                                                    // Total amount of chunks that need to be received to get the complete firmware binary
     size_t m_requested_chunks;                                                // Amount of successfully requested and received firmware binary chunks
+    size_t m_next_request;                                                    // Index of the next chunk that will be requested, everything between m_requested_chunks and this index is outstanding
+    size_t m_window;                                                          // Maximum amount of outstanding chunk requests
+    std::vector<uint8_t> m_reorder_buffer;                                    // One slot of m_chunk_size bytes per outstanding request, holds chunks that arrived before the one that has to be written next
+    std::vector<size_t> m_reorder_lengths;                                    // Amount of bytes in each slot of the reorder buffer, SIZE_MAX if the slot is empty
     uint8_t m_retries;                                                        // Amount of request retries we attempt for each chunk, increasing makes the connection more stable
     Callback_Watchdog m_watchdog;                                             // Class instances that allows to timeout if we do not receive a response for a requested chunk in the given time
 
     /// @brief Restarts or starts the firmware update and its needed components and then requests the first firmware chunk
     inline void Request_First_Firmware_Packet() {
         m_requested_chunks = 0U;
+        m_next_request = 0U;
+        m_reorder_lengths.assign(m_reorder_lengths.size(), SIZE_MAX);
         m_retries = m_fw_callback->Get_Chunk_Retries();
         m_hash.start(m_fw_checksum_algorithm);
         m_watchdog.detach();
@@ -216,8 +221,8 @@ class OTA_Handler {
         Request_Next_Firmware_Packet();
     }
 
-    /// @brief Requests the next firmware chunk of the OTA firmware if there are any left
-    /// and starts the timer that ensures we request the same chunk again if we have not received a response yet
+    /// @brief Requests the next firmware chunks of the OTA firmware if there are any left, until the window of outstanding requests is full again,
+    /// and starts the timer that ensures we request the outstanding chunks again if we have not received a response yet
     inline void Request_Next_Firmware_Packet() {
         // Check if we have already requested and handled the last remaining chunk
         if (m_requested_chunks >= m_total_chunks) {
@@ -225,9 +230,14 @@ class OTA_Handler {
             return;
         }
 
-        if (!m_publish_callback(m_requested_chunks)) {
-          Logger::log(UNABLE_TO_REQUEST_CHUNCKS);
-          (void)m_send_fw_state_callback(FW_STATE_FAILED, UNABLE_TO_REQUEST_CHUNCKS);
+        while (m_next_request < m_total_chunks && m_next_request < m_requested_chunks + m_window) {
+            // Chunks that are already in the reorder buffer do not need to be requested again after a timeout
+            if (!Is_Firmware_Packet_Buffered(m_next_request) && !m_publish_callback(m_next_request)) {
+              Logger::log(UNABLE_TO_REQUEST_CHUNCKS);
+              (void)m_send_fw_state_callback(FW_STATE_FAILED, UNABLE_TO_REQUEST_CHUNCKS);
+              break;
+            }
+            m_next_request++;
         }
 
         // Watchdog gets started no matter if publishing request was successful or not in hopes,
@@ -235,6 +245,89 @@ class OTA_Handler {
         m_watchdog.once(m_fw_callback->Get_Timeout());
     }
 
+    /// @brief Requests all outstanding chunks that have not been received yet again, called if no chunk could be written in the given timeout
+    inline void Retry_Firmware_Packets() {
+        m_next_request = m_requested_chunks;
+        Request_Next_Firmware_Packet();
+    }
+
+    /// @brief Writes the given chunk into flash memory and the hash, must be the chunk that directly follows the previously written one
+    /// @param current_chunk Index of the chunk we recieved the binary data for
+    /// @param payload Firmware packet data of the current chunk
+    /// @param total_bytes Amount of bytes in the current firmware packet data
+    /// @return Whether the chunk was written and the update should continue, if not the failure has already been handled
+    inline bool Write_Firmware_Packet(const size_t& current_chunk, uint8_t *payload, const size_t& total_bytes) {
+        char message[Helper::detectSize(FW_CHUNK, current_chunk, total_bytes)];
+        snprintf_P(message, sizeof(message), FW_CHUNK, current_chunk, total_bytes);
+        Logger::log(message);
+
+        if (current_chunk == 0U) {
+            // Initialize Flash
+            if (!m_fw_updater->begin(m_fw_size)) {
+              Logger::log(ERROR_UPDATE_BEGIN);
+              (void)m_send_fw_state_callback(FW_STATE_FAILED, ERROR_UPDATE_BEGIN);
+              Handle_Failure(OTA_Failure_Response::RETRY_UPDATE);
+              return false;
+            }
+        }
+
+        // Write received binary data to flash partition
+        const size_t written_bytes = m_fw_updater->write(payload, total_bytes);
+        if (written_bytes != total_bytes) {
+            char message[Helper::detectSize(ERROR_UPDATE_WRITE, written_bytes, total_bytes)];
+            snprintf_P(message, sizeof(message), ERROR_UPDATE_WRITE, written_bytes, total_bytes);
+            Logger::log(message);
+            (void)m_send_fw_state_callback(FW_STATE_FAILED, message);
+            Handle_Failure(OTA_Failure_Response::RETRY_UPDATE);
+            return false;
+        }
+
+        // Update value only if writing to flash was a success
+        if (!m_hash.update(payload, total_bytes)) {
+            Logger::log(UPDATING_HASH_FAILED);
+            (void)m_send_fw_state_callback(FW_STATE_FAILED, UPDATING_HASH_FAILED);
+            Handle_Failure(OTA_Failure_Response::RETRY_UPDATE);
+            return false;
+        }
+        (void)m_send_fw_state_callback(FW_STATE_DOWNLOADING, nullptr);
+
+        m_requested_chunks = current_chunk + 1;
+        m_fw_callback->Call_Progress_Callback<Logger>(m_requested_chunks, m_total_chunks);
+
+        // Ensure to check if the update was cancelled during the progress callback,
+        // if it was the callback variable was reset and there is no need to continue with the next firmware packet
+        return m_fw_callback != nullptr;
+    }
+
+    /// @brief Copies a chunk that arrived before the one that has to be written next into the reorder buffer.
+    /// The buffer is only allocated once that happens for the first time during an update, as long as the server responds in order no memory is needed
+    /// @param current_chunk Index of the chunk we recieved the binary data for, has to be one of the outstanding requests
+    /// @param payload Firmware packet data of the current chunk
+    /// @param total_bytes Amount of bytes in the current firmware packet data, at most m_chunk_size
+    inline void Buffer_Firmware_Packet(const size_t& current_chunk, const uint8_t *payload, const size_t& total_bytes) {
+        if (m_reorder_lengths.empty()) {
+            m_reorder_buffer.resize(m_window * m_chunk_size);
+            m_reorder_lengths.assign(m_window, SIZE_MAX);
+        }
+        // Outstanding requests never span more than the window, therefore each of them has its own slot
+        const size_t slot = current_chunk % m_window;
+        memcpy(&m_reorder_buffer[slot * m_chunk_size], payload, total_bytes);
+        m_reorder_lengths[slot] = total_bytes;
+    }
+
+    /// @brief Checks whether the given outstanding chunk has already been received and is waiting in the reorder buffer
+    /// @param chunk Index of the chunk, has to be inside of the window of outstanding requests
+    /// @return Whether the chunk does not need to be requested again
+    inline bool Is_Firmware_Packet_Buffered(const size_t& chunk) const {
+        return !m_reorder_lengths.empty() && m_reorder_lengths[chunk % m_window] != SIZE_MAX;
+    }
+
+    /// @brief Frees the reorder buffer, called once the update is over so the memory is only held while downloading
+    inline void Release_Reorder_Buffer() {
+        std::vector<uint8_t>().swap(m_reorder_buffer);
+        std::vector<size_t>().swap(m_reorder_lengths);
+    }
+
     /// @brief Completes the firmware update, which consists of checking the complete hash of the firmware binary if the initally received value,
     /// both should be the same and if that is not the case that means that we received invalid firmware binary data and have to restart the update.
     /// If checking the hash was successfull we attempt to finish flashing the ota partition and then inform the user that the update was successfull
@@ -269,6 +362,7 @@ class OTA_Handler {
         Logger::log(FW_UPDATE_SUCCESS);
         (void)m_send_fw_state_callback(FW_STATE_UPDATING, nullptr);
 
+        Release_Reorder_Buffer();
         m_fw_callback->Call_Callback<Logger>(true);
         (void)m_finish_callback();
     }
@@ -278,6 +372,7 @@ class OTA_Handler {
     /// @param failure_response Possible response to a failure that the method should handle
     inline void Handle_Failure(const OTA_Failure_Response& failure_response) {
       if (m_retries <= 0) {
+          Release_Reorder_Buffer();
           m_fw_callback->Call_Callback<Logger>(false);
           (void)m_finish_callback();
           return;
@@ -289,12 +384,13 @@ class OTA_Handler {
 
       switch (failure_response) {
         case OTA_Failure_Response::RETRY_CHUNK:
-          Request_Next_Firmware_Packet();
+          Retry_Firmware_Packets();
           break;
         case OTA_Failure_Response::RETRY_UPDATE:
           Request_First_Firmware_Packet();
           break;
         case OTA_Failure_Response::RETRY_NOTHING:
+          Release_Reorder_Buffer();
           m_fw_callback->Call_Callback<Logger>(false);
           (void)m_finish_callback();
           break;
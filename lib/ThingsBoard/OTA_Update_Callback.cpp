@@ -9,13 +9,13 @@ OTA_Update_Callback::OTA_Update_Callback() :
     // Nothing to do
 }
 
-OTA_Update_Callback::OTA_Update_Callback(function endCb, const char *currFwTitle, const char *currFwVersion, IUpdater *updater, const uint8_t &chunkRetries, const uint16_t &chunkSize, const uint64_t &timeout) :
-    OTA_Update_Callback(nullptr, endCb, currFwTitle, currFwVersion, updater, chunkRetries, chunkSize, timeout)
+OTA_Update_Callback::OTA_Update_Callback(function endCb, const char *currFwTitle, const char *currFwVersion, IUpdater *updater, const uint8_t &chunkRetries, const uint16_t &chunkSize, const uint64_t &timeout, const uint8_t &requestWindow) :
+    OTA_Update_Callback(nullptr, endCb, currFwTitle, currFwVersion, updater, chunkRetries, chunkSize, timeout, requestWindow)
 {
     // Nothing to do
 }
 
-OTA_Update_Callback::OTA_Update_Callback(progressFn progressCb, function endCb, const char *currFwTitle, const char *currFwVersion, IUpdater *updater, const uint8_t &chunkRetries, const uint16_t &chunkSize, const uint64_t &timeout) :
+OTA_Update_Callback::OTA_Update_Callback(progressFn progressCb, function endCb, const char *currFwTitle, const char *currFwVersion, IUpdater *updater, const uint8_t &chunkRetries, const uint16_t &chunkSize, const uint64_t &timeout, const uint8_t &requestWindow) :
     Callback(endCb, OTA_CB_IS_NULL),
     m_progressCb(progressCb),
     m_fwTitel(currFwTitle),
@@ -23,7 +23,8 @@ OTA_Update_Callback::OTA_Update_Callback(progressFn progressCb, function endCb,
     m_updater(updater),
     m_retries(chunkRetries),
     m_size(chunkSize),
-    m_timeout(timeout)
+    m_timeout(timeout),
+    m_window(requestWindow)
 {
     // Nothing to do
 }
@@ -80,4 +81,12 @@ void OTA_Update_Callback::Set_Timeout(const uint64_t &timeout_microseconds) {
     m_timeout = timeout_microseconds;
 }
 
+const uint8_t& OTA_Update_Callback::Get_Request_Window() const {
+    return m_window;
+}
+
+void OTA_Update_Callback::Set_Request_Window(const uint8_t &requestWindow) {
+    m_window = requestWindow;
+}
+
 #endif // THINGSBOARD_ENABLE_OTA
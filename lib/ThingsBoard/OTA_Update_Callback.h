@@ -29,10 +29,12 @@ constexpr char OTA_CB_IS_NULL[] = "OTA update callback is NULL";
 constexpr uint8_t CHUNK_RETRIES PROGMEM = 12U;
 constexpr uint16_t CHUNK_SIZE PROGMEM = (4U * 1024U);
 constexpr uint64_t REQUEST_TIMEOUT PROGMEM = (5U * 1000U * 1000U);
+constexpr uint8_t REQUEST_WINDOW PROGMEM = 4U;
 #else
 constexpr uint8_t CHUNK_RETRIES = 12U;
 constexpr uint16_t CHUNK_SIZE = (4U * 1024U);
 constexpr uint64_t REQUEST_TIMEOUT = (5U * 1000U * 1000U);
+constexpr uint8_t REQUEST_WINDOW = 4U;
 #endif // THINGSBOARD_ENABLE_PROGMEM
 
 
@@ -62,7 +64,8 @@ class OTA_Update_Callback : public Callback<void, const bool&> {
     // because the whole chunk is saved into the heap before it can be processed and is then erased again after it has been used
     /// @param timeout Maximum amount of time in microseconds for the OTA firmware update for each seperate chunk,
     /// until that chunk counts as a timeout, retries is then subtraced by one and the download is retried
-    OTA_Update_Callback(function endCb, const char *currFwTitle, const char *currFwVersion, IUpdater *updater, const uint8_t &chunkRetries = CHUNK_RETRIES, const uint16_t &chunkSize = CHUNK_SIZE, const uint64_t &timeout = REQUEST_TIMEOUT);
+    /// @param requestWindow Amount of chunks that are requested from the server at once, see Set_Request_Window() for more information
+    OTA_Update_Callback(function endCb, const char *currFwTitle, const char *currFwVersion, IUpdater *updater, const uint8_t &chunkRetries = CHUNK_RETRIES, const uint16_t &chunkSize = CHUNK_SIZE, const uint64_t &timeout = REQUEST_TIMEOUT, const uint8_t &requestWindow = REQUEST_WINDOW);
 
     /// @brief Constructs callbacks that will be called when the OTA firmware data,
     /// has been completly sent by the cloud, received by the client and written to the flash partition as well as callback
@@ -80,7 +83,8 @@ class OTA_Update_Callback : public Callback<void, const bool&> {
     // because the whole chunk is saved into the heap before it can be processed and is then erased again after it has been used
     /// @param timeout Maximum amount of time in microseconds for the OTA firmware update for each seperate chunk,
     /// until that chunk counts as a timeout, retries is then subtraced by one and the download is retried
-    OTA_Update_Callback(progressFn progressCb, function endCb, const char *currFwTitle, const char *currFwVersion, IUpdater *updater, const uint8_t &chunkRetries = CHUNK_RETRIES, const uint16_t &chunkSize = CHUNK_SIZE, const uint64_t &timeout = REQUEST_TIMEOUT);
+    /// @param requestWindow Amount of chunks that are requested from the server at once, see Set_Request_Window() for more information
+    OTA_Update_Callback(progressFn progressCb, function endCb, const char *currFwTitle, const char *currFwVersion, IUpdater *updater, const uint8_t &chunkRetries = CHUNK_RETRIES, const uint16_t &chunkSize = CHUNK_SIZE, const uint64_t &timeout = REQUEST_TIMEOUT, const uint8_t &requestWindow = REQUEST_WINDOW);
 
     /// @brief Calls the progress callback that was subscribed, when this class instance was initally created
     /// @tparam Logger Logging class that should be used to print messages generated by internal processes
@@ -164,6 +168,16 @@ class OTA_Update_Callback : public Callback<void, const bool&> {
     /// @param timeout_microseconds Timeout time until we expect a response from the server
     void Set_Timeout(const uint64_t &timeout_microseconds);
 
+    /// @brief Gets the amount of chunks that are requested from the server at once
+    /// @return Maximum amount of outstanding chunk requests
+    const uint8_t& Get_Request_Window() const;
+
+    /// @brief Sets the amount of chunks that are requested from the server at once. With only one outstanding request every chunk costs a complete round trip to the server,
+    /// keeping multiple requests outstanding hides that latency. Chunks are still written and hashed in order, chunks that arrive before an earlier one are kept
+    /// in a reorder buffer of requestWindow * chunkSize bytes, which is only allocated if that actually happens. A value of 1 requests one chunk after the other
+    /// @param requestWindow Maximum amount of outstanding chunk requests, 0 is treated as 1
+    void Set_Request_Window(const uint8_t &requestWindow);
+
   private:
     progressFn      m_progressCb;    // Progress callback to call
     const char      *m_fwTitel;      // Current firmware title of device
@@ -172,6 +186,7 @@ class OTA_Update_Callback : public Callback<void, const bool&> {
     uint8_t         m_retries;       // Maximum amount of retries for a single chunk to be downloaded and flashes successfully
     uint16_t        m_size;          // Size of chunks the firmware data will be split into
     uint64_t        m_timeout;       // How long we wait for each chunck to arrive before declaring it as failed
+    uint8_t         m_window;        // Amount of chunks that are requested at once
 };
 
 #endif // THINGSBOARD_ENABLE_OTA
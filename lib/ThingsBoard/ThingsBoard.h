@@ -7,6 +7,7 @@
 #include "Helper.h"
 #include "ThingsBoardDefaultLogger.h"
 #include "Shared_Attribute_Callback.h"
+#include "Attribute_Key_Index.h"
 #include "Attribute_Request_Callback.h"
 #include "RPC_Callback.h"
 #include "RPC_Request_Callback.h"
@@ -226,9 +227,13 @@ constexpr char PROV_CRED_HASH[] = "hash";
 #if THINGSBOARD_ENABLE_PROGMEM
 constexpr char FIRMWARE_RESPONSE_SUBSCRIBE_TOPIC[] PROGMEM = "v2/fw/response/#";
 constexpr char FIRMWARE_REQUEST_TOPIC[] PROGMEM = "v2/fw/request/0/chunk/%u";
+// Bytes the receive buffer needs in addition to the chunk, for the MQTT header and the response topic
+constexpr uint16_t FIRMWARE_PACKET_OVERHEAD PROGMEM = 50U;
 #else
 constexpr char FIRMWARE_RESPONSE_SUBSCRIBE_TOPIC[] = "v2/fw/response/#";
 constexpr char FIRMWARE_REQUEST_TOPIC[] = "v2/fw/request/0/chunk/%u";
+// Bytes the receive buffer needs in addition to the chunk, for the MQTT header and the response topic
+constexpr uint16_t FIRMWARE_PACKET_OVERHEAD = 50U;
 #endif // THINGSBOARD_ENABLE_PROGMEM
 
 // Firmware data keys.
@@ -270,6 +275,7 @@ constexpr char FW_UP_TO_DATE[] PROGMEM = "Firmware is already up to date";
 constexpr char FW_NOT_FOR_US[] PROGMEM = "Firmware is not for us (title is different)";
 constexpr char FW_CHKS_ALGO_NOT_SUPPORTED[] PROGMEM = "Checksum algorithm (%s) is not supported";
 constexpr char NOT_ENOUGH_RAM[] PROGMEM = "Temporary allocating more internal client buffer failed, decrease OTA chunk size or decrease overall heap usage";
+constexpr char CHUNK_SIZE_REDUCED[] PROGMEM = "Internal client buffer could not be increased, requesting chunks of (%u) bytes instead";
 constexpr char RESETTING_FAILED[] PROGMEM = "Preparing for OTA firmware updates failed, attributes might be NULL";
 #if THINGSBOARD_ENABLE_DEBUG
 constexpr char PAGE_BREAK[] PROGMEM = "=================================";
@@ -284,6 +290,7 @@ constexpr char FW_UP_TO_DATE[] = "Firmware is already up to date";
 constexpr char FW_NOT_FOR_US[] = "Firmware is not for us (title is different)";
 constexpr char FW_CHKS_ALGO_NOT_SUPPORTED[] = "Checksum algorithm (%s) is not supported";
 constexpr char NOT_ENOUGH_RAM[] = "Temporary allocating more internal client buffer failed, decrease OTA chunk size or decrease overall heap usage";
+constexpr char CHUNK_SIZE_REDUCED[] = "Internal client buffer could not be increased, requesting chunks of (%u) bytes instead";
 constexpr char RESETTING_FAILED[] = "Preparing for OTA firmware updates failed, attributes might be NULL";
 #if THINGSBOARD_ENABLE_DEBUG
 constexpr char PAGE_BREAK[] = "=================================";
@@ -338,6 +345,9 @@ class ThingsBoardSized {
       , m_rpc_callbacks()
       , m_rpc_request_callbacks()
       , m_shared_attribute_update_callbacks()
+      , m_shared_attribute_index()
+      , m_shared_attribute_matches()
+      , m_shared_attribute_index_dirty(true)
       , m_attribute_request_callbacks()
       , m_provision_callback()
       , m_request_id(0U)
@@ -345,6 +355,7 @@ class ThingsBoardSized {
       , m_fw_callback(nullptr)
       , m_previous_buffer_size(0U)
       , m_change_buffer_size(false)
+      , m_fw_chunk_size(0U)
       , m_ota(std::bind(&ThingsBoardSized::Publish_Chunk_Request, this, std::placeholders::_1), std::bind(&ThingsBoardSized::Firmware_Send_State, this, std::placeholders::_1, std::placeholders::_2), std::bind(&ThingsBoardSized::Firmware_OTA_Unsubscribe, this))
 #endif // THINGSBOARD_ENABLE_OTA
     {
@@ -1023,6 +1034,7 @@ class ThingsBoardSized {
 
       // Push back complete vector into our local m_shared_attribute_update_callbacks vector.
       m_shared_attribute_update_callbacks.insert(m_shared_attribute_update_callbacks.end(), first_itr, last_itr);
+      m_shared_attribute_index_dirty = true;
       return true;
     }
 
@@ -1050,6 +1062,7 @@ class ThingsBoardSized {
       for (size_t i = 0; i < callbacksSize; i++) {
         m_shared_attribute_update_callbacks.push_back(callbacks[i]);
       }
+      m_shared_attribute_index_dirty = true;
       return true;
     }
 
@@ -1074,6 +1087,7 @@ class ThingsBoardSized {
 
       // Push back given callback into our local vector
       m_shared_attribute_update_callbacks.push_back(callback);
+      m_shared_attribute_index_dirty = true;
       return true;
     }
 
@@ -1084,6 +1098,7 @@ class ThingsBoardSized {
     inline bool Shared_Attributes_Unsubscribe() {
       // Empty all callbacks
       m_shared_attribute_update_callbacks.clear();
+      m_shared_attribute_index_dirty = true;
       return m_client.unsubscribe(ATTRIBUTE_TOPIC);
     }
   
@@ -1122,13 +1137,9 @@ class ThingsBoardSized {
     /// @param request_chunck Chunk index that should be requested from the server
     /// @return Whether publishing the message was successful or not
     inline bool Publish_Chunk_Request(const size_t& request_chunck) {
-      // Calculate the number of chuncks we need to request,
-      // in order to download the complete firmware binary
-      const uint16_t& chunk_size = m_fw_callback->Get_Chunk_Size();
-
       // Convert the interger size into a readable string
-      char size[Helper::detectSize(NUMBER_PRINTF, chunk_size)];
-      snprintf_P(size, sizeof(size), NUMBER_PRINTF, chunk_size);
+      char size[Helper::detectSize(NUMBER_PRINTF, m_fw_chunk_size)];
+      snprintf_P(size, sizeof(size), NUMBER_PRINTF, m_fw_chunk_size);
       const size_t jsonSize = strlen(size);
 
       // Size adjuts dynamically to the current length of the currChunk number to ensure we don't cut it out of the topic string.
@@ -1391,22 +1402,27 @@ class ThingsBoardSized {
       Logger::log(DOWNLOADING_FW);
 #endif // THINGSBOARD_ENABLE_DEBUG
 
-      // Calculate the number of chuncks we need to request,
-      // in order to download the complete firmware binary
-      const uint16_t& chunk_size = m_fw_callback->Get_Chunk_Size();
-
       // Get the previous buffer size and cache it so the previous settings can be restored.
       m_previous_buffer_size = m_client.get_buffer_size();
-      m_change_buffer_size = m_previous_buffer_size < (chunk_size + 50U);
-
-      // Increase size of receive buffer
-      if (m_change_buffer_size && !m_client.set_buffer_size(chunk_size + 50U)) {
-        Logger::log(NOT_ENOUGH_RAM);
-        Firmware_Send_State(FW_STATE_FAILED, NOT_ENOUGH_RAM);
-        return;
+      m_fw_chunk_size = m_fw_callback->Get_Chunk_Size();
+      m_change_buffer_size = m_previous_buffer_size < (m_fw_chunk_size + FIRMWARE_PACKET_OVERHEAD);
+
+      // Increase size of receive buffer, if that is not possible, because there is not enough heap or the client can not change the size while it is connected,
+      // request chunks that fit into the current buffer instead, a chunk that does not fit would otherwise be discarded by the client and never arrive
+      if (m_change_buffer_size && !m_client.set_buffer_size(m_fw_chunk_size + FIRMWARE_PACKET_OVERHEAD)) {
+        m_change_buffer_size = false;
+        if (m_previous_buffer_size <= FIRMWARE_PACKET_OVERHEAD) {
+          Logger::log(NOT_ENOUGH_RAM);
+          Firmware_Send_State(FW_STATE_FAILED, NOT_ENOUGH_RAM);
+          return;
+        }
+        m_fw_chunk_size = m_previous_buffer_size - FIRMWARE_PACKET_OVERHEAD;
+        char message[Helper::detectSize(CHUNK_SIZE_REDUCED, m_fw_chunk_size)];
+        snprintf_P(message, sizeof(message), CHUNK_SIZE_REDUCED, m_fw_chunk_size);
+        Logger::log(message);
       }
 
-      m_ota.Start_Firmware_Update(m_fw_callback, fw_size, fw_algorithm, fw_checksum, fw_checksum_algorithm);
+      m_ota.Start_Firmware_Update(m_fw_callback, fw_size, fw_algorithm, fw_checksum, fw_checksum_algorithm, m_fw_chunk_size);
     }
 
 #endif // THINGSBOARD_ENABLE_OTA
@@ -1677,39 +1693,61 @@ class ThingsBoardSized {
       // therefore we remove the section before that which is the topic + an additional "/" character, that seperates the topic from the request id.
       // Meaning the index we want to get the substring from is the length of the topic + 1 for the additonal "/" character
       const size_t index = strlen(FIRMWARE_RESPONSE_TOPIC) + 1U;
-#if THINGSBOARD_ENABLE_STL
-      std::string request = topic;
-      request = request.substr(index, request.length() - index);
-#else
-      String request = topic;
-      request = request.substring(index);
-#endif // THINGSBOARD_ENABLE_STL
+      if (strlen(topic) < index) {
+        return;
+      }
 
       // Convert the remaining text after the topic to an integer, because it should now contain only the request id
-      const size_t request_id = atoi(request.c_str());
+      const size_t request_id = atoi(topic + index);
 
-      // Check if the remaining stack size of the current task would overflow the stack,
-      // if it would allocate the memory on the heap instead to ensure no stack overflow occurs.
-      if (getMaximumStackSize() < length) {
-        uint8_t* binary = new uint8_t[length];
-        memcpy(binary, payload, length);
-        m_ota.Process_Firmware_Packet(request_id, binary, length);
-        // Ensure to actually delete the memory placed onto the heap, to make sure we do not create a memory leak
-        // and set the pointer to null so we do not have a dangling reference.
-        delete[] binary;
-        binary = nullptr;
-      }
-      else {
-        uint8_t binary[length];
-        memcpy(binary, payload, length);
-        m_ota.Process_Firmware_Packet(request_id, binary, length);
-      }
+      // The payload stays valid in the receive buffer of the client until this method returns,
+      // therefore it can be written into flash and the hash directly, without copying each chunk first
+      m_ota.Process_Firmware_Packet(request_id, payload, length);
     }
 
 #endif // THINGSBOARD_ENABLE_OTA
 
+    /// @brief Rebuilds the index from attribute key to the subscribed callbacks that requested it,
+    /// called before the first shared attribute update after the subscribed callbacks were changed
+    inline void rebuild_shared_attribute_index() {
+      m_shared_attribute_index.clear();
+      m_shared_attribute_matches.clear();
+
+      for (size_t i = 0; i < m_shared_attribute_update_callbacks.size(); i++) {
+        m_shared_attribute_matches.push_back(nullptr);
+        const Shared_Attribute_Callback& shared_attribute = m_shared_attribute_update_callbacks[i];
+#if THINGSBOARD_ENABLE_STL
+        for (const char *att : shared_attribute.Get_Attributes()) {
+          if (att == nullptr) {
+#if THINGSBOARD_ENABLE_DEBUG
+            Logger::log(ATT_IS_NULL);
+#endif // THINGSBOARD_ENABLE_DEBUG
+            continue;
+          }
+          m_shared_attribute_index.add(i, att, strlen(att));
+        }
+#else
+        const char *att = shared_attribute.Get_Attributes();
+        if (att == nullptr) {
+          continue;
+        }
+
+        // Split the comma separated keys in place, instead of copying each of them into a String
+        const char *comma = strchr(att, COMMA);
+        while (comma != nullptr) {
+          m_shared_attribute_index.add(i, att, comma - att);
+          att = comma + 1;
+          comma = strchr(att, COMMA);
+        }
+        m_shared_attribute_index.add(i, att, strlen(att));
+#endif // THINGSBOARD_ENABLE_STL
+      }
+      m_shared_attribute_index_dirty = false;
+    }
+
     /// @brief Process callback that will be called upon shared attribute update arrival
-    /// and is responsible for handling the payload and calling the appropriate previously subscribed callbacks
+    /// and is responsible for handling the payload and calling the appropriate previously subscribed callbacks.
+    /// Every received key is looked up once in the index, instead of searching the payload for each key of each subscribed callback
     /// @param topic Previously subscribed topic, we got the response over
     /// @param data Payload sent by the server over our given topic, that contains our key value pairs
     inline void process_shared_attribute_update_message(char *topic, JsonObjectConst& data) {
@@ -1724,7 +1762,29 @@ class ThingsBoardSized {
         data = data[SHARED_RESPONSE_KEY];
       }
 
-      for (const Shared_Attribute_Callback& shared_attribute : m_shared_attribute_update_callbacks) {
+      if (m_shared_attribute_index_dirty) {
+        rebuild_shared_attribute_index();
+      }
+
+      // Remember the first received key each callback requested, each callback is called at most once per update
+      for (size_t i = 0; i < m_shared_attribute_matches.size(); i++) {
+        m_shared_attribute_matches[i] = nullptr;
+      }
+      for (const JsonPairConst pair : data) {
+        const char *key = pair.key().c_str();
+        for (uint16_t entry = m_shared_attribute_index.find(key); entry != Attribute_Key_Index::NO_ENTRY; entry = m_shared_attribute_index.get_next(entry)) {
+          const char*& requested_att = m_shared_attribute_matches[m_shared_attribute_index.get_callback_index(entry)];
+          if (requested_att == nullptr) {
+            requested_att = key;
+          }
+        }
+      }
+
+      // Callbacks are still called in the order they were subscribed in. The size is captured beforehand,
+      // because a callback might subscribe further callbacks, those are only considered for the next update
+      const size_t callback_count = m_shared_attribute_matches.size();
+      for (size_t i = 0; i < callback_count && i < m_shared_attribute_update_callbacks.size(); i++) {
+        const Shared_Attribute_Callback& shared_attribute = m_shared_attribute_update_callbacks[i];
 #if THINGSBOARD_ENABLE_STL
         if (shared_attribute.Get_Attributes().empty()) {
 #else
@@ -1738,51 +1798,10 @@ class ThingsBoardSized {
           continue;
         }
 
-        bool containsKey = false;
-        const char *requested_att = nullptr;
-
-#if THINGSBOARD_ENABLE_STL
-        for (const char *att : shared_attribute.Get_Attributes()) {
-#else
-        String stringToSplit = shared_attribute.Get_Attributes();
-        int32_t previousIndex = 0;
-        int32_t currentIndex = 0;
-
-        do {
-          // Find the index of the next comma in the string
-          currentIndex = stringToSplit.indexOf(COMMA, previousIndex);
-        
-          // If no more commas are found, set the currentIndex to the end of the string
-          if (currentIndex == -1) {
-            currentIndex = stringToSplit.length();
-          }
-
-          // Extract the attribute from the original string
-          const char *att = stringToSplit.substring(previousIndex, currentIndex).c_str();
-#endif // THINGSBOARD_ENABLE_STL
-          if (att == nullptr) {
-#if THINGSBOARD_ENABLE_DEBUG
-            Logger::log(ATT_IS_NULL);
-#endif // THINGSBOARD_ENABLE_DEBUG
-            continue;
-          }
-          // Check if the request contained any of our requested keys.
-          containsKey = containsKey || data.containsKey(att);
-          // Break early if the key was requested from this callback.
-          if (containsKey) {
-            requested_att = att;
-            break;
-          }
-#if THINGSBOARD_ENABLE_STL
-        }
-#else
-          previousIndex = currentIndex + 1;
-        } while (currentIndex != stringToSplit.length());
-#endif // THINGSBOARD_ENABLE_STL
-
+        const char *requested_att = m_shared_attribute_matches[i];
         // This callback did not request any keys that were in this response,
         // therefore we continue with the next element in the loop.
-        if (!containsKey || requested_att == nullptr) {
+        if (requested_att == nullptr) {
 #if THINGSBOARD_ENABLE_DEBUG
           Logger::log(ATT_NO_CHANGE);
 #endif // THINGSBOARD_ENABLE_DEBUG
@@ -1931,6 +1950,9 @@ class ThingsBoardSized {
     Vector<RPC_Callback> m_rpc_callbacks; // Server side RPC callbacks vector, replacement for non C++ STL boards
     Vector<RPC_Request_Callback> m_rpc_request_callbacks; // Client side RPC callbacks vector, replacement for non C++ STL boards
     Vector<Shared_Attribute_Callback> m_shared_attribute_update_callbacks; // Shared attribute update callbacks vector, replacement for non C++ STL boards
+    Attribute_Key_Index m_shared_attribute_index; // Index from the keys requested by the shared attribute update callbacks to the callbacks themselves
+    Vector<const char *> m_shared_attribute_matches; // First received key each shared attribute update callback requested, reused for every update
+    bool m_shared_attribute_index_dirty; // Whether the shared attribute update callbacks changed since the index was last built
     Vector<Attribute_Request_Callback> m_attribute_request_callbacks; // Client-side or shared attribute request callback vector, replacement for non C++ STL boards
 
     Provision_Callback m_provision_callback; // Provision response callback
@@ -1940,6 +1962,7 @@ class ThingsBoardSized {
     const OTA_Update_Callback *m_fw_callback; // Ota update response callback
     uint16_t m_previous_buffer_size; // Previous buffer size of the underlying client, used to revert to the previously configured buffer size if it was temporarily increased by the OTA update
     bool m_change_buffer_size; // Whether the buffer size had to be changed, because the previous internal buffer size was to small to hold the firmware chunks
+    uint16_t m_fw_chunk_size; // Size of the requested firmware chunks, smaller than the configured one if the internal buffer could not be increased to fit those
     OTA_Handler<Logger> m_ota; // Class instance that handles the flashing and creating a hash from the given received binary firmware data
 #endif // THINGSBOARD_ENABLE_OTA
 
@@ -8,6 +8,8 @@
 
 // Library includes.
 #include <assert.h>
+#include <stddef.h>
+#include <string.h>
 
 
 /// @brief Replacement data container for boards that do not support the C++ STL.
@@ -2,264 +2,517 @@
 #include "led_blinky.h"
 #include "neo_blinky.h"
 #include "task_webserver.h"
+#include "power_manager.h"
+#include <esp_timer.h>
+#if THINGSBOARD_ENABLE_OTA
+#include <Espressif_Delta_Updater.h>
+#endif
 
-// ----------- CONFIGURE THESE! -----------
-const char *coreIOT_Server = "app.coreiot.io";
-const char *coreIOT_Token = "drx8pb6mjnq99pacxaez"; // Device Access Token
-const int mqttPort = 1883;
-// ----------------------------------------
-
+#ifdef COREIOT_ARDUINO_MQTT
 WiFiClient espClient;
-PubSubClient client(espClient);
+Arduino_MQTT_Client mqttClient(espClient);
+static const char *const s_backendName = "arduino";
+#else
+Espressif_MQTT_Client mqttClient;
+static const char *const s_backendName = "esp-mqtt";
+#endif
+ThingsBoard tb(mqttClient, COREIOT_MAX_MESSAGE_SIZE);
+
+// Serializes the session between coreiot_task and coreiot_* callers. Recursive
+// because RPC callbacks run inside tb.loop(): PubSubClient reads the socket
+// there, esp-mqtt hands over its receive queue there.
+static SemaphoreHandle_t s_sessionMutex = NULL;
+
+// The MQTT clients keep these pointers, so they point at our own copies rather
+// than into g_wifiConfig Strings that a settings change can reallocate
+static char brokerHost[CONFIG_FIELD_MAX + 1];
+static char brokerToken[CONFIG_FIELD_MAX + 1];
+static char clientId[20];
+static uint16_t brokerPort = COREIOT_DEFAULT_PORT;
+static uint32_t appliedBrokerVersion = 0;
+static bool rpcSubscribed = false;
+
+#if defined(COREIOT_PROVISION_KEY) && defined(COREIOT_PROVISION_SECRET)
+// Logged in as "provision": no telemetry or RPC until a token is stored
+static bool s_provisioning = false;
+static char s_deviceName[24];
+static void onProvisionResponse(const Provision_Data &data);
+static const Provision_Callback s_provisionCallback(Access_Token(), onProvisionResponse, COREIOT_PROVISION_KEY,
+                                                    COREIOT_PROVISION_SECRET, s_deviceName);
+#else
+static const bool s_provisioning = false;
+#endif
+
+#if THINGSBOARD_ENABLE_OTA
+// ThingsBoard keeps a pointer to the callback, and the callback one to the
+// updater, for as long as the subscription exists
+static bool otaSubscribed = false;
+static volatile bool s_firmwareInstalled = false;
+static Espressif_Delta_Updater s_firmwareUpdater;
+static void onFirmwareUpdated(const bool &success);
+static const OTA_Update_Callback s_firmwareCallback(onFirmwareUpdated, COREIOT_FW_TITLE, COREIOT_FW_VERSION,
+                                                    &s_firmwareUpdater);
+#endif
+
+static CoreIotStats_t s_stats = {};
+static uint64_t s_publishTotalUs = 0;
+static uint64_t s_loopTotalUs = 0;
+static int64_t s_periodStart = 0;
+
+static bool lockSession(TickType_t wait)
+{
+  return s_sessionMutex != NULL && xSemaphoreTakeRecursive(s_sessionMutex, wait) == pdTRUE;
+}
 
-void reconnect()
+static void unlockSession()
 {
-  while (!client.connected())
-  {
-    Serial.print("Attempting MQTT connection...");
-    String clientId = "ESP32Client-";
-    clientId += String(random(0xffff), HEX);
+  xSemaphoreGiveRecursive(s_sessionMutex);
+}
 
-    String token = coreIOT_Token;
-    if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+static bool brokerConfigChanged()
+{
+  bool changed = false;
+  if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+  {
+    if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
     {
-      if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
-      {
-        if (!g_wifiConfig->CORE_IOT_TOKEN.isEmpty())
-        {
-          token = g_wifiConfig->CORE_IOT_TOKEN;
-        }
-        xSemaphoreGive(g_wifiConfig->mutex);
-      }
+      changed = g_wifiConfig->brokerConfigVersion != appliedBrokerVersion;
+      xSemaphoreGive(g_wifiConfig->mutex);
     }
+  }
+  return changed;
+}
 
-    if (client.connect(clientId.c_str(), token.c_str(), NULL))
-    {
-
-      Serial.println("connected to CoreIOT Server!");
-      client.subscribe("v1/devices/me/rpc/request/+");
-      Serial.println("Subscribed to v1/devices/me/rpc/request/+");
-    }
-    else
+static void applyBrokerConfig()
+{
+  String server = COREIOT_DEFAULT_SERVER;
+  String token = "";
+  int port = COREIOT_DEFAULT_PORT;
+  if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+  {
+    if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
     {
-      Serial.print("failed, rc=");
-      Serial.print(client.state());
-      Serial.println(" try again in 5 seconds");
-      delay(5000);
+      if (!g_wifiConfig->CORE_IOT_SERVER.isEmpty())
+      {
+        server = g_wifiConfig->CORE_IOT_SERVER;
+      }
+      if (g_wifiConfig->CORE_IOT_PORT.toInt() > 0)
+      {
+        port = g_wifiConfig->CORE_IOT_PORT.toInt();
+      }
+      token = g_wifiConfig->CORE_IOT_TOKEN;
+      appliedBrokerVersion = g_wifiConfig->brokerConfigVersion;
+      xSemaphoreGive(g_wifiConfig->mutex);
     }
   }
+  strlcpy(brokerHost, server.c_str(), sizeof(brokerHost));
+#if defined(COREIOT_PROVISION_KEY) && defined(COREIOT_PROVISION_SECRET)
+  // No device token yet: log in for provisioning instead
+  s_provisioning = token.isEmpty();
+  strlcpy(brokerToken, s_provisioning ? PROV_ACCESS_TOKEN : token.c_str(), sizeof(brokerToken));
+#else
+  strlcpy(brokerToken, token.isEmpty() ? COREIOT_DEFAULT_TOKEN : token.c_str(), sizeof(brokerToken));
+#endif
+  brokerPort = port;
+#if defined(COREIOT_MQTT5) && defined(COREIOT_ARDUINO_MQTT)
+  // Probe MQTT 5 again for every broker; PubSubClient falls back to 3.1.1 itself.
+  // esp-mqtt has no fallback (and no MQTT 5 before IDF 5), so it stays on 3.1.1
+  mqttClient.set_protocol_version(MQTT_VERSION_5);
+#endif
 }
 
-void callback(char *topic, byte *payload, unsigned int length)
+static void recordPublish(int64_t start)
 {
-  Serial.print("Message arrived [");
-  Serial.print(topic);
-  Serial.println("] ");
-
-  char message[length + 1];
-  memcpy(message, payload, length);
-  message[length] = '\0';
-  Serial.print("Payload: ");
-  Serial.println(message);
-
-  // Parse JSON
-  StaticJsonDocument<512> doc;
-  DeserializationError error = deserializeJson(doc, message);
+  uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+  s_publishTotalUs += elapsed;
+  s_stats.publishes++;
+  if (elapsed > s_stats.publishMaxUs)
+  {
+    s_stats.publishMaxUs = elapsed;
+  }
+}
 
-  if (error)
+// Closes a stats period: averages, one log line, counters restart
+static void updateStats()
+{
+  int64_t now = esp_timer_get_time();
+  if (s_periodStart == 0)
   {
-    Serial.print("deserializeJson() failed: ");
-    Serial.println(error.c_str());
+    s_periodStart = now;
     return;
   }
-
-  String topicStr = String(topic);
-  int lastSlash = topicStr.lastIndexOf('/');
-  String requestId = "";
-  if (lastSlash > 0)
+  uint32_t periodMs = (uint32_t)((now - s_periodStart) / 1000);
+  if (periodMs < COREIOT_STATS_PERIOD_MS)
   {
-    requestId = topicStr.substring(lastSlash + 1);
+    return;
   }
+  s_stats.periodMs = periodMs;
+  s_stats.publishAvgUs = s_stats.publishes > 0 ? (uint32_t)(s_publishTotalUs / s_stats.publishes) : 0;
+  s_stats.loopUs = (uint32_t)s_loopTotalUs;
+  Serial.printf("[CoreIOT] %s: %u publishes avg %u us max %u us, loop %u us in %u ms\n", s_backendName,
+                (unsigned)s_stats.publishes, (unsigned)s_stats.publishAvgUs, (unsigned)s_stats.publishMaxUs,
+                (unsigned)s_stats.loopUs, (unsigned)periodMs);
+  s_stats.publishes = 0;
+  s_stats.publishMaxUs = 0;
+  s_publishTotalUs = 0;
+  s_loopTotalUs = 0;
+  s_periodStart = now;
+}
 
-  const char *method = doc["method"];
+static void sendDeviceControl(int gpioPin, bool newState, const char *name)
+{
+  DeviceControlCommand cmd;
+  cmd.gpioPin = gpioPin;
+  cmd.newState = newState;
 
-  // Handle LED GPIO control
-  if (strcmp(method, "setValueLED_GPIO") == 0)
+  if (xQueueRelayControl != NULL)
   {
-    bool newState = doc["params"];
-    Serial.print("LED state change to: ");
-    Serial.println(newState ? "ON" : "OFF");
+    if (xQueueSend(xQueueRelayControl, &cmd, pdMS_TO_TICKS(100)) == pdPASS)
+    {
+      Serial.printf("%s control command sent to queue\n", name);
+    }
+    else
+    {
+      Serial.printf("Failed to send %s control command\n", name);
+    }
+  }
+}
 
-    // Send command to Device Control Task via queue
-    DeviceControlCommand cmd;
-    cmd.gpioPin = LED_GPIO;
-    cmd.newState = newState;
+static RPC_Response setValueLED_GPIO(const RPC_Data &data)
+{
+  bool newState = data;
+  Serial.print("LED state change to: ");
+  Serial.println(newState ? "ON" : "OFF");
+  sendDeviceControl(LED_GPIO, newState, "LED");
+  return RPC_Response("result", newState);
+}
 
-    if (xQueueRelayControl != NULL)
+static RPC_Response getValueLED_GPIO(const RPC_Data &data)
+{
+  bool currentState = false;
+  if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+  {
+    if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
     {
-      if (xQueueSend(xQueueRelayControl, &cmd, pdMS_TO_TICKS(100)) == pdPASS)
-      {
-        Serial.println("LED control command sent to queue");
-      }
-      else
-      {
-        Serial.println("Failed to send LED control command");
-      }
+      currentState = !g_wifiConfig->led1Override; // Inverted logic
+      xSemaphoreGive(g_wifiConfig->mutex);
     }
-
-    // Send response back to ThingsBoard
-    String responseTopic = "v1/devices/me/rpc/response/" + requestId;
-    String responsePayload = "{\"result\":" + String(newState) + "}";
-    client.publish(responseTopic.c_str(), responsePayload.c_str());
-    Serial.println("Response sent: " + responsePayload);
   }
+  Serial.print("Current LED state: ");
+  Serial.println(currentState ? "ON" : "OFF");
+  return RPC_Response("result", currentState);
+}
 
-  // Handle getting LED state
-  else if (strcmp(method, "getValueLED_GPIO") == 0)
+static RPC_Response setValueNEO_GPIO(const RPC_Data &data)
+{
+  bool newState = data;
+  Serial.print("NEO state change to: ");
+  Serial.println(newState ? "ON" : "OFF");
+  sendDeviceControl(NEO_PIN, newState, "NEO");
+  return RPC_Response("result", newState);
+}
+
+static RPC_Response getValueNEO_GPIO(const RPC_Data &data)
+{
+  bool neoState = false;
+  if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
   {
-    bool currentState = false;
-    if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+    if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
     {
-      if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
-      {
-        currentState = !g_wifiConfig->led1Override; // Inverted logic
-        xSemaphoreGive(g_wifiConfig->mutex);
-      }
+      neoState = !g_wifiConfig->neoOverride; // Inverted logic: ON=AUTO, OFF=forced off
+      xSemaphoreGive(g_wifiConfig->mutex);
     }
+  }
+  Serial.print("Current NEO state: ");
+  Serial.println(neoState ? "ON (AUTO)" : "OFF");
+  return RPC_Response("result", neoState);
+}
 
-    Serial.print("Current LED state: ");
-    Serial.println(currentState ? "ON" : "OFF");
+static const std::array<RPC_Callback, 4U> rpcCallbacks = {
+    RPC_Callback{"setValueLED_GPIO", setValueLED_GPIO},
+    RPC_Callback{"getValueLED_GPIO", getValueLED_GPIO},
+    RPC_Callback{"setValueNEO_GPIO", setValueNEO_GPIO},
+    RPC_Callback{"getValueNEO_GPIO", getValueNEO_GPIO}};
 
-    String responseTopic = "v1/devices/me/rpc/response/" + requestId;
-    String responsePayload = "{\"result\":" + String(currentState) + "}";
-    client.publish(responseTopic.c_str(), responsePayload.c_str());
-    Serial.println("Response sent: " + responsePayload);
+#if defined(COREIOT_PROVISION_KEY) && defined(COREIOT_PROVISION_SECRET)
+// Runs inside tb.loop() on coreiot_task. Storing the token bumps the broker
+// config version, so the next pass reconnects as the device.
+static void onProvisionResponse(const Provision_Data &data)
+{
+  if (strcmp(data["status"] | "", "SUCCESS") != 0 || strcmp(data["credentialsType"] | "", "ACCESS_TOKEN") != 0)
+  {
+    Serial.printf("[CoreIOT] Provisioning failed: %s\n", data["errorMsg"] | "unexpected response");
+    return;
+  }
+  String ssid, pass, server, port;
+  if (g_wifiConfig == NULL || g_wifiConfig->mutex == NULL ||
+      xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) != pdTRUE)
+  {
+    return;
   }
+  ssid = g_wifiConfig->WIFI_SSID;
+  pass = g_wifiConfig->WIFI_PASS;
+  server = g_wifiConfig->CORE_IOT_SERVER;
+  port = g_wifiConfig->CORE_IOT_PORT;
+  xSemaphoreGive(g_wifiConfig->mutex);
 
-  // Handle NEO GPIO control
-  else if (strcmp(method, "setValueNEO_GPIO") == 0)
+  if (Save_info_File(ssid, pass, data["credentialsValue"] | "", server, port) != 0)
   {
-    bool newState = doc["params"];
-    Serial.print("NEO state change to: ");
-    Serial.println(newState ? "ON" : "OFF");
+    Serial.println("[CoreIOT] Provisioned, device token stored");
+  }
+}
+#endif
 
-    // Send command to Device Control Task via queue
-    DeviceControlCommand cmd;
-    cmd.gpioPin = NEO_PIN;
-    cmd.newState = newState;
+#if THINGSBOARD_ENABLE_OTA
+// Runs inside tb.loop() on coreiot_task; the restart waits for the next pass
+// so the UPDATED state is published first
+static void onFirmwareUpdated(const bool &success)
+{
+  if (!success)
+  {
+    Serial.println("[CoreIOT] Firmware update failed");
+    return;
+  }
+  Serial.println("[CoreIOT] Firmware update installed, restarting...");
+  s_firmwareInstalled = true;
+}
+#endif
 
-    if (xQueueRelayControl != NULL)
-    {
-      if (xQueueSend(xQueueRelayControl, &cmd, pdMS_TO_TICKS(100)) == pdPASS)
-      {
-        Serial.println("NEO control command sent to queue");
-      }
-      else
-      {
-        Serial.println("Failed to send NEO control command");
-      }
-    }
+// Called with the session locked
+static bool connectSession()
+{
+  Serial.print("Attempting MQTT connection...");
+  if (!tb.connect(brokerHost, brokerToken, brokerPort, clientId))
+  {
+    Serial.printf("failed, try again in %u seconds\n", (unsigned)(COREIOT_RETRY_MS / 1000));
+    return false;
+  }
+  Serial.printf("connected to CoreIOT Server! (%s, MQTT %s)\n", s_backendName,
+                mqttClient.get_protocol_version() == 5 ? "5" : "3.1.1");
+  xEventGroupSetBits(g_netEvents, NET_MQTT_CONNECTED);
+  Config_reloadDone(CONFIG_CHANGED_BROKER);
 
-    // Send response back to ThingsBoard
-    String responseTopic = "v1/devices/me/rpc/response/" + requestId;
-    String responsePayload = "{\"result\":" + String(newState) + "}";
-    client.publish(responseTopic.c_str(), responsePayload.c_str());
-    Serial.println("Response sent: " + responsePayload);
+#if defined(COREIOT_PROVISION_KEY) && defined(COREIOT_PROVISION_SECRET)
+  if (s_provisioning)
+  {
+    // The broker closes the session after the response; a failed request is
+    // simply repeated on the next connect
+    Serial.println(tb.Provision_Request(s_provisionCallback) ? "[CoreIOT] Provisioning requested"
+                                                             : "[CoreIOT] Provisioning request failed");
+    return true;
   }
+#endif
 
-  // Handle getting NEO state
-  else if (strcmp(method, "getValueNEO_GPIO") == 0)
+  // Registered once; tb.connect() restores every subscription afterwards
+  if (!rpcSubscribed)
   {
-    bool neoState = false;
-    if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
-    {
-      if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
-      {
-        neoState = !g_wifiConfig->neoOverride; // Inverted logic: ON=AUTO, OFF=forced off
-        xSemaphoreGive(g_wifiConfig->mutex);
-      }
-    }
+    rpcSubscribed = tb.RPC_Subscribe(rpcCallbacks.cbegin(), rpcCallbacks.cend());
+  }
+#if THINGSBOARD_ENABLE_OTA
+  if (!otaSubscribed)
+  {
+    otaSubscribed = tb.Subscribe_Firmware_Update(s_firmwareCallback);
+  }
+#endif
+  tb.sendAttributeData("macAddress", WiFi.macAddress().c_str());
+  tb.sendAttributeData("localIp", WiFi.localIP().toString().c_str());
+  return true;
+}
 
-    Serial.print("Current NEO state: ");
-    Serial.println(neoState ? "ON (AUTO)" : "OFF");
+bool coreiot_connected()
+{
+  return (xEventGroupGetBits(g_netEvents) & NET_MQTT_CONNECTED) != 0;
+}
 
-    String responseTopic = "v1/devices/me/rpc/response/" + requestId;
-    String responsePayload = "{\"result\":" + String(neoState) + "}";
-    client.publish(responseTopic.c_str(), responsePayload.c_str());
-    Serial.println("Response sent: " + responsePayload);
+bool coreiot_sendTelemetry(float temperature, float humidity)
+{
+  char payload[64];
+  int length = snprintf(payload, sizeof(payload), "{\"temperature\":%.2f,\"humidity\":%.2f}", temperature, humidity);
+  if (!lockSession(pdMS_TO_TICKS(COREIOT_LOCK_TIMEOUT_MS)))
+  {
+    return false;
   }
-
-  else
+  int64_t start = esp_timer_get_time();
+  bool sent = false;
+  if (tb.connected())
   {
-    Serial.print("Unknown method: ");
-    Serial.println(method);
+#ifdef COREIOT_ARDUINO_MQTT
+    sent = mqttClient.get_client().publish(COREIOT_TELEMETRY_TOPIC, (const uint8_t *)payload, length, false, 1);
+#else
+    sent = mqttClient.publish(COREIOT_TELEMETRY_TOPIC, (const uint8_t *)payload, length, 1);
+#endif
+    recordPublish(start);
+  }
+  unlockSession();
+  return sent;
+}
 
-    String responseTopic = "v1/devices/me/rpc/response/" + requestId;
-    String responsePayload = "{\"error\":\"Unknown method\"}";
-    client.publish(responseTopic.c_str(), responsePayload.c_str());
+bool coreiot_sendTelemetry(const Telemetry *data, size_t count)
+{
+  if (!lockSession(pdMS_TO_TICKS(COREIOT_LOCK_TIMEOUT_MS)))
+  {
+    return false;
   }
+  int64_t start = esp_timer_get_time();
+  bool sent = tb.connected() && tb.sendTelemetry(data, count);
+  recordPublish(start);
+  unlockSession();
+  return sent;
 }
 
-void setup_coreiot()
+bool coreiot_sendAttributes(const Attribute *data, size_t count)
 {
-  while (1)
+  if (!lockSession(pdMS_TO_TICKS(COREIOT_LOCK_TIMEOUT_MS)))
   {
-    if (g_wifiConfig != NULL && g_wifiConfig->xBinarySemaphoreInternet != NULL)
-    {
-      if (xSemaphoreTake(g_wifiConfig->xBinarySemaphoreInternet, portMAX_DELAY))
-      {
-        break;
-      }
-    }
-    delay(500);
-    Serial.print(".");
+    return false;
   }
+  int64_t start = esp_timer_get_time();
+  bool sent = tb.connected() && tb.sendAttributes(data, count);
+  recordPublish(start);
+  unlockSession();
+  return sent;
+}
 
-  Serial.println(" Connected!");
+bool coreiot_subscribeSharedAttributes(const Shared_Attribute_Callback &callback)
+{
+  if (!lockSession(pdMS_TO_TICKS(COREIOT_LOCK_TIMEOUT_MS)))
+  {
+    return false;
+  }
+  bool subscribed = tb.connected() && tb.Shared_Attributes_Subscribe(callback);
+  unlockSession();
+  return subscribed;
+}
 
-  if (g_wifiConfig != NULL)
+bool coreiot_requestProvision(const Provision_Callback &callback)
+{
+  if (!lockSession(pdMS_TO_TICKS(COREIOT_LOCK_TIMEOUT_MS)))
   {
-    client.setServer(g_wifiConfig->CORE_IOT_SERVER.c_str(), g_wifiConfig->CORE_IOT_PORT.toInt());
+    return false;
   }
-  else
+  bool sent = tb.connected() && tb.Provision_Request(callback);
+  unlockSession();
+  return sent;
+}
+
+void getCoreIotStats(CoreIotStats_t *stats)
+{
+  if (stats != NULL)
   {
-    client.setServer(coreIOT_Server, mqttPort);
+    *stats = s_stats;
   }
-  client.setCallback(callback);
+}
+
+static void setup_coreiot()
+{
+  s_sessionMutex = xSemaphoreCreateRecursiveMutex();
+  snprintf(clientId, sizeof(clientId), "ESP32Client-%04x", (unsigned)random(0xffff));
+#ifdef COREIOT_ARDUINO_MQTT
+  mqttClient.get_client().setInflightWindow(COREIOT_INFLIGHT_WINDOW);
+#else
+  // Publishes only copy into the esp-mqtt outbox; coreiot_task owns reconnects,
+  // so subscriptions are always restored by tb.connect()
+  mqttClient.set_enqueue_messages(true);
+  mqttClient.set_disable_auto_reconnect(true);
+  mqttClient.set_mqtt_task_configuration(COREIOT_MQTT_TASK_PRIORITY, COREIOT_MQTT_TASK_STACK);
+  // Callbacks then run in tb.loop() on this task, under the session lock,
+  // instead of on the esp-mqtt task next to the coreiot_* callers
+  mqttClient.set_receive_queue_size(COREIOT_RECEIVE_QUEUE_SIZE);
+#endif
+#if defined(COREIOT_PROVISION_KEY) && defined(COREIOT_PROVISION_SECRET)
+  snprintf(s_deviceName, sizeof(s_deviceName), "ESP32-%s", WiFi.macAddress().c_str());
+#endif
+
+  xEventGroupWaitBits(g_netEvents, NET_STA_CONNECTED, pdFALSE, pdTRUE, portMAX_DELAY);
+  Serial.println(" Connected!");
+  applyBrokerConfig();
 }
 
 void coreiot_task(void *pvParameters)
 {
 
   setup_coreiot();
+  // First publish carries a real reading, not the 25C/50% defaults
+  waitBootEvents(BOOT_SENSOR_PRIMED);
 
   float temperature = 0.0;
   float humidity = 0.0;
 
   unsigned long lastTelemetryTime = 0;
-  const unsigned long telemetryInterval = 1000;
+#ifdef POWER_SAVE_ENABLE
+  TickType_t lastWake = 0;
+#endif
 
   while (1)
   {
-
-    if (!client.connected())
+    // Broker or token changed from the settings page: drop only this session
+    if (brokerConfigChanged())
     {
-      reconnect();
+      Serial.println("[CoreIOT] Broker settings changed, reconnecting...");
+      lockSession(portMAX_DELAY);
+      tb.disconnect();
+      applyBrokerConfig();
+      unlockSession();
     }
-    client.loop();
 
-    if (millis() - lastTelemetryTime >= telemetryInterval)
+    if (!tb.connected())
     {
-      getSensorData(&temperature, &humidity);
+      xEventGroupClearBits(g_netEvents, NET_MQTT_CONNECTED);
+      xEventGroupWaitBits(g_netEvents, NET_STA_CONNECTED, pdFALSE, pdTRUE, portMAX_DELAY);
+      lockSession(portMAX_DELAY);
+      bool connected = connectSession();
+      unlockSession();
+      if (!connected)
+      {
+        vTaskDelay(pdMS_TO_TICKS(COREIOT_RETRY_MS));
+        continue;
+      }
+    }
+
+    lockSession(portMAX_DELAY);
+    // A no-op with esp-mqtt; the PubSubClient backend does its socket I/O here
+    int64_t start = esp_timer_get_time();
+    tb.loop();
+    s_loopTotalUs += (uint64_t)(esp_timer_get_time() - start);
+    updateStats();
+    unlockSession();
 
-      String payload = "{\"temperature\":" + String(temperature) + ",\"humidity\":" + String(humidity) + "}";
+#if THINGSBOARD_ENABLE_OTA
+    if (s_firmwareInstalled)
+    {
+      vTaskDelay(pdMS_TO_TICKS(COREIOT_FW_RESTART_DELAY_MS));
+      esp_restart();
+    }
+#endif
 
-      client.publish("v1/devices/me/telemetry", payload.c_str());
+    // Half a poll early counts as on time, so wakeups on the POWER_PERIOD_MS
+    // grid a tick short of the interval do not skip every other sample
+    if (!s_provisioning && millis() - lastTelemetryTime + COREIOT_POLL_MS / 2 >= COREIOT_TELEMETRY_INTERVAL_MS)
+    {
+      getSensorData(&temperature, &humidity);
 
-      Serial.println("[CoreIOT] Published payload: " + payload);
+      if (coreiot_sendTelemetry(temperature, humidity))
+      {
+        bootMilestone(BOOT_FIRST_TELEMETRY, "First telemetry published");
+        Serial.printf("[CoreIOT] Published temperature %.2f humidity %.2f\n", temperature, humidity);
+      }
+      else
+      {
+#ifdef COREIOT_ARDUINO_MQTT
+        Serial.printf("[CoreIOT] Telemetry dropped, %u/%u awaiting PUBACK\n",
+                      (unsigned)mqttClient.get_client().getInflightCount(),
+                      (unsigned)mqttClient.get_client().getInflightWindow());
+#else
+        Serial.println("[CoreIOT] Telemetry dropped, session busy or outbox full");
+#endif
+      }
       lastTelemetryTime = millis();
     }
 
-    vTaskDelay(pdMS_TO_TICKS(100));
+#ifdef POWER_SAVE_ENABLE
+    power_waitNextPeriod(&lastWake);
+#else
+    vTaskDelay(pdMS_TO_TICKS(COREIOT_POLL_MS));
+#endif
   }
-}
\ No newline at end of file
+}
@@ -1,16 +1,26 @@
 #include "global.h"
 #include <vector>
+#include <esp_timer.h>
 
 static SensorData_t sensorDataInstance;
 static WifiConfig_t wifiConfigInstance;
 
 SensorData_t *g_sensorData = NULL;
 WifiConfig_t *g_wifiConfig = NULL;
+EventGroupHandle_t g_bootEvents = NULL;
+EventGroupHandle_t g_netEvents = NULL;
 
 std::vector<int> g_userPins;
 
 void initSharedData()
 {
+    g_bootEvents = xEventGroupCreate();
+    g_netEvents = xEventGroupCreate();
+    if (g_bootEvents == NULL || g_netEvents == NULL)
+    {
+        Serial.println("[ERROR] Failed to create event groups!");
+    }
+
     g_sensorData = &sensorDataInstance;
     g_sensorData->temperature = 25.0; // Default safe value
     g_sensorData->humidity = 50.0;    // Default safe value
@@ -30,16 +40,17 @@ void initSharedData()
     g_wifiConfig->CORE_IOT_PORT = "";
     g_wifiConfig->isWifiConnected = false;
     g_wifiConfig->webserver_isrunning = false; // Initialize webserver state
-    g_wifiConfig->xBinarySemaphoreInternet = xSemaphoreCreateBinary();
     g_wifiConfig->mutex = xSemaphoreCreateMutex();
 
     g_wifiConfig->led1Override = false;
     g_wifiConfig->neoOverride = false;
     g_wifiConfig->relayOverride = false;
+    g_wifiConfig->wifiConfigVersion = 0;
+    g_wifiConfig->brokerConfigVersion = 0;
 
-    if (g_wifiConfig->mutex == NULL || g_wifiConfig->xBinarySemaphoreInternet == NULL)
+    if (g_wifiConfig->mutex == NULL)
     {
-        Serial.println("[ERROR] Failed to create WiFi config semaphores!");
+        Serial.println("[ERROR] Failed to create WiFi config mutex!");
     }
 
     Serial.println("[INIT] Shared data structures initialized successfully");
@@ -92,4 +103,25 @@ void getSensorData(float *temp, float *humi)
         *temp = 25.0;
         *humi = 50.0;
     }
-}
\ No newline at end of file
+}
+
+// Mark a startup dependency as met; only the first time is logged
+void bootMilestone(EventBits_t bit, const char *name)
+{
+    if (g_bootEvents == NULL || (xEventGroupGetBits(g_bootEvents) & bit))
+    {
+        return;
+    }
+    xEventGroupSetBits(g_bootEvents, bit);
+    Serial.printf("[BOOT] %s at %lld ms\n", name, esp_timer_get_time() / 1000);
+}
+
+// Block until all of the given startup bits are set
+EventBits_t waitBootEvents(EventBits_t bits)
+{
+    if (g_bootEvents == NULL)
+    {
+        return 0;
+    }
+    return xEventGroupWaitBits(g_bootEvents, bits, pdFALSE, pdTRUE, portMAX_DELAY);
+}
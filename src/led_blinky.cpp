@@ -89,8 +89,11 @@ void Device_Control_Task(void *pvParameters)
 
     while (1)
     {
+        // Sleep until either queue has something
+        QueueSetMemberHandle_t ready = xQueueSelectFromSet(xQueueDeviceSet, portMAX_DELAY);
+
         // Check for settings updates first (higher priority)
-        if (xQueueReceive(xQueueSettings, &settings, 0) == pdPASS)
+        if (ready == xQueueSettings && xQueueReceive(xQueueSettings, &settings, 0) == pdPASS)
         {
             Serial.println("💾 Processing Settings from Queue...");
             Serial.println("SSID: " + settings.ssid);
@@ -100,12 +103,13 @@ void Device_Control_Task(void *pvParameters)
             Serial.print("Port: ");
             Serial.println(settings.port);
             
-            // Save configuration to file and restart
-            Save_info_File(settings.ssid, settings.password, settings.token, 
-                          settings.server, String(settings.port));
+            // Commit atomically and reconfigure only what changed, no restart
+            uint8_t changed = Save_info_File(settings.ssid, settings.password, settings.token,
+                                             settings.server, String(settings.port));
+            Apply_info_Changes(changed);
         }
         
-        if (xQueueReceive(xQueueRelayControl, &cmd, pdMS_TO_TICKS(100)) == pdPASS)
+        if (ready == xQueueRelayControl && xQueueReceive(xQueueRelayControl, &cmd, 0) == pdPASS)
         {
             int pin = cmd.gpioPin;
             bool isWebOn = cmd.newState;
@@ -194,9 +198,7 @@ void Device_Control_Task(void *pvParameters)
             jsonDoc["value"]["gpio"] = pin;
             jsonDoc["value"]["status"] = isWebOn ? "ON" : "OFF";
 
-            String jsonString;
-            serializeJson(jsonDoc, jsonString);
-            Webserver_sendata(jsonString);
+            Webserver_sendDocument(jsonDoc);
         }
     }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "led_blinky.h"
 #include "neo_blinky.h"
 #include "temp_humi_monitor.h"
+#include "sensor_history.h"
 // #include "mainserver.h"
 // #include "tinyml.h"
 #include "coreiot.h"
@@ -12,22 +13,27 @@
 #include "task_toogle_boot.h"
 #include "task_wifi.h"
 #include "task_webserver.h"
-#include "task_core_iot.h"
+#include "task_network.h"
+#include "power_manager.h"
+#ifdef AUDIO_MONITOR_ENABLE
+#include "task_audio.h"
+#endif
 
 QueueHandle_t xQueueRelayControl = NULL;
 QueueHandle_t xQueueSettings = NULL;
+QueueSetHandle_t xQueueDeviceSet = NULL;
 
 void setup()
 {
   Serial.begin(115200);
 
-  delay(1000);
-
   Serial.println("\n\n========================================");
   Serial.println("ESP32 S3 RTOS Project - Starting");
   Serial.println("========================================");
 
   initSharedData();
+  power_init();
+  history_init();
   xQueueRelayControl = xQueueCreate(10, sizeof(DeviceControlCommand));
   if (xQueueRelayControl == NULL)
   {
@@ -40,9 +46,16 @@ void setup()
     Serial.println("[ERROR] Failed to create Settings Queue!");
   }
 
-  delay(100);
+  // Device_Control_Task blocks on both queues at once instead of polling
+  xQueueDeviceSet = xQueueCreateSet(10 + 2);
+  if (xQueueDeviceSet == NULL || xQueueAddToSet(xQueueRelayControl, xQueueDeviceSet) != pdPASS ||
+      xQueueAddToSet(xQueueSettings, xQueueDeviceSet) != pdPASS)
+  {
+    Serial.println("[ERROR] Failed to create Device Queue Set!");
+  }
 
   check_info_File(0);
+  bootMilestone(BOOT_FS_READY, "FS ready");
 
   // Initialize WiFi BEFORE creating network tasks
   // This ensures TCP/IP stack is ready before AsyncWebServer starts
@@ -61,13 +74,14 @@ void setup()
       WiFi.mode(WIFI_STA);
       // Don't wait for connection here, let WiFi task handle that
       // Just initialize the network stack
-      delay(100);
     }
     else
     {
       Serial.println("[INIT] No WiFi credentials, AP mode already started");
     }
   }
+  // Either branch has brought up the TCP/IP stack, the web server can start
+  bootMilestone(BOOT_NET_READY, "Network stack ready");
 
   Serial.println("[INIT] Creating RTOS tasks...");
 
@@ -109,7 +123,10 @@ void setup()
               NULL);
   Serial.println("[INIT] - LCD Display Task created");
 
-  // TASK 4: Web Server (WebSocket, OTA)
+  // TASK 4: Network supervisor (WiFi link, web server lifecycle)
+  xTaskCreate(network_supervisor_task, "Net_Supervisor", 6144, NULL, 3, NULL);
+
+  // TASK 4b: Web Server (WebSocket, OTA)
   xTaskCreate(Webserver_RTOS_Task, "Webserver_Task", 10240, NULL, 3, NULL);
 
   xTaskCreate(coreiot_task,
@@ -128,6 +145,17 @@ void setup()
 
   Serial.println("[INIT] - CoreIOT Task created");
 
+#ifdef AUDIO_MONITOR_ENABLE
+  // Task 5: Acoustic feature pipeline (I2S mic -> microfrontend)
+  xTaskCreate(audio_feature_task,
+              "Audio_Feature",
+              6144,
+              NULL,
+              3,
+              NULL);
+  Serial.println("[INIT] - Audio Feature Task created");
+#endif
+
   Serial.println("========================================");
   Serial.println("All tasks created successfully!");
   Serial.println("System running...");
@@ -149,18 +177,6 @@ void setup()
 
 void loop()
 {
-  if (check_info_File(1))
-  {
-    if (!Wifi_reconnect())
-    {
-      Webserver_stop();
-    }
-    else
-    {
-      // CORE_IOT_reconnect();
-    }
-  }
-  Webserver_reconnect();
-
-  delay(100);
+  // Connectivity is handled by network_supervisor_task, nothing to poll here
+  vTaskDelete(NULL);
 }
@@ -13,6 +13,7 @@ void neo_blinky(void *pvParameters)
     float humidity = 0.0;
 
     uint8_t red = 0, green = 0, blue = 0;
+    TickType_t lastWake = 0;
 
     while (1)
     {
@@ -66,7 +67,7 @@ void neo_blinky(void *pvParameters)
         strip.setPixelColor(0, strip.Color(red, green, blue));
         strip.show();
 
-        // Update every 1 second
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        // Update every 1 second, on the shared wakeup grid
+        power_waitNextPeriod(&lastWake);
     }
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "power_manager.h"
+#include <esp_pm.h>
+#include <esp_freertos_hooks.h>
+
+static volatile uint32_t s_busyTicks[portNUM_PROCESSORS];
+static volatile uint32_t s_idleEntries[portNUM_PROCESSORS];
+static TickType_t s_lastStatsTick = 0;
+static uint32_t s_lastBusy[portNUM_PROCESSORS];
+static uint32_t s_lastEntries[portNUM_PROCESSORS];
+static bool s_lightSleep = false;
+
+// Tick hooks sample which task was interrupted: a cheap idle-time estimate
+// that does not need FreeRTOS run-time stats in the SDK. Ticks skipped by
+// tickless idle are idle by definition and show up as elapsed ticks only.
+static void IRAM_ATTR tickHookCpu0()
+{
+    if (xTaskGetCurrentTaskHandleForCPU(0) != xTaskGetIdleTaskHandleForCPU(0))
+        s_busyTicks[0]++;
+}
+
+#if portNUM_PROCESSORS > 1
+static void IRAM_ATTR tickHookCpu1()
+{
+    if (xTaskGetCurrentTaskHandleForCPU(1) != xTaskGetIdleTaskHandleForCPU(1))
+        s_busyTicks[1]++;
+}
+#endif
+
+// Called each time the idle task comes back around, i.e. once per wakeup
+static bool idleHookCpu0()
+{
+    s_idleEntries[0]++;
+    return true; // Let the idle task WAITI / sleep
+}
+
+#if portNUM_PROCESSORS > 1
+static bool idleHookCpu1()
+{
+    s_idleEntries[1]++;
+    return true;
+}
+#endif
+
+void power_init()
+{
+    esp_register_freertos_tick_hook_for_cpu(tickHookCpu0, 0);
+    esp_register_freertos_idle_hook_for_cpu(idleHookCpu0, 0);
+#if portNUM_PROCESSORS > 1
+    esp_register_freertos_tick_hook_for_cpu(tickHookCpu1, 1);
+    esp_register_freertos_idle_hook_for_cpu(idleHookCpu1, 1);
+#endif
+    s_lastStatsTick = xTaskGetTickCount();
+
+#ifdef POWER_SAVE_ENABLE
+    esp_pm_config_esp32s3_t config = {};
+    config.max_freq_mhz = POWER_MAX_FREQ_MHZ;
+    config.min_freq_mhz = POWER_MIN_FREQ_MHZ;
+    config.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&config);
+    if (err == ESP_ERR_NOT_SUPPORTED)
+    {
+        // Prebuilt Arduino SDK without CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        config.light_sleep_enable = false;
+        err = esp_pm_configure(&config);
+    }
+    s_lightSleep = (err == ESP_OK) && config.light_sleep_enable;
+    Serial.printf("[POWER] Power save %s: DFS %d-%d MHz, light sleep %s\n",
+                  err == ESP_OK ? "on" : "unavailable", POWER_MIN_FREQ_MHZ, POWER_MAX_FREQ_MHZ,
+                  s_lightSleep ? "on" : "off");
+#endif
+}
+
+void power_waitNextPeriod(TickType_t *lastWake)
+{
+    const TickType_t period = pdMS_TO_TICKS(POWER_PERIOD_MS);
+    if (*lastWake == 0)
+    {
+        *lastWake = (xTaskGetTickCount() / period) * period;
+    }
+    vTaskDelayUntil(lastWake, period);
+}
+
+void getPowerStats(PowerStats_t *stats)
+{
+    TickType_t now = xTaskGetTickCount();
+    uint32_t elapsed = now - s_lastStatsTick;
+    uint32_t entries = 0;
+    for (int cpu = 0; cpu < portNUM_PROCESSORS; cpu++)
+    {
+        uint32_t busy = s_busyTicks[cpu] - s_lastBusy[cpu];
+        stats->idlePercent[cpu] = elapsed ? 100.0f * (elapsed - min(busy, elapsed)) / elapsed : 100.0f;
+        entries += s_idleEntries[cpu] - s_lastEntries[cpu];
+        s_lastBusy[cpu] = s_busyTicks[cpu];
+        s_lastEntries[cpu] = s_idleEntries[cpu];
+    }
+    stats->wakeupsPerSec = elapsed ? entries * 1000.0f / (elapsed * portTICK_PERIOD_MS) : 0.0f;
+    stats->lightSleep = s_lightSleep;
+    s_lastStatsTick = now;
+}
@@ -0,0 +1,164 @@
+#include "sensor_history.h"
+#include <time.h>
+#include <esp_heap_caps.h>
+
+// 8 bytes per reading: fixed point keeps 24 h inside PSRAM with room to spare
+typedef struct
+{
+    uint32_t time;
+    int16_t temp; // x100
+    uint16_t humi; // x100
+} HistorySample_t;
+
+static HistorySample_t *s_samples = NULL;
+static size_t s_capacity = 0;
+static size_t s_head = 0; // Next slot to write
+static size_t s_count = 0;
+static SemaphoreHandle_t s_historyMutex = NULL;
+
+void history_init()
+{
+    if (s_samples != NULL)
+    {
+        return;
+    }
+    s_historyMutex = xSemaphoreCreateMutex();
+
+    s_capacity = HISTORY_PSRAM_SAMPLES;
+    s_samples = (HistorySample_t *)heap_caps_malloc(s_capacity * sizeof(HistorySample_t), MALLOC_CAP_SPIRAM);
+    if (s_samples == NULL)
+    {
+        s_capacity = HISTORY_INTERNAL_SAMPLES;
+        s_samples = (HistorySample_t *)malloc(s_capacity * sizeof(HistorySample_t));
+    }
+    if (s_samples == NULL || s_historyMutex == NULL)
+    {
+        s_capacity = 0;
+        Serial.println("[HISTORY] ERROR: Failed to allocate sample store!");
+        return;
+    }
+    Serial.printf("[HISTORY] Sample store: %u readings (%u bytes)\n",
+                  (unsigned)s_capacity, (unsigned)(s_capacity * sizeof(HistorySample_t)));
+}
+
+bool history_timeValid()
+{
+    return time(NULL) >= HISTORY_MIN_VALID_TIME;
+}
+
+uint32_t history_now()
+{
+    return (uint32_t)time(NULL);
+}
+
+void history_append(float temp, float humi)
+{
+    if (s_capacity == 0 || !history_timeValid())
+    {
+        return;
+    }
+    HistorySample_t sample;
+    sample.time = history_now();
+    sample.temp = (int16_t)lroundf(constrain(temp, -327.0f, 327.0f) * 100.0f);
+    sample.humi = (uint16_t)lroundf(constrain(humi, 0.0f, 655.0f) * 100.0f);
+
+    if (xSemaphoreTake(s_historyMutex, pdMS_TO_TICKS(100)) == pdTRUE)
+    {
+        s_samples[s_head] = sample;
+        s_head = (s_head + 1) % s_capacity;
+        if (s_count < s_capacity)
+        {
+            s_count++;
+        }
+        xSemaphoreGive(s_historyMutex);
+    }
+}
+
+// Logical index 0 is the oldest sample
+static inline const HistorySample_t &sampleAt(size_t i)
+{
+    return s_samples[(s_head + s_capacity - s_count + i) % s_capacity];
+}
+
+// First logical index with time >= t (samples are appended in time order)
+static size_t lowerBound(uint32_t t)
+{
+    size_t lo = 0;
+    size_t hi = s_count;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (sampleAt(mid).time < t)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+bool history_aggregate(uint32_t from, uint32_t to, HistoryBucket_t *bucket)
+{
+    if (bucket == NULL || s_capacity == 0)
+    {
+        return false;
+    }
+    memset(bucket, 0, sizeof(*bucket));
+    bucket->start = from;
+
+    if (xSemaphoreTake(s_historyMutex, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        return false;
+    }
+    int32_t tempMin = INT16_MAX, tempMax = INT16_MIN;
+    int64_t tempSum = 0;
+    uint32_t humiMin = UINT16_MAX, humiMax = 0;
+    uint64_t humiSum = 0;
+    uint32_t count = 0;
+    for (size_t i = lowerBound(from); i < s_count; i++)
+    {
+        const HistorySample_t &s = sampleAt(i);
+        if (s.time >= to)
+        {
+            break;
+        }
+        tempMin = min(tempMin, (int32_t)s.temp);
+        tempMax = max(tempMax, (int32_t)s.temp);
+        tempSum += s.temp;
+        humiMin = min(humiMin, (uint32_t)s.humi);
+        humiMax = max(humiMax, (uint32_t)s.humi);
+        humiSum += s.humi;
+        count++;
+    }
+    xSemaphoreGive(s_historyMutex);
+
+    bucket->count = count;
+    if (count > 0)
+    {
+        bucket->tempMin = tempMin / 100.0f;
+        bucket->tempMax = tempMax / 100.0f;
+        bucket->tempAvg = (float)tempSum / count / 100.0f;
+        bucket->humiMin = humiMin / 100.0f;
+        bucket->humiMax = humiMax / 100.0f;
+        bucket->humiAvg = (float)humiSum / count / 100.0f;
+    }
+    return true;
+}
+
+void history_range(uint32_t *oldest, uint32_t *count)
+{
+    *oldest = 0;
+    *count = 0;
+    if (s_capacity == 0)
+    {
+        return;
+    }
+    if (xSemaphoreTake(s_historyMutex, pdMS_TO_TICKS(100)) == pdTRUE)
+    {
+        if (s_count > 0)
+        {
+            *oldest = sampleAt(0).time;
+        }
+        *count = s_count;
+        xSemaphoreGive(s_historyMutex);
+    }
+}
@@ -0,0 +1,229 @@
+#include "task_audio.h"
+#include <driver/i2s.h>
+#include <esp_timer.h>
+#include <TensorFlowLite_ESP32.h>
+#include "freertos/queue.h"
+#include "tensorflow/lite/experimental/microfrontend/lib/frontend.h"
+#include "tensorflow/lite/experimental/microfrontend/lib/frontend_util.h"
+
+// Two frames in flight: the capture task fills one straight from the I2S DMA
+// while the feature task runs the frontend on the other. Only the buffer
+// index travels through the queues, the samples are never copied.
+#define AUDIO_FRAME_POOL 2
+
+static int16_t s_frames[AUDIO_FRAME_POOL][AUDIO_FRAME_SAMPLES];
+static int16_t s_discard[AUDIO_FRAME_SAMPLES];
+static QueueHandle_t s_freeFrames = NULL;
+static QueueHandle_t s_readyFrames = NULL;
+
+// Spectrogram slices are written twice (at i and i + COUNT), so the newest
+// window is always one contiguous block starting right after the write head.
+static int8_t s_features[2 * AUDIO_FEATURE_COUNT][AUDIO_FEATURE_SIZE];
+static size_t s_featureHead = 0;
+static size_t s_featureFill = 0;
+
+static struct FrontendState s_frontend;
+static AudioStats_t s_stats = {0, 0, 0, 0, 0};
+
+void __attribute__((weak)) audio_model_invoke(const int8_t *features, size_t length)
+{
+    // No acoustic model linked in yet
+    (void)features;
+    (void)length;
+}
+
+void getAudioStats(AudioStats_t *stats)
+{
+    if (stats != NULL)
+    {
+        *stats = s_stats;
+    }
+}
+
+static bool audio_i2s_begin()
+{
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX);
+    config.sample_rate = AUDIO_SAMPLE_RATE;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+    config.dma_buf_count = 4;
+    config.dma_buf_len = AUDIO_FRAME_SAMPLES;
+    config.use_apll = false;
+
+    i2s_pin_config_t pins = {};
+    pins.mck_io_num = I2S_PIN_NO_CHANGE;
+    pins.bck_io_num = AUDIO_I2S_BCLK_PIN;
+    pins.ws_io_num = AUDIO_I2S_WS_PIN;
+    pins.data_out_num = I2S_PIN_NO_CHANGE;
+    pins.data_in_num = AUDIO_I2S_DATA_PIN;
+
+    if (i2s_driver_install(AUDIO_I2S_PORT, &config, 0, NULL) != ESP_OK)
+    {
+        return false;
+    }
+    if (i2s_set_pin(AUDIO_I2S_PORT, &pins) != ESP_OK)
+    {
+        i2s_driver_uninstall(AUDIO_I2S_PORT);
+        return false;
+    }
+    i2s_zero_dma_buffer(AUDIO_I2S_PORT);
+    return true;
+}
+
+static bool audio_frontend_begin()
+{
+    struct FrontendConfig config;
+    FrontendFillConfigWithDefaults(&config);
+    config.window.size_ms = AUDIO_WINDOW_MS;
+    config.window.step_size_ms = AUDIO_STEP_MS;
+    config.filterbank.num_channels = AUDIO_FEATURE_SIZE;
+    config.filterbank.lower_band_limit = 125.0;
+    config.filterbank.upper_band_limit = 7500.0;
+    config.noise_reduction.smoothing_bits = 10;
+    config.noise_reduction.even_smoothing = 0.025;
+    config.noise_reduction.odd_smoothing = 0.06;
+    config.noise_reduction.min_signal_remaining = 0.05;
+    config.pcan_gain_control.enable_pcan = 1;
+    config.pcan_gain_control.strength = 0.95;
+    config.pcan_gain_control.offset = 80.0;
+    config.pcan_gain_control.gain_bits = 21;
+    config.log_scale.enable_log = 1;
+    config.log_scale.scale_shift = 6;
+
+    return FrontendPopulateState(&config, &s_frontend, AUDIO_SAMPLE_RATE) != 0;
+}
+
+// Quantize one frontend slice (0..~670 after log scale) to int8 like micro_speech
+static void audio_push_slice(const uint16_t *values, size_t size)
+{
+    int8_t *slot = s_features[s_featureHead];
+    for (size_t i = 0; i < AUDIO_FEATURE_SIZE; i++)
+    {
+        int32_t v = (i < size) ? values[i] : 0;
+        v = ((v * 256) + 333) / 666 - 128;
+        if (v < -128)
+            v = -128;
+        if (v > 127)
+            v = 127;
+        slot[i] = (int8_t)v;
+    }
+    memcpy(s_features[s_featureHead + AUDIO_FEATURE_COUNT], slot, AUDIO_FEATURE_SIZE);
+
+    s_featureHead = (s_featureHead + 1) % AUDIO_FEATURE_COUNT;
+    if (s_featureFill < AUDIO_FEATURE_COUNT)
+    {
+        s_featureFill++;
+    }
+    s_stats.slicesGenerated++;
+}
+
+// Runs one captured frame through the frontend; every slice it yields moves
+// the model window on by one
+static void audio_process_frame(const int16_t *samples)
+{
+    int64_t start = esp_timer_get_time();
+    size_t remaining = AUDIO_FRAME_SAMPLES;
+    while (remaining > 0)
+    {
+        size_t consumed = 0;
+        struct FrontendOutput out = FrontendProcessSamples(&s_frontend, samples, remaining, &consumed);
+        samples += consumed;
+        remaining -= consumed;
+
+        if (out.values != NULL)
+        {
+            audio_push_slice(out.values, out.size);
+            if (s_featureFill == AUDIO_FEATURE_COUNT)
+            {
+                audio_model_invoke(&s_features[s_featureHead][0],
+                                   AUDIO_FEATURE_COUNT * AUDIO_FEATURE_SIZE);
+                s_stats.windowsInvoked++;
+            }
+        }
+        if (consumed == 0)
+        {
+            break;
+        }
+    }
+    s_stats.lastProcessUs = (uint32_t)(esp_timer_get_time() - start);
+}
+
+void audio_capture_task(void *pvParameters)
+{
+    if (!audio_i2s_begin())
+    {
+        Serial.println("[AUDIO] ERROR: I2S microphone init failed!");
+        vTaskDelete(NULL);
+    }
+    Serial.println("[AUDIO] I2S capture started");
+
+    while (1)
+    {
+        uint8_t index = 0;
+        int16_t *target = s_discard;
+        bool haveFrame = (xQueueReceive(s_freeFrames, &index, 0) == pdPASS);
+        if (haveFrame)
+        {
+            target = s_frames[index];
+        }
+
+        // Keep draining DMA even when the frontend is behind, otherwise the
+        // next frame would start with stale audio
+        size_t bytesRead = 0;
+        i2s_read(AUDIO_I2S_PORT, target, sizeof(s_discard), &bytesRead, portMAX_DELAY);
+
+        if (!haveFrame)
+        {
+            s_stats.framesDropped++;
+            continue;
+        }
+        s_stats.framesCaptured++;
+        xQueueSend(s_readyFrames, &index, portMAX_DELAY);
+    }
+}
+
+void audio_feature_task(void *pvParameters)
+{
+    s_freeFrames = xQueueCreate(AUDIO_FRAME_POOL, sizeof(uint8_t));
+    s_readyFrames = xQueueCreate(AUDIO_FRAME_POOL, sizeof(uint8_t));
+    if (s_freeFrames == NULL || s_readyFrames == NULL || !audio_frontend_begin())
+    {
+        Serial.println("[AUDIO] ERROR: Failed to initialize feature pipeline!");
+        vTaskDelete(NULL);
+    }
+    for (uint8_t i = 0; i < AUDIO_FRAME_POOL; i++)
+    {
+        xQueueSend(s_freeFrames, &i, 0);
+    }
+
+    xTaskCreate(audio_capture_task, "Audio_Capture", 3072, NULL, 5, NULL);
+
+    unsigned long lastReport = millis();
+    uint32_t lastSlices = 0;
+
+    while (1)
+    {
+        uint8_t index = 0;
+        if (xQueueReceive(s_readyFrames, &index, portMAX_DELAY) != pdPASS)
+        {
+            continue;
+        }
+
+        audio_process_frame(s_frames[index]);
+        xQueueSend(s_freeFrames, &index, 0);
+
+        if (millis() - lastReport >= 10000)
+        {
+            float seconds = (millis() - lastReport) / 1000.0;
+            Serial.printf("[AUDIO] %.1f slices/s, dropped %u, frontend %u us, stack free %u\n",
+                          (s_stats.slicesGenerated - lastSlices) / seconds,
+                          (unsigned)s_stats.framesDropped, (unsigned)s_stats.lastProcessUs,
+                          (unsigned)uxTaskGetStackHighWaterMark(NULL));
+            lastSlices = s_stats.slicesGenerated;
+            lastReport = millis();
+        }
+    }
+}
@@ -1,69 +1,272 @@
 #include "task_check_info.h"
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
 
-void Load_info_File()
+// esp_timer time at which each pending reload started, 0 when none
+static int64_t s_wifiReloadStart = 0;
+static int64_t s_brokerReloadStart = 0;
+
+// Validate header, size and CRC; returns the TLV length or 0
+static size_t readConfig(const char *path, uint8_t *buf)
 {
-  File file = LittleFS.open("/info.dat", "r");
+  File file = LittleFS.open(path, "r");
+  if (!file)
+  {
+    return 0;
+  }
+  size_t size = file.read(buf, CONFIG_MAX_SIZE);
+  file.close();
+
+  const ConfigHeader_t *header = (const ConfigHeader_t *)buf;
+  if (size < sizeof(ConfigHeader_t) || header->magic != CONFIG_MAGIC || header->version != CONFIG_VERSION ||
+      header->length != size - sizeof(ConfigHeader_t) ||
+      esp_rom_crc32_le(0, buf + sizeof(ConfigHeader_t), header->length) != header->crc)
+  {
+    Serial.printf("[CONFIG] %s is invalid, ignoring it\n", path);
+    return 0;
+  }
+  return header->length;
+}
+
+static_assert(CONFIG_MAX_SIZE - sizeof(ConfigHeader_t) <= UINT16_MAX, "TLV length must fit ConfigHeader_t::length");
+
+// len <= CONFIG_FIELD_MAX, checked by commitConfig()
+static size_t putField(uint8_t *tlv, size_t pos, uint8_t type, const void *value, size_t len)
+{
+  tlv[pos++] = type;
+  tlv[pos++] = (uint8_t)len;
+  memcpy(tlv + pos, value, len);
+  return pos + len;
+}
+
+// Write temp file, sync, then rotate it in: CONFIG_FILE -> CONFIG_BACKUP_FILE,
+// CONFIG_TEMP_FILE -> CONFIG_FILE. A power cut at any point leaves either the
+// new or the previous record readable.
+static bool commitConfig(const String &ssid, const String &pass, const String &token,
+                         const String &server, uint16_t port)
+{
+  // A truncated value would differ from the one kept in g_wifiConfig after the next reboot
+  if (ssid.length() > CONFIG_FIELD_MAX || pass.length() > CONFIG_FIELD_MAX ||
+      token.length() > CONFIG_FIELD_MAX || server.length() > CONFIG_FIELD_MAX)
+  {
+    Serial.printf("[CONFIG] ERROR: Fields are limited to %u bytes, keeping the previous configuration.\n",
+                  (unsigned)CONFIG_FIELD_MAX);
+    return false;
+  }
+
+  uint8_t buf[CONFIG_MAX_SIZE];
+  uint8_t *tlv = buf + sizeof(ConfigHeader_t);
+  size_t len = 0;
+  len = putField(tlv, len, CFG_WIFI_SSID, ssid.c_str(), ssid.length());
+  len = putField(tlv, len, CFG_WIFI_PASS, pass.c_str(), pass.length());
+  len = putField(tlv, len, CFG_CORE_IOT_TOKEN, token.c_str(), token.length());
+  len = putField(tlv, len, CFG_CORE_IOT_SERVER, server.c_str(), server.length());
+  uint8_t portLE[2] = {(uint8_t)(port & 0xFF), (uint8_t)(port >> 8)};
+  len = putField(tlv, len, CFG_CORE_IOT_PORT, portLE, sizeof(portLE));
+
+  ConfigHeader_t *header = (ConfigHeader_t *)buf;
+  header->magic = CONFIG_MAGIC;
+  header->version = CONFIG_VERSION;
+  header->length = len;
+  header->crc = esp_rom_crc32_le(0, tlv, len);
+
+  File file = LittleFS.open(CONFIG_TEMP_FILE, "w");
+  if (!file)
+  {
+    Serial.println("[CONFIG] ERROR: Unable to save the configuration.");
+    return false;
+  }
+  size_t total = sizeof(ConfigHeader_t) + len;
+  bool ok = file.write(buf, total) == total;
+  file.flush();
+  file.close();
+  if (!ok)
+  {
+    Serial.println("[CONFIG] ERROR: Short write, keeping the previous configuration.");
+    LittleFS.remove(CONFIG_TEMP_FILE);
+    return false;
+  }
+
+  if (LittleFS.exists(CONFIG_FILE))
+  {
+    LittleFS.remove(CONFIG_BACKUP_FILE);
+    LittleFS.rename(CONFIG_FILE, CONFIG_BACKUP_FILE);
+  }
+  if (!LittleFS.rename(CONFIG_TEMP_FILE, CONFIG_FILE))
+  {
+    Serial.println("[CONFIG] ERROR: Commit rename failed.");
+    return false;
+  }
+  Serial.printf("[CONFIG] Saved %u bytes\n", (unsigned)total);
+  return true;
+}
+
+// One-time import of the old JSON /info.dat
+static void migrateLegacyConfig()
+{
+  File file = LittleFS.open(CONFIG_LEGACY_FILE, "r");
   if (!file)
   {
     return;
   }
-  DynamicJsonDocument doc(4096);
+  StaticJsonDocument<768> doc;
   DeserializationError error = deserializeJson(doc, file);
+  file.close();
   if (error)
   {
     Serial.print(F("deserializeJson() failed: "));
+    Serial.println(error.c_str());
+    return;
   }
-  else
+  if (commitConfig(doc["WIFI_SSID"] | "", doc["WIFI_PASS"] | "", doc["CORE_IOT_TOKEN"] | "",
+                   doc["CORE_IOT_SERVER"] | "", String(doc["CORE_IOT_PORT"] | "").toInt()))
   {
-    if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+    LittleFS.remove(CONFIG_LEGACY_FILE);
+    Serial.println("[CONFIG] Migrated " CONFIG_LEGACY_FILE " to " CONFIG_FILE);
+  }
+}
+
+// size <= CONFIG_FIELD_MAX, checked by the caller
+static String configText(const uint8_t *value, uint8_t size)
+{
+  char text[CONFIG_FIELD_MAX + 1];
+  memcpy(text, value, size);
+  text[size] = '\0';
+  return String(text);
+}
+
+void Load_info_File()
+{
+  uint8_t buf[CONFIG_MAX_SIZE];
+  size_t len = readConfig(CONFIG_FILE, buf);
+  if (len == 0)
+  {
+    len = readConfig(CONFIG_BACKUP_FILE, buf);
+  }
+  if (len == 0 && LittleFS.exists(CONFIG_LEGACY_FILE))
+  {
+    migrateLegacyConfig();
+    len = readConfig(CONFIG_FILE, buf);
+  }
+  if (len == 0 || g_wifiConfig == NULL || g_wifiConfig->mutex == NULL)
+  {
+    return;
+  }
+
+  const uint8_t *tlv = buf + sizeof(ConfigHeader_t);
+  if (xSemaphoreTake(g_wifiConfig->mutex, portMAX_DELAY) == pdTRUE)
+  {
+    for (size_t pos = 0; pos + 2 <= len && pos + 2 + tlv[pos + 1] <= len; pos += 2 + tlv[pos + 1])
     {
-      if (xSemaphoreTake(g_wifiConfig->mutex, portMAX_DELAY) == pdTRUE)
+      uint8_t type = tlv[pos];
+      uint8_t size = tlv[pos + 1];
+      const uint8_t *value = tlv + pos + 2;
+
+      // A longer field never comes from commitConfig(): corrupt or from a
+      // newer firmware, skip it rather than copy it onto the stack
+      if (size > CONFIG_FIELD_MAX)
       {
-        g_wifiConfig->WIFI_SSID = strdup(doc["WIFI_SSID"]);
-        g_wifiConfig->WIFI_PASS = strdup(doc["WIFI_PASS"]);
-        g_wifiConfig->CORE_IOT_TOKEN = strdup(doc["CORE_IOT_TOKEN"]);
-        g_wifiConfig->CORE_IOT_SERVER = strdup(doc["CORE_IOT_SERVER"]);
-        g_wifiConfig->CORE_IOT_PORT = strdup(doc["CORE_IOT_PORT"]);
-        xSemaphoreGive(g_wifiConfig->mutex);
+        continue;
+      }
+
+      switch (type)
+      {
+      case CFG_WIFI_SSID:
+        g_wifiConfig->WIFI_SSID = configText(value, size);
+        break;
+      case CFG_WIFI_PASS:
+        g_wifiConfig->WIFI_PASS = configText(value, size);
+        break;
+      case CFG_CORE_IOT_TOKEN:
+        g_wifiConfig->CORE_IOT_TOKEN = configText(value, size);
+        break;
+      case CFG_CORE_IOT_SERVER:
+        g_wifiConfig->CORE_IOT_SERVER = configText(value, size);
+        break;
+      case CFG_CORE_IOT_PORT:
+        if (size == 2)
+        {
+          g_wifiConfig->CORE_IOT_PORT = String(value[0] | (value[1] << 8));
+        }
+        break;
+      default:
+        break; // Field from a newer firmware
       }
     }
+    xSemaphoreGive(g_wifiConfig->mutex);
   }
-  file.close();
 }
 
 void Delete_info_File()
 {
-  if (LittleFS.exists("/info.dat"))
-  {
-    LittleFS.remove("/info.dat");
-  }
-  ESP.restart();
+  LittleFS.remove(CONFIG_FILE);
+  LittleFS.remove(CONFIG_BACKUP_FILE);
+  LittleFS.remove(CONFIG_LEGACY_FILE);
+  LittleFS.remove(WIFI_CACHE_FILE);
 }
 
-void Save_info_File(String wifi_ssid, String wifi_pass, String CORE_IOT_TOKEN, String CORE_IOT_SERVER, String CORE_IOT_PORT)
+uint8_t Save_info_File(String wifi_ssid, String wifi_pass, String CORE_IOT_TOKEN, String CORE_IOT_SERVER, String CORE_IOT_PORT)
 {
-  Serial.println(wifi_ssid);
-  Serial.println(wifi_pass);
-
-  DynamicJsonDocument doc(4096);
-  doc["WIFI_SSID"] = wifi_ssid;
-  doc["WIFI_PASS"] = wifi_pass;
-  doc["CORE_IOT_TOKEN"] = CORE_IOT_TOKEN;
-  doc["CORE_IOT_SERVER"] = CORE_IOT_SERVER;
-  doc["CORE_IOT_PORT"] = CORE_IOT_PORT;
+  if (!commitConfig(wifi_ssid, wifi_pass, CORE_IOT_TOKEN, CORE_IOT_SERVER, CORE_IOT_PORT.toInt()))
+  {
+    return 0;
+  }
 
-  File configFile = LittleFS.open("/info.dat", "w");
-  if (configFile)
+  uint8_t changed = 0;
+  if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+  {
+    if (xSemaphoreTake(g_wifiConfig->mutex, portMAX_DELAY) == pdTRUE)
+    {
+      if (g_wifiConfig->WIFI_SSID != wifi_ssid || g_wifiConfig->WIFI_PASS != wifi_pass)
+      {
+        changed |= CONFIG_CHANGED_WIFI;
+        g_wifiConfig->wifiConfigVersion++;
+      }
+      if (g_wifiConfig->CORE_IOT_TOKEN != CORE_IOT_TOKEN || g_wifiConfig->CORE_IOT_SERVER != CORE_IOT_SERVER ||
+          g_wifiConfig->CORE_IOT_PORT != CORE_IOT_PORT)
+      {
+        changed |= CONFIG_CHANGED_BROKER;
+        g_wifiConfig->brokerConfigVersion++;
+      }
+      g_wifiConfig->WIFI_SSID = wifi_ssid;
+      g_wifiConfig->WIFI_PASS = wifi_pass;
+      g_wifiConfig->CORE_IOT_TOKEN = CORE_IOT_TOKEN;
+      g_wifiConfig->CORE_IOT_SERVER = CORE_IOT_SERVER;
+      g_wifiConfig->CORE_IOT_PORT = CORE_IOT_PORT;
+      xSemaphoreGive(g_wifiConfig->mutex);
+    }
+  }
+  return changed;
+}
+void Apply_info_Changes(uint8_t changed)
+{
+  int64_t now = esp_timer_get_time();
+  if (changed & CONFIG_CHANGED_BROKER)
   {
-    serializeJson(doc, configFile);
-    configFile.close();
+    s_brokerReloadStart = now;
+    Serial.println("[CONFIG] Broker settings changed, MQTT will reconnect");
   }
-  else
+  if (changed & CONFIG_CHANGED_WIFI)
   {
-    Serial.println("Unable to save the configuration.");
+    s_wifiReloadStart = now;
+    Serial.println("[CONFIG] WiFi settings changed, re-associating");
+    // Wifi_reconnect() sees the link down and associates with the new credentials
+    WiFi.disconnect();
   }
-  ESP.restart();
-};
+}
+
+void Config_reloadDone(uint8_t group)
+{
+  int64_t *start = (group == CONFIG_CHANGED_WIFI) ? &s_wifiReloadStart : &s_brokerReloadStart;
+  if (*start == 0)
+  {
+    return;
+  }
+  Serial.printf("[CONFIG] %s settings applied, downtime %u ms\n",
+                group == CONFIG_CHANGED_WIFI ? "WiFi" : "Broker",
+                (unsigned)((esp_timer_get_time() - *start) / 1000));
+  *start = 0;
+}
 
 bool check_info_File(bool check)
 {
@@ -0,0 +1,70 @@
+#include "task_network.h"
+
+static TaskHandle_t s_supervisor = NULL;
+
+// Runs in the WiFi event task: publish the state, wake the supervisor
+static void onWifiEvent(arduino_event_id_t event, arduino_event_info_t info)
+{
+    switch (event)
+    {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+        xEventGroupSetBits(g_netEvents, NET_STA_CONNECTED);
+        break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+        xEventGroupClearBits(g_netEvents, NET_STA_CONNECTED);
+        break;
+    case ARDUINO_EVENT_WIFI_AP_START:
+        xEventGroupSetBits(g_netEvents, NET_AP_ACTIVE);
+        break;
+    case ARDUINO_EVENT_WIFI_AP_STOP:
+        xEventGroupClearBits(g_netEvents, NET_AP_ACTIVE);
+        break;
+    default:
+        return;
+    }
+    if (s_supervisor != NULL)
+    {
+        xTaskNotifyGive(s_supervisor);
+    }
+}
+
+void network_supervisor_task(void *pvParameters)
+{
+    s_supervisor = xTaskGetCurrentTaskHandle();
+    WiFi.onEvent(onWifiEvent);
+    waitBootEvents(BOOT_NET_READY);
+
+    // AP may already be up from setup(), before the handler was registered
+    if (WiFi.getMode() & WIFI_MODE_AP)
+    {
+        xEventGroupSetBits(g_netEvents, NET_AP_ACTIVE);
+    }
+
+    bool sntpStarted = false;
+    while (1)
+    {
+        bool haveCredentials = check_info_File(1);
+        bool staUp = haveCredentials && Wifi_reconnect();
+        bool apUp = (xEventGroupGetBits(g_netEvents) & NET_AP_ACTIVE) != 0;
+
+        if (staUp && !sntpStarted)
+        {
+            configTime(0, 0, NET_NTP_SERVER1, NET_NTP_SERVER2);
+            sntpStarted = true;
+        }
+
+        if (staUp || apUp)
+        {
+            Webserver_reconnect(); // Starts the server if it is not running
+        }
+        else
+        {
+            Webserver_stop(); // No-op once stopped
+        }
+
+        // Sleep until the next WiFi event, or the next reconnect step
+        bool reconnecting = haveCredentials && !staUp;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(reconnecting ? NET_RECONNECT_POLL_MS : NET_IDLE_POLL_MS));
+    }
+}
@@ -1,15 +1,386 @@
 #include "task_webserver.h"
 #include "global.h"
 #include <ArduinoJson.h>
+#include <esp_timer.h>
+#include <memory>
+#include "sensor_history.h"
+#include "ts_store.h"
+#include "power_manager.h"
+#ifdef WEB_ASSETS_EMBEDDED
+#include "web_assets_embedded.h"
+#endif
 
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
+AsyncEventSource events("/events");
+
+// Per-client protocol and flow-control state, guarded by s_clientsMutex
+static WsClientState_t s_clients[WS_MAX_PROTO_CLIENTS];
+static SemaphoreHandle_t s_clientsMutex = NULL;
+static WsProtocolStats_t s_protoStats = {};
+
+static WsClientState_t *findClientState(uint32_t id)
+{
+    for (auto &st : s_clients)
+    {
+        if (st.id == id)
+            return &st;
+    }
+    return NULL;
+}
+
+// False when no slot could be recorded; the client is then sent text JSON
+static bool addClientState(uint32_t id, bool msgpack)
+{
+    if (s_clientsMutex == NULL || xSemaphoreTake(s_clientsMutex, pdMS_TO_TICKS(100)) != pdTRUE)
+        return false;
+    WsClientState_t *st = findClientState(0);
+    if (st != NULL)
+    {
+        *st = WsClientState_t();
+        st->id = id;
+        st->msgpack = msgpack;
+    }
+    xSemaphoreGive(s_clientsMutex);
+    return st != NULL;
+}
+
+static void removeClientState(uint32_t id)
+{
+    if (s_clientsMutex == NULL || xSemaphoreTake(s_clientsMutex, pdMS_TO_TICKS(100)) != pdTRUE)
+        return;
+    WsClientState_t *st = findClientState(id);
+    if (st != NULL)
+    {
+        *st = WsClientState_t(); // releases any pending frame
+    }
+    xSemaphoreGive(s_clientsMutex);
+}
+
+// A client is congested while it still has frames queued or the TCP send
+// window cannot take another frame; new sensor frames then wait as "pending".
+static bool clientCongested(AsyncWebSocketClient &c, size_t frameLen)
+{
+    AsyncClient *tcp = c.client();
+    return c.queueLen() >= WS_BACKPRESSURE_QUEUE_LEN || tcp == NULL || tcp->space() < frameLen;
+}
+
+static void sendToClient(AsyncWebSocketClient &c, WsClientState_t *st, const AsyncWebSocketSharedBuffer &buffer, bool binary)
+{
+    bool ok = binary ? c.binary(buffer) : c.text(buffer);
+    if (st != NULL && ok)
+    {
+        st->framesSent++;
+        st->lastSentMs = millis();
+    }
+}
+
+// Recent broadcasts kept for SSE Last-Event-ID resume (guarded by s_clientsMutex)
+typedef struct
+{
+    uint32_t id;
+    char event[16];
+    char data[WS_SSE_EVENT_SIZE];
+} SseHistoryEntry_t;
+
+static SseHistoryEntry_t s_sseHistory[WS_SSE_HISTORY];
+static uint32_t s_sseNextId = 1;
+
+// Stores the broadcast in the history and copies it out, so it can be sent
+// after s_clientsMutex is released. Documents that do not fit are not resumable
+static bool recordSseEvent(const JsonDocument &doc, SseHistoryEntry_t *out)
+{
+    SseHistoryEntry_t &entry = s_sseHistory[s_sseNextId % WS_SSE_HISTORY];
+    size_t len = serializeJson(doc, entry.data, sizeof(entry.data));
+    if (len == 0 || len >= sizeof(entry.data) - 1)
+    {
+        entry.id = 0;
+        return false;
+    }
+    strlcpy(entry.event, doc["page"] | "message", sizeof(entry.event));
+    entry.id = s_sseNextId++;
+    *out = entry;
+    return true;
+}
+
+// Runs under the event source's client lock, and events.send() takes that lock
+// while the WebSocket side holds s_clientsMutex: entries are copied out one at
+// a time and sent with s_clientsMutex released, so the two never nest
+static void onEventsConnect(AsyncEventSourceClient *client)
+{
+    uint32_t lastId = client->lastId();
+    size_t replayed = 0;
+    if (lastId > 0 && s_clientsMutex != NULL)
+    {
+        SseHistoryEntry_t entry;
+        uint32_t id = lastId + 1;
+        while (xSemaphoreTake(s_clientsMutex, pdMS_TO_TICKS(100)) == pdTRUE)
+        {
+            // Oldest retained id first so the stream stays ordered
+            uint32_t from = (s_sseNextId > WS_SSE_HISTORY) ? s_sseNextId - WS_SSE_HISTORY : 1;
+            if (id < from)
+                id = from;
+            while (id < s_sseNextId && s_sseHistory[id % WS_SSE_HISTORY].id != id)
+                id++;
+            bool found = id < s_sseNextId;
+            if (found)
+                entry = s_sseHistory[id % WS_SSE_HISTORY];
+            xSemaphoreGive(s_clientsMutex);
+            if (!found)
+                break;
+
+            client->send(entry.data, entry.event, entry.id);
+            replayed++;
+            id++;
+        }
+    }
+    else if (lastId == 0)
+    {
+        client->send("hello", NULL, 0, WS_SSE_RETRY_MS);
+    }
+    Serial.printf("SSE client connected (Last-Event-ID %u, replayed %u)\n", (unsigned)lastId, (unsigned)replayed);
+}
+
+// Fixed pool of broadcast buffers with reserved capacity. A slot is free once
+// every client queue has released it (only the pool still holds a reference),
+// so steady-state broadcasts never touch the heap.
+static AsyncWebSocketSharedBuffer s_broadcastPool[WS_BROADCAST_POOL_SIZE];
+static portMUX_TYPE s_broadcastPoolMux = portMUX_INITIALIZER_UNLOCKED;
+static bool s_broadcastPoolReady = false;
+
+static void initBroadcastPool()
+{
+    if (s_broadcastPoolReady)
+        return;
+    s_clientsMutex = xSemaphoreCreateMutex();
+    for (auto &slot : s_broadcastPool)
+    {
+        slot = std::make_shared<std::vector<uint8_t>>();
+        slot->reserve(WS_BROADCAST_BUFFER_SIZE);
+    }
+    s_broadcastPoolReady = true;
+}
+
+static AsyncWebSocketSharedBuffer acquireBroadcastBuffer(size_t len)
+{
+    AsyncWebSocketSharedBuffer buffer;
+    if (s_broadcastPoolReady && len <= WS_BROADCAST_BUFFER_SIZE)
+    {
+        portENTER_CRITICAL(&s_broadcastPoolMux);
+        for (auto &slot : s_broadcastPool)
+        {
+            if (slot.use_count() == 1)
+            {
+                buffer = slot;
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&s_broadcastPoolMux);
+    }
+
+    if (buffer)
+    {
+        buffer->resize(len); // within reserved capacity, no reallocation
+    }
+    else
+    {
+        s_protoStats.poolMisses++;
+        buffer = std::make_shared<std::vector<uint8_t>>(len);
+    }
+    return buffer;
+}
+
+void getWsProtocolStats(WsProtocolStats_t *stats)
+{
+    if (stats != NULL)
+    {
+        *stats = s_protoStats;
+    }
+}
+
+void Webserver_sendDocument(const JsonDocument &doc, bool latestOnly)
+{
+    if (s_clientsMutex == NULL || xSemaphoreTake(s_clientsMutex, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        return;
+    }
+
+    // SSE shares the same source: every broadcast that fits gets an id and a
+    // history slot. Sent with s_clientsMutex released (see onEventsConnect)
+    SseHistoryEntry_t sse;
+    bool resumable = recordSseEvent(doc, &sse);
+    xSemaphoreGive(s_clientsMutex);
+
+    if (events.count() > 0)
+    {
+        if (resumable)
+        {
+            events.send(sse.data, sse.event, sse.id);
+        }
+        else
+        {
+            // Too large for the history: still streamed live, just without an id
+            String data;
+            serializeJson(doc, data);
+            events.send(data.c_str(), doc["page"] | "message", 0);
+        }
+    }
+
+    if (ws.count() == 0 || xSemaphoreTake(s_clientsMutex, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        return;
+    }
+
+    int64_t broadcastStart = esp_timer_get_time();
+    size_t jsonClients = 0;
+    size_t msgpackClients = 0;
+    for (auto &c : ws.getClients())
+    {
+        if (c.status() != WS_CONNECTED)
+            continue;
+        WsClientState_t *st = findClientState(c.id());
+        if (st != NULL && st->msgpack)
+            msgpackClients++;
+        else
+            jsonClients++;
+    }
+
+    // Serialize once per encoding actually in use, share the buffer across clients
+    AsyncWebSocketSharedBuffer jsonBuffer;
+    AsyncWebSocketSharedBuffer msgpackBuffer;
+    if (jsonClients > 0)
+    {
+        int64_t start = esp_timer_get_time();
+        // serializeJson() always NUL-terminates, so size for it and trim after
+        jsonBuffer = acquireBroadcastBuffer(measureJson(doc) + 1);
+        jsonBuffer->resize(serializeJson(doc, (char *)jsonBuffer->data(), jsonBuffer->size()));
+        s_protoStats.jsonMessages++;
+        s_protoStats.jsonBytes += jsonBuffer->size();
+        s_protoStats.jsonEncodeUs += (uint32_t)(esp_timer_get_time() - start);
+    }
+    if (msgpackClients > 0)
+    {
+        int64_t start = esp_timer_get_time();
+        msgpackBuffer = acquireBroadcastBuffer(measureMsgPack(doc));
+        serializeMsgPack(doc, msgpackBuffer->data(), msgpackBuffer->size());
+        s_protoStats.msgpackMessages++;
+        s_protoStats.msgpackBytes += msgpackBuffer->size();
+        s_protoStats.msgpackEncodeUs += (uint32_t)(esp_timer_get_time() - start);
+    }
+
+    for (auto &c : ws.getClients())
+    {
+        if (c.status() != WS_CONNECTED)
+            continue;
+        WsClientState_t *st = findClientState(c.id());
+        bool binary = (st != NULL && st->msgpack);
+        const AsyncWebSocketSharedBuffer &buffer = binary ? msgpackBuffer : jsonBuffer;
+        if (!buffer)
+            continue;
+
+        if (latestOnly && st != NULL && clientCongested(c, buffer->size()))
+        {
+            // Latest-value semantics: an unsent sensor frame is simply replaced
+            if (st->pending)
+            {
+                st->framesDropped++;
+            }
+            else
+            {
+                st->pendingSinceMs = millis();
+            }
+            st->pending = buffer;
+            continue;
+        }
+
+        if (latestOnly && st != NULL && st->pending)
+        {
+            // This frame supersedes whatever was waiting
+            st->pending.reset();
+            st->framesDropped++;
+        }
+        sendToClient(c, st, buffer, binary);
+    }
+
+    xSemaphoreGive(s_clientsMutex);
+
+    s_protoStats.broadcasts++;
+    s_protoStats.broadcastUs += (uint32_t)(esp_timer_get_time() - broadcastStart);
+}
+
+void Webserver_flushPending()
+{
+    if (s_clientsMutex == NULL || xSemaphoreTake(s_clientsMutex, pdMS_TO_TICKS(10)) != pdTRUE)
+    {
+        return;
+    }
+
+    for (auto &c : ws.getClients())
+    {
+        WsClientState_t *st = findClientState(c.id());
+        if (st == NULL)
+            continue;
+
+        size_t queued = c.queueLen();
+        if (queued > st->maxQueueLen)
+            st->maxQueueLen = queued;
+
+        if (st->pending && c.status() == WS_CONNECTED && !clientCongested(c, st->pending->size()))
+        {
+            uint32_t lag = millis() - st->pendingSinceMs;
+            if (lag > st->maxLagMs)
+                st->maxLagMs = lag;
+            sendToClient(c, st, st->pending, st->msgpack);
+            st->pending.reset();
+        }
+    }
+
+    xSemaphoreGive(s_clientsMutex);
+}
+
+size_t getWsClientMetrics(WsClientMetrics_t *metrics, size_t maxCount)
+{
+    size_t count = 0;
+    if (metrics == NULL || s_clientsMutex == NULL || xSemaphoreTake(s_clientsMutex, pdMS_TO_TICKS(100)) != pdTRUE)
+    {
+        return 0;
+    }
+
+    for (auto &c : ws.getClients())
+    {
+        WsClientState_t *st = findClientState(c.id());
+        if (st == NULL || count >= maxCount)
+            continue;
+        WsClientMetrics_t &m = metrics[count++];
+        m.id = st->id;
+        m.msgpack = st->msgpack;
+        m.queueLen = c.queueLen();
+        m.sendSpace = c.client() ? c.client()->space() : 0;
+        m.framesSent = st->framesSent;
+        m.framesDropped = st->framesDropped;
+        m.maxQueueLen = st->maxQueueLen;
+        m.maxLagMs = st->maxLagMs;
+        m.pendingAgeMs = st->pending ? millis() - st->pendingSinceMs : 0;
+        m.lastSentAgeMs = st->framesSent > 0 ? millis() - st->lastSentMs : 0;
+    }
+
+    xSemaphoreGive(s_clientsMutex);
+    return count;
+}
 
 void Webserver_sendata(String data)
 {
     if (ws.count() > 0)
     {
-        ws.textAll(data);
+        StaticJsonDocument<512> doc;
+        if (deserializeJson(doc, data) == DeserializationError::Ok)
+        {
+            Webserver_sendDocument(doc);
+        }
+        else
+        {
+            ws.textAll(data);
+        }
         Serial.println("📤 Đã gửi dữ liệu qua WebSocket: " + data);
     }
     else
@@ -22,10 +393,25 @@ void onEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType
 {
     if (type == WS_EVT_CONNECT)
     {
-        Serial.printf("WebSocket client #%u connected from %s\n", client->id(), client->remoteIP().toString().c_str());
+        AsyncWebServerRequest *request = (AsyncWebServerRequest *)arg;
+        bool binary = false;
+        if (request != NULL && request->hasHeader("Sec-WebSocket-Protocol"))
+        {
+            binary = request->getHeader("Sec-WebSocket-Protocol")->value().indexOf(WS_PROTO_MSGPACK) >= 0;
+        }
+        if (!addClientState(client->id(), binary) && binary)
+        {
+            // The handshake already accepted iot.msgpack; text frames would break the client
+            Serial.printf("WebSocket client #%u refused, no free protocol slot\n", client->id());
+            client->close(WS_CLOSE_TRY_AGAIN_LATER, "No free slot");
+            return;
+        }
+        Serial.printf("WebSocket client #%u connected from %s (%s)\n", client->id(), client->remoteIP().toString().c_str(),
+                      binary ? WS_PROTO_MSGPACK : "json");
     }
     else if (type == WS_EVT_DISCONNECT)
     {
+        removeClientState(client->id());
         Serial.printf("WebSocket client #%u disconnected\n", client->id());
     }
     else if (type == WS_EVT_DATA)
@@ -39,21 +425,281 @@ void onEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType
             // parseJson(message, true);
             handleWebSocketMessage(message);
         }
+        else if (info->opcode == WS_BINARY && info->final && info->index == 0 && info->len == len)
+        {
+            StaticJsonDocument<512> doc;
+            DeserializationError error = deserializeMsgPack(doc, data, len);
+            if (error)
+            {
+                Serial.print("⚠️ MsgPack Error: ");
+                Serial.println(error.f_str());
+                return;
+            }
+            handleWebSocketDocument(doc);
+        }
     }
 }
 
-void connnectWSV()
+// ---------------------------------------------------------------------------
+// GET /api/history?from=&to=&step=&format=json|csv
+// Buckets are aggregated one at a time inside the chunked filler, so only the
+// current output line is ever held in RAM regardless of the requested range.
+// ---------------------------------------------------------------------------
+typedef struct
+{
+    uint32_t from;
+    uint32_t to;
+    uint32_t step;
+    uint32_t next; // Start of the next bucket to aggregate
+    bool csv;
+    uint8_t stage; // 0 header, 1 rows, 2 footer, 3 done, 4 logged
+    uint32_t buckets;
+    uint32_t bytes;
+    uint32_t heapStart;
+    uint32_t heapLow;
+    unsigned long startMs;
+    char line[160];
+    size_t lineLen;
+    size_t lineOff;
+} HistoryStream_t;
+
+static bool historyNextLine(HistoryStream_t *st)
+{
+    st->lineLen = 0;
+    st->lineOff = 0;
+    if (st->stage == 0)
+    {
+        st->stage = 1;
+        if (st->csv)
+        {
+            st->lineLen = snprintf(st->line, sizeof(st->line),
+                                   "time,count,temp_min,temp_max,temp_avg,humi_min,humi_max,humi_avg\n");
+        }
+        else
+        {
+            st->lineLen = snprintf(st->line, sizeof(st->line),
+                                   "{\"from\":%u,\"to\":%u,\"step\":%u,\"fields\":[\"time\",\"count\",\"temp_min\","
+                                   "\"temp_max\",\"temp_avg\",\"humi_min\",\"humi_max\",\"humi_avg\"],\"data\":[",
+                                   (unsigned)st->from, (unsigned)st->to, (unsigned)st->step);
+        }
+        return true;
+    }
+    while (st->stage == 1 && st->next < st->to)
+    {
+        uint32_t end = (st->to - st->next > st->step) ? st->next + st->step : st->to;
+        HistoryBucket_t b;
+        bool ok = history_aggregate(st->next, end, &b);
+        st->next = end;
+        if (!ok || b.count == 0)
+        {
+            continue; // Empty buckets are left out, clients key on "time"
+        }
+        if (st->csv)
+        {
+            st->lineLen = snprintf(st->line, sizeof(st->line), "%u,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                                   (unsigned)b.start, (unsigned)b.count,
+                                   b.tempMin, b.tempMax, b.tempAvg, b.humiMin, b.humiMax, b.humiAvg);
+        }
+        else
+        {
+            st->lineLen = snprintf(st->line, sizeof(st->line), "%s[%u,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f]",
+                                   st->buckets ? "," : "", (unsigned)b.start, (unsigned)b.count,
+                                   b.tempMin, b.tempMax, b.tempAvg, b.humiMin, b.humiMax, b.humiAvg);
+        }
+        st->buckets++;
+        return true;
+    }
+    if (st->stage == 1)
+    {
+        st->stage = 2;
+    }
+    if (st->stage == 2)
+    {
+        st->stage = 3;
+        if (!st->csv)
+        {
+            st->lineLen = snprintf(st->line, sizeof(st->line), "]}\n");
+            return true;
+        }
+    }
+    return false;
+}
+
+static void handleHistoryRequest(AsyncWebServerRequest *request)
 {
+    if (!history_timeValid())
+    {
+        // Nothing is recorded before SNTP, and "now" would be uptime
+        request->send(503, "text/plain", "clock not set yet (waiting for SNTP)");
+        return;
+    }
+    uint32_t now = history_now();
+    uint32_t to = request->hasParam("to") ? (uint32_t)request->getParam("to")->value().toInt() : now + 1;
+    uint32_t from = request->hasParam("from") ? (uint32_t)request->getParam("from")->value().toInt()
+                                              : (to > 3600 ? to - 3600 : 0);
+    uint32_t step = request->hasParam("step") ? (uint32_t)request->getParam("step")->value().toInt() : 60;
+    bool csv = request->hasParam("format") && request->getParam("format")->value() == "csv";
+
+    if (step == 0 || to <= from || (to - from) / step > HISTORY_MAX_BUCKETS)
+    {
+        request->send(400, "text/plain", "from < to and 0 < step required, at most " +
+                                             String(HISTORY_MAX_BUCKETS) + " buckets");
+        return;
+    }
+
+    std::shared_ptr<HistoryStream_t> st = std::make_shared<HistoryStream_t>();
+    memset(st.get(), 0, sizeof(HistoryStream_t));
+    st->from = from;
+    st->to = to;
+    st->step = step;
+    st->next = from;
+    st->csv = csv;
+    st->heapStart = ESP.getFreeHeap();
+    st->heapLow = st->heapStart;
+    st->startMs = millis();
+
+    // Skip straight to the bucket holding the oldest stored sample
+    uint32_t oldest = 0, stored = 0;
+    history_range(&oldest, &stored);
+    if (stored > 0 && oldest > from)
+    {
+        st->next = (oldest < to) ? from + ((oldest - from) / step) * step : to;
+    }
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse(
+        csv ? "text/csv" : "application/json",
+        [st](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+        {
+            size_t written = 0;
+            while (written < maxLen)
+            {
+                if (st->lineOff >= st->lineLen && !historyNextLine(st.get()))
+                {
+                    break;
+                }
+                size_t n = min(maxLen - written, st->lineLen - st->lineOff);
+                memcpy(buffer + written, st->line + st->lineOff, n);
+                st->lineOff += n;
+                written += n;
+            }
+            st->bytes += written;
+            st->heapLow = min(st->heapLow, (uint32_t)ESP.getFreeHeap());
+
+            if (written == 0 && st->stage == 3)
+            {
+                st->stage = 4;
+                Serial.printf("[HISTORY] %u buckets, %u bytes in %lu ms, heap low %u (-%u during response)\n",
+                              (unsigned)st->buckets, (unsigned)st->bytes, millis() - st->startMs,
+                              (unsigned)st->heapLow, (unsigned)(st->heapStart - st->heapLow));
+            }
+            return written;
+        });
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+// Segment listing for the host-side exporter: [{"name":..,"size":..},...]
+static void handleTsFilesRequest(AsyncWebServerRequest *request)
+{
+    TsStoreStats_t stats;
+    getTsStoreStats(&stats);
+    DynamicJsonDocument doc(3072);
+    doc["blockSize"] = TS_BLOCK_SIZE;
+    doc["samples"] = stats.samples;
+    doc["blocks"] = stats.blocks;
+    doc["rotations"] = stats.rotations;
+    JsonArray files = doc.createNestedArray("files");
+    File dir = LittleFS.open(TS_DIR);
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile())
+    {
+        JsonObject entry = files.createNestedObject();
+        entry["name"] = String(f.name()).substring(String(f.name()).lastIndexOf('/') + 1);
+        entry["size"] = f.size();
+    }
+    dir.close();
+
+    String body;
+    serializeJson(doc, body);
+    request->send(200, "application/json", body);
+}
+
+#ifdef WEB_ASSETS_EMBEDDED
+// Body is read straight out of flash by the response, no file open or heap copy
+static void sendEmbeddedAsset(AsyncWebServerRequest *request, const EmbeddedWebAsset_t *asset)
+{
+    AsyncWebServerResponse *response;
+    if (request->header("If-None-Match") == asset->etag)
+    {
+        response = request->beginResponse(304);
+    }
+    else
+    {
+        response = request->beginResponse(200, asset->contentType, asset->data, asset->length);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+    response->addHeader("ETag", asset->etag);
+    response->addHeader("Cache-Control", asset->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+    request->send(response);
+}
+#endif
+
+// AsyncWebServer::end() keeps its handlers, so they are added once and every
+// later restart from the network supervisor only calls begin() again
+static void registerHandlers()
+{
+    static bool s_registered = false;
+    if (s_registered)
+    {
+        return;
+    }
+    s_registered = true;
+
+    initBroadcastPool();
     ws.onEvent(onEvent);
     server.addHandler(&ws);
-    server.on("/", HTTP_GET, [](AsyncWebServerRequest *request)
-              { request->send(LittleFS, "/index.html", "text/html"); });
-    server.on("/script.js", HTTP_GET, [](AsyncWebServerRequest *request)
-              { request->send(LittleFS, "/script.js", "application/javascript"); });
-    server.on("/styles.css", HTTP_GET, [](AsyncWebServerRequest *request)
-              { request->send(LittleFS, "/styles.css", "text/css"); });
-    server.begin();
+    events.onConnect(onEventsConnect);
+    server.addHandler(&events);
+    server.on("/api/history", HTTP_GET, handleHistoryRequest);
+    // Raw time-series segments for tools/ts_export.py
+    server.on("/api/ts/files", HTTP_GET, handleTsFilesRequest);
+    server.serveStatic(TS_DIR "/", LittleFS, TS_DIR "/").setCacheControl("no-cache");
+#ifdef WEB_ASSETS_EMBEDDED
+    for (size_t i = 0; i < EMBEDDED_WEB_ASSET_COUNT; i++)
+    {
+        const EmbeddedWebAsset_t *asset = &EMBEDDED_WEB_ASSETS[i];
+        server.on(asset->uri, HTTP_GET, [asset](AsyncWebServerRequest *request)
+                  { sendEmbeddedAsset(request, asset); });
+    }
+    Serial.printf("[WEB] Serving %u embedded assets from flash\n", (unsigned)EMBEDDED_WEB_ASSET_COUNT);
+#else
+    if (LittleFS.exists(WEB_BUNDLE_INDEX))
+    {
+        // Content-hashed assets never change under the same name
+        server.serveStatic("/assets/", LittleFS, WEB_BUNDLE_DIR "assets/")
+            .setCacheControl("public, max-age=31536000, immutable");
+        // index.html is revalidated every load; the gzip CRC doubles as ETag -> 304
+        server.serveStatic("/", LittleFS, WEB_BUNDLE_DIR)
+            .setDefaultFile("index.html")
+            .setCacheControl("no-cache");
+    }
+    else
+    {
+        // Filesystem image built without tools/build_web_assets.py
+        server.on("/", HTTP_GET, [](AsyncWebServerRequest *request)
+                  { request->send(LittleFS, "/index.html", "text/html"); });
+        server.on("/script.js", HTTP_GET, [](AsyncWebServerRequest *request)
+                  { request->send(LittleFS, "/script.js", "application/javascript"); });
+        server.on("/styles.css", HTTP_GET, [](AsyncWebServerRequest *request)
+                  { request->send(LittleFS, "/styles.css", "text/css"); });
+    }
+#endif
     ElegantOTA.begin(&server);
+}
+
+void connnectWSV()
+{
+    registerHandlers();
+    server.begin();
 
     // Set webserver running state with mutex protection
     if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
@@ -64,11 +710,29 @@ void connnectWSV()
             xSemaphoreGive(g_wifiConfig->mutex);
         }
     }
+    xEventGroupSetBits(g_netEvents, NET_WEB_RUNNING);
+    bootMilestone(BOOT_WEB_READY, "Web server started");
 }
 
 void Webserver_stop()
 {
+    // Called on every supervisor pass while the link is down
+    bool isRunning = false;
+    if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+    {
+        if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
+        {
+            isRunning = g_wifiConfig->webserver_isrunning;
+            xSemaphoreGive(g_wifiConfig->mutex);
+        }
+    }
+    if (!isRunning)
+    {
+        return;
+    }
+
     ws.closeAll();
+    events.close();
     server.end();
 
     if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
@@ -79,6 +743,7 @@ void Webserver_stop()
             xSemaphoreGive(g_wifiConfig->mutex);
         }
     }
+    xEventGroupClearBits(g_netEvents, NET_WEB_RUNNING);
     Serial.println("Web Server Stopped");
 }
 
@@ -115,6 +780,11 @@ void handleWebSocketMessage(String message)
         return;
     }
 
+    handleWebSocketDocument(doc);
+}
+
+void handleWebSocketDocument(JsonDocument &doc)
+{
     String page = doc["page"].as<String>();
 
     // ========== TASK 4: ĐIỀU KHIỂN THIẾT BỊ (LED/RELAY) ==========
@@ -172,51 +842,72 @@ void handleWebSocketMessage(String message)
 // Task RTOS quản lý Web Server
 void Webserver_RTOS_Task(void *pvParameters)
 {
-    // Wait for WiFi to be initialized before starting the server
-    // This prevents TCP/IP stack errors
-    Serial.println("[WEBSERVER] Waiting for WiFi to initialize...");
-    vTaskDelay(pdMS_TO_TICKS(2000)); // Give WiFi time to initialize
-    
-    // Khởi tạo Server ban đầu
-    connnectWSV();
+    // The network supervisor starts and stops the server; this task only
+    // feeds it once it is up
+    Serial.println("[WEBSERVER] Waiting for the server to start...");
+    waitBootEvents(BOOT_WEB_READY);
 
-    unsigned long last_update = 0;
-    const unsigned long update_interval = 500;
+    unsigned long last_stats = 0;
+    const unsigned long stats_interval = 60000;
+    TickType_t lastWake = 0;
 
+    // One pass per sensor reading, on the shared wakeup grid: the push carries
+    // the latest sample (at most one period old, the sensor task wakes on the
+    // same tick), and frames held back for a congested client are retried
+    // once per period
     while (1)
     {
-        // Logic kiểm tra và kết nối lại WiFi/Server
-        if (check_info_File(1)) // Kiểm tra nút BOOT hoặc điều kiện reset
+        float temp = 0.0;
+        float humi = 0.0;
+        getSensorData(&temp, &humi);
+
+        if (!isnan(temp) && !isnan(humi))
         {
-            if (!Wifi_reconnect())
-                Webserver_stop();
+            // Tạo JSON: {"page":"home", "value":{"temp":28.5, "humi":60.2}}
+            StaticJsonDocument<200> doc;
+            doc["page"] = "home";
+            JsonObject value = doc.createNestedObject("value");
+            value["temp"] = temp;
+            value["humi"] = humi;
+
+            // Gửi xuống Web (JSON hoặc MessagePack tùy client)
+            Webserver_sendDocument(doc, true);
         }
+        Webserver_flushPending();
 
-        Webserver_reconnect();
-        if (millis() - last_update > update_interval)
+        if (millis() - last_stats > stats_interval)
         {
-            last_update = millis();
+            last_stats = millis();
+            WsProtocolStats_t st;
+            getWsProtocolStats(&st);
+            if (st.jsonMessages > 0)
+                Serial.printf("[WS] json: %u msgs, %u B/msg, %u us/msg\n", (unsigned)st.jsonMessages,
+                              (unsigned)(st.jsonBytes / st.jsonMessages), (unsigned)(st.jsonEncodeUs / st.jsonMessages));
+            if (st.msgpackMessages > 0)
+                Serial.printf("[WS] msgpack: %u msgs, %u B/msg, %u us/msg\n", (unsigned)st.msgpackMessages,
+                              (unsigned)(st.msgpackBytes / st.msgpackMessages), (unsigned)(st.msgpackEncodeUs / st.msgpackMessages));
+            if (st.broadcasts > 0)
+                Serial.printf("[WS] broadcast: %u total, %u us each, %u heap fallbacks\n", (unsigned)st.broadcasts,
+                              (unsigned)(st.broadcastUs / st.broadcasts), (unsigned)st.poolMisses);
 
-            float temp = 0.0;
-            float humi = 0.0;
-            getSensorData(&temp, &humi);
+            Serial.printf("[WS] %u ws + %u sse clients, free heap %u\n", (unsigned)ws.count(),
+                          (unsigned)events.count(), (unsigned)ESP.getFreeHeap());
 
-            if (!isnan(temp) && !isnan(humi))
-            {
-                // Tạo JSON: {"page":"home", "value":{"temp":28.5, "humi":60.2}}
-                StaticJsonDocument<200> doc;
-                doc["page"] = "home";
-                JsonObject value = doc.createNestedObject("value");
-                value["temp"] = temp;
-                value["humi"] = humi;
-
-                String jsonString;
-                serializeJson(doc, jsonString);
-
-                // Gửi xuống Web
-                Webserver_sendata(jsonString);
-            }
+            WsClientMetrics_t clients[WS_MAX_PROTO_CLIENTS];
+            size_t n = getWsClientMetrics(clients, WS_MAX_PROTO_CLIENTS);
+            for (size_t i = 0; i < n; i++)
+                Serial.printf("[WS] client #%u: sent %u, stale dropped %u, queue %u (max %u), max lag %u ms, last send %u ms ago\n",
+                              (unsigned)clients[i].id, (unsigned)clients[i].framesSent, (unsigned)clients[i].framesDropped,
+                              (unsigned)clients[i].queueLen, (unsigned)clients[i].maxQueueLen, (unsigned)clients[i].maxLagMs,
+                              (unsigned)clients[i].lastSentAgeMs);
+
+            PowerStats_t power;
+            getPowerStats(&power);
+            Serial.printf("[POWER] idle %u%%", (unsigned)power.idlePercent[0]);
+            for (int cpu = 1; cpu < portNUM_PROCESSORS; cpu++)
+                Serial.printf("/%u%%", (unsigned)power.idlePercent[cpu]);
+            Serial.printf(", %u wakeups/s, light sleep %s\n", (unsigned)power.wakeupsPerSec, power.lightSleep ? "on" : "off");
         }
-        vTaskDelay(pdMS_TO_TICKS(50)); // Delay nhỏ để nhường CPU
+        power_waitNextPeriod(&lastWake);
     }
 }
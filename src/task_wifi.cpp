@@ -1,4 +1,30 @@
 #include "task_wifi.h"
+#include <esp_timer.h>
+#include <esp_rom_crc.h>
+
+// Reconnect state machine, advanced by every Wifi_reconnect() call:
+// IDLE -> DIRECT (cached BSSID/channel) -> SCAN (full scan)
+//      -> BACKOFF -> IDLE ...
+typedef enum
+{
+    WIFI_STATE_IDLE,
+    WIFI_STATE_DIRECT,
+    WIFI_STATE_SCAN,
+    WIFI_STATE_BACKOFF,
+    WIFI_STATE_CONNECTED
+} WifiState_t;
+
+static WifiState_t s_state = WIFI_STATE_IDLE;
+static int64_t s_attemptStart = 0;  // Start of the whole reconnect, for the histogram
+static int64_t s_phaseStart = 0;    // Start of the current DIRECT/SCAN/BACKOFF phase
+static uint32_t s_version = 0;      // wifiConfigVersion of the running attempt
+static bool s_usedDirect = false;
+
+static WifiLinkCache_t s_cache;
+static bool s_cacheLoaded = false;
+
+static const uint32_t s_histogramLimitsMs[WIFI_HISTOGRAM_BUCKETS - 1] = {250, 500, 1000, 2000, 5000, 10000, 20000};
+static WifiReconnectStats_t s_stats = {};
 
 void startAP()
 {
@@ -8,52 +34,225 @@ void startAP()
     Serial.println(WiFi.softAPIP());
 }
 
-void startSTA()
+static void loadLinkCache()
+{
+    s_cacheLoaded = true;
+    memset(&s_cache, 0, sizeof(s_cache));
+    File file = LittleFS.open(WIFI_CACHE_FILE, "r");
+    if (!file)
+    {
+        return;
+    }
+    size_t size = file.read((uint8_t *)&s_cache, sizeof(s_cache));
+    file.close();
+    if (size != sizeof(s_cache) || s_cache.magic != WIFI_CACHE_MAGIC ||
+        esp_rom_crc32_le(0, (const uint8_t *)&s_cache, offsetof(WifiLinkCache_t, crc)) != s_cache.crc)
+    {
+        memset(&s_cache, 0, sizeof(s_cache));
+    }
+}
+
+// Rewritten only when the AP or channel actually changed
+static void saveLinkCache(const String &ssid)
+{
+    WifiLinkCache_t cache;
+    memset(&cache, 0, sizeof(cache));
+    cache.magic = WIFI_CACHE_MAGIC;
+    strlcpy(cache.ssid, ssid.c_str(), sizeof(cache.ssid));
+    memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+    cache.channel = WiFi.channel();
+    cache.crc = esp_rom_crc32_le(0, (const uint8_t *)&cache, offsetof(WifiLinkCache_t, crc));
+    if (memcmp(&cache, &s_cache, sizeof(cache)) == 0)
+    {
+        return;
+    }
+    s_cache = cache;
+    File file = LittleFS.open(WIFI_CACHE_FILE, "w");
+    if (file)
+    {
+        file.write((const uint8_t *)&s_cache, sizeof(s_cache));
+        file.close();
+    }
+}
+
+// Static address from build flags, otherwise DHCP
+static void configureAddress()
+{
+#ifdef WIFI_STATIC_IP
+    IPAddress ip, gateway, subnet, dns;
+    ip.fromString(WIFI_STATIC_IP);
+    gateway.fromString(WIFI_STATIC_GATEWAY);
+    subnet.fromString(WIFI_STATIC_SUBNET);
+    dns.fromString(WIFI_STATIC_DNS);
+    WiFi.config(ip, gateway, subnet, dns);
+#else
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+#endif
+}
+
+static void beginAttempt(const String &ssid, const String &pass, bool direct)
+{
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false); // This state machine owns retries
+#ifdef POWER_SAVE_ENABLE
+    WiFi.setSleep(WIFI_PS_MAX_MODEM); // Radio wakes per DTIM instead of every beacon
+#endif
+    WiFi.disconnect();
+    const char *password = pass.isEmpty() ? NULL : pass.c_str();
+    s_phaseStart = esp_timer_get_time();
+    configureAddress();
+    if (direct)
+    {
+        // Skips the channel scan; DHCP still runs so the lease stays current
+        WiFi.begin(ssid.c_str(), password, s_cache.channel, s_cache.bssid, true);
+        s_state = WIFI_STATE_DIRECT;
+    }
+    else
+    {
+        WiFi.begin(ssid.c_str(), password);
+        s_state = WIFI_STATE_SCAN;
+    }
+    s_usedDirect = direct;
+}
+
+static void recordReconnect(uint32_t elapsedMs)
+{
+    size_t bucket = 0;
+    while (bucket < WIFI_HISTOGRAM_BUCKETS - 1 && elapsedMs >= s_histogramLimitsMs[bucket])
+    {
+        bucket++;
+    }
+    s_stats.histogram[bucket]++;
+    s_stats.lastMs = elapsedMs;
+    if (s_usedDirect)
+        s_stats.direct++;
+    else
+        s_stats.scan++;
+
+    Serial.printf("[WIFI] Connected (%s) in %u ms, IP %s ch %u\n", s_usedDirect ? "direct" : "scan",
+                  (unsigned)elapsedMs, WiFi.localIP().toString().c_str(), (unsigned)WiFi.channel());
+    Serial.print("[WIFI] Reconnect histogram <250/<500/<1k/<2k/<5k/<10k/<20k/more ms:");
+    for (size_t i = 0; i < WIFI_HISTOGRAM_BUCKETS; i++)
+    {
+        Serial.printf(" %u", (unsigned)s_stats.histogram[i]);
+    }
+    Serial.printf(", timeouts %u\n", (unsigned)s_stats.timeouts);
+}
+
+static void onConnected(const String &ssid)
+{
+    recordReconnect((uint32_t)((esp_timer_get_time() - s_attemptStart) / 1000));
+    s_state = WIFI_STATE_CONNECTED;
+    saveLinkCache(ssid);
+
+    if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+    {
+        if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
+        {
+            g_wifiConfig->isWifiConnected = true;
+            xSemaphoreGive(g_wifiConfig->mutex);
+        }
+    }
+    Config_reloadDone(CONFIG_CHANGED_WIFI);
+    bootMilestone(BOOT_WIFI_UP, "WiFi connected");
+}
+
+// Never blocks: starts or advances the reconnect and returns the link state.
+// Only the network supervisor calls this.
+bool Wifi_reconnect()
 {
     String ssid = "";
     String pass = "";
-    
-    if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL) {
-        if (xSemaphoreTake(g_wifiConfig->mutex, portMAX_DELAY) == pdTRUE) {
+    uint32_t version = 0;
+    if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL)
+    {
+        if (xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
+        {
             ssid = g_wifiConfig->WIFI_SSID;
             pass = g_wifiConfig->WIFI_PASS;
+            version = g_wifiConfig->wifiConfigVersion;
             xSemaphoreGive(g_wifiConfig->mutex);
         }
     }
-    
-    if (ssid.isEmpty())
-    {
-        vTaskDelete(NULL);
-    }
 
-    WiFi.mode(WIFI_STA);
+    bool connected = WiFi.status() == WL_CONNECTED;
+    int64_t now = esp_timer_get_time();
+    uint32_t phaseMs = (uint32_t)((now - s_phaseStart) / 1000);
 
-    if (pass.isEmpty())
+    // New credentials saved while an attempt was running: start over
+    if (s_state != WIFI_STATE_IDLE && s_state != WIFI_STATE_CONNECTED && version != s_version)
     {
-        WiFi.begin(ssid.c_str());
+        s_state = WIFI_STATE_IDLE;
+        connected = false;
     }
-    else
+
+    if (connected)
     {
-        WiFi.begin(ssid.c_str(), pass.c_str());
+        if (s_state != WIFI_STATE_CONNECTED)
+        {
+            onConnected(ssid);
+        }
     }
-
-    while (WiFi.status() != WL_CONNECTED)
+    else if (ssid.isEmpty())
     {
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+        s_state = WIFI_STATE_IDLE;
     }
-    //Give a semaphore here
-    if (g_wifiConfig != NULL && g_wifiConfig->xBinarySemaphoreInternet != NULL) {
-        xSemaphoreGive(g_wifiConfig->xBinarySemaphoreInternet);
+    else
+    {
+        switch (s_state)
+        {
+        case WIFI_STATE_CONNECTED:
+            Serial.println("[WIFI] Link lost, reconnecting...");
+            if (g_wifiConfig != NULL && g_wifiConfig->mutex != NULL &&
+                xSemaphoreTake(g_wifiConfig->mutex, pdMS_TO_TICKS(100)) == pdTRUE)
+            {
+                g_wifiConfig->isWifiConnected = false;
+                xSemaphoreGive(g_wifiConfig->mutex);
+            }
+            // fall through
+        case WIFI_STATE_IDLE:
+            if (!s_cacheLoaded)
+            {
+                loadLinkCache();
+            }
+            s_attemptStart = now;
+            s_version = version;
+            beginAttempt(ssid, pass, s_cache.magic == WIFI_CACHE_MAGIC && ssid == s_cache.ssid);
+            break;
+        case WIFI_STATE_DIRECT:
+            if (phaseMs > WIFI_DIRECT_TIMEOUT_MS)
+            {
+                Serial.println("[WIFI] Direct connect timed out, falling back to full scan");
+                beginAttempt(ssid, pass, false);
+            }
+            break;
+        case WIFI_STATE_SCAN:
+            if (phaseMs > WIFI_SCAN_TIMEOUT_MS)
+            {
+                Serial.printf("[WIFI] No connection after %u ms, retrying in %u ms\n",
+                              (unsigned)((now - s_attemptStart) / 1000), (unsigned)WIFI_RETRY_BACKOFF_MS);
+                s_stats.timeouts++;
+                WiFi.disconnect();
+                s_phaseStart = now;
+                s_state = WIFI_STATE_BACKOFF;
+            }
+            break;
+        case WIFI_STATE_BACKOFF:
+            if (phaseMs > WIFI_RETRY_BACKOFF_MS)
+            {
+                s_state = WIFI_STATE_IDLE;
+            }
+            break;
+        }
     }
+
+    return connected;
 }
 
-bool Wifi_reconnect()
+void getWifiReconnectStats(WifiReconnectStats_t *stats)
 {
-    const wl_status_t status = WiFi.status();
-    if (status == WL_CONNECTED)
+    if (stats != NULL)
     {
-        return true;
+        *stats = s_stats;
     }
-    startSTA();
-    return false;
 }
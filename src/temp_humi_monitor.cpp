@@ -1,19 +1,28 @@
 #include "temp_humi_monitor.h"
+#include <esp_timer.h>
 
 void temp_humi_monitor(void *pvParameters)
 {
-    vTaskDelay(pdMS_TO_TICKS(500));
-
     DHT20 dht20;
 
+    // The LCD's Wire.begin() is a no-op once the bus runs, so it must not win
+    // the race and claim the default pins: LCD waits on BOOT_I2C_READY
     Wire.begin(11, 12);
-    vTaskDelay(pdMS_TO_TICKS(100));
+    bootMilestone(BOOT_I2C_READY, "I2C ready");
 
     dht20.begin();
-    vTaskDelay(pdMS_TO_TICKS(500));
+    // DHT20 needs 100 ms from power-on before the first measurement
+    int64_t sinceBoot = esp_timer_get_time() / 1000;
+    if (sinceBoot < 100)
+    {
+        vTaskDelay(pdMS_TO_TICKS(100 - sinceBoot));
+    }
+
+    ts_store_begin();
 
     float temperature = 0.0;
     float humidity = 0.0;
+    TickType_t lastWake = 0;
 
     while (1)
     {
@@ -22,7 +31,8 @@ void temp_humi_monitor(void *pvParameters)
         humidity = dht20.getHumidity();
 
         // Check if any reads failed
-        if (isnan(temperature) || isnan(humidity))
+        bool readOk = !isnan(temperature) && !isnan(humidity);
+        if (!readOk)
         {
             Serial.println("[SENSOR] ERROR: Failed to read from DHT sensor!");
             temperature = 25.0; // Default safe values
@@ -32,6 +42,18 @@ void temp_humi_monitor(void *pvParameters)
         // Update shared data using semaphore-protected function
         setSensorData(temperature, humidity);
 
+        // Defaults keep the display going but are neither a first reading
+        // nor worth recording
+        if (readOk)
+        {
+            bootMilestone(BOOT_SENSOR_PRIMED, "First sensor reading");
+        }
+        if (readOk && history_timeValid())
+        {
+            history_append(temperature, humidity);
+            ts_store_append(history_now(), temperature, humidity);
+        }
+
         // Print the results to serial monitor
         Serial.print("[SENSOR] Temp: ");
         Serial.print(temperature);
@@ -39,14 +61,14 @@ void temp_humi_monitor(void *pvParameters)
         Serial.print(humidity);
         Serial.println("%");
 
-        // Read sensor every 1sec
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        // Read sensor every 1sec, on the shared wakeup grid
+        power_waitNextPeriod(&lastWake);
     }
 }
 
 void lcd_display_task(void *pvParameters)
 {
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    waitBootEvents(BOOT_I2C_READY);
 
     // Serial.println("[LCD] Task starting - Initializing display...");
 
@@ -58,7 +80,8 @@ void lcd_display_task(void *pvParameters)
 
     lcd.setCursor(0, 0);
     lcd.print("System Ready");
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    // Splash stays up only until there is a reading to show
+    waitBootEvents(BOOT_SENSOR_PRIMED);
     lcd.clear();
 
     Serial.println("[LCD] Display initialized successfully");
@@ -67,6 +90,7 @@ void lcd_display_task(void *pvParameters)
     float humidity = 0.0;
     DisplayState_t currentState = DISPLAY_NORMAL;
     DisplayState_t previousState = DISPLAY_NORMAL;
+    TickType_t lastWake = 0;
 
     while (1)
     {
@@ -148,7 +172,7 @@ void lcd_display_task(void *pvParameters)
             break;
         }
 
-        // Update display every 1 second
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        // Update display every 1 second, right after the sensor read
+        power_waitNextPeriod(&lastWake);
     }
 }
\ No newline at end of file
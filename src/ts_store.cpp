@@ -0,0 +1,286 @@
+#include "ts_store.h"
+
+#define TS_PAYLOAD_BITS ((TS_BLOCK_SIZE - sizeof(TsBlockHeader_t)) * 8)
+// Worst case for one sample: 4 + 32 timestamp bits, 2 + 5 + 5 + 32 per channel
+#define TS_SAMPLE_MAX_BITS (36 + TS_CHANNELS * 44)
+
+static uint8_t s_block[TS_BLOCK_SIZE];
+static TsBlockHeader_t *const s_header = (TsBlockHeader_t *)s_block;
+static uint8_t *const s_payload = s_block + sizeof(TsBlockHeader_t);
+static size_t s_bitPos = 0;
+
+// Encoder state, reset per block so every block decodes on its own
+static int32_t s_prevDelta = 0;
+static uint32_t s_prevValue[TS_CHANNELS];
+static uint8_t s_prevLead[TS_CHANNELS];
+static uint8_t s_prevTrail[TS_CHANNELS];
+
+static bool s_ready = false;
+static uint32_t s_firstFile = 0;
+static uint32_t s_currentFile = 0;
+static uint32_t s_fileCount = 0;
+static uint32_t s_blocksInFile = 0;
+static TsStoreStats_t s_stats = {0, 0, 0, 0, 0};
+
+static String segmentPath(uint32_t file, const char *ext)
+{
+    char path[32];
+    snprintf(path, sizeof(path), TS_DIR "/%08u.%s", (unsigned)file, ext);
+    return String(path);
+}
+
+static void putBits(uint32_t value, uint8_t count)
+{
+    while (count > 0)
+    {
+        count--;
+        if ((value >> count) & 1)
+        {
+            s_payload[s_bitPos >> 3] |= 0x80 >> (s_bitPos & 7);
+        }
+        s_bitPos++;
+    }
+}
+
+static void putValue(uint8_t ch, float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t x = bits ^ s_prevValue[ch];
+    s_prevValue[ch] = bits;
+    if (x == 0)
+    {
+        putBits(0, 1);
+        return;
+    }
+    uint8_t lead = __builtin_clz(x);
+    uint8_t trail = __builtin_ctz(x);
+    if (s_prevLead[ch] <= 31 && lead >= s_prevLead[ch] && trail >= s_prevTrail[ch])
+    {
+        putBits(0b10, 2);
+        putBits(x >> s_prevTrail[ch], 32 - s_prevLead[ch] - s_prevTrail[ch]);
+        return;
+    }
+    uint8_t len = 32 - lead - trail;
+    putBits(0b11, 2);
+    putBits(lead, 5);
+    putBits(len - 1, 5);
+    putBits(x >> trail, len);
+    s_prevLead[ch] = lead;
+    s_prevTrail[ch] = trail;
+}
+
+static void putTimestamp(uint32_t time)
+{
+    int32_t delta = (int32_t)(time - s_header->lastTime);
+    int32_t dod = delta - s_prevDelta;
+    s_prevDelta = delta;
+    if (dod == 0)
+    {
+        putBits(0, 1);
+    }
+    else if (dod >= -63 && dod <= 64)
+    {
+        putBits(0b10, 2);
+        putBits(dod + 63, 7);
+    }
+    else if (dod >= -255 && dod <= 256)
+    {
+        putBits(0b110, 3);
+        putBits(dod + 255, 9);
+    }
+    else if (dod >= -2047 && dod <= 2048)
+    {
+        putBits(0b1110, 4);
+        putBits(dod + 2047, 12);
+    }
+    else
+    {
+        putBits(0b1111, 4);
+        putBits((uint32_t)dod, 32);
+    }
+}
+
+static void resetBlock()
+{
+    memset(s_block, 0, sizeof(s_block));
+    s_header->magic = TS_BLOCK_MAGIC;
+    s_header->version = TS_BLOCK_VERSION;
+    s_header->channels = TS_CHANNELS;
+    s_bitPos = 0;
+    s_prevDelta = 0;
+    for (uint8_t ch = 0; ch < TS_CHANNELS; ch++)
+    {
+        s_prevValue[ch] = 0;
+        s_prevLead[ch] = 0xFF; // No window yet
+        s_prevTrail[ch] = 0;
+    }
+}
+
+// Drop the oldest segment once the store holds more than TS_MAX_FILES
+static void rotateSegments()
+{
+    while (s_fileCount > TS_MAX_FILES && s_firstFile < s_currentFile)
+    {
+        String data = segmentPath(s_firstFile, "tsd");
+        if (LittleFS.exists(data))
+        {
+            LittleFS.remove(data);
+            LittleFS.remove(segmentPath(s_firstFile, "tsi"));
+            s_fileCount--;
+            s_stats.rotations++;
+        }
+        s_firstFile++;
+    }
+}
+
+// Whole blocks only: the segment grows in TS_BLOCK_SIZE steps, so LittleFS sees
+// one aligned append every ~50-100 samples instead of a small one per sample
+static void sealBlock()
+{
+    if (s_header->count == 0)
+    {
+        return;
+    }
+    s_header->bits = s_bitPos;
+
+    File data = LittleFS.open(segmentPath(s_currentFile, "tsd"), "a");
+    File index = LittleFS.open(segmentPath(s_currentFile, "tsi"), "a");
+    if (!data || !index)
+    {
+        Serial.println("[TSDB] ERROR: Failed to open segment for writing!");
+        resetBlock();
+        return;
+    }
+    TsIndexEntry_t entry = {s_header->firstTime, s_header->lastTime};
+    size_t written = data.write(s_block, TS_BLOCK_SIZE);
+    written += index.write((const uint8_t *)&entry, sizeof(entry));
+    data.close();
+    index.close();
+
+    if (s_blocksInFile == 0)
+    {
+        s_fileCount++;
+    }
+    s_blocksInFile++;
+    s_stats.samples += s_header->count;
+    s_stats.blocks++;
+    s_stats.payloadBytes += (s_bitPos + 7) / 8;
+    s_stats.fsBytes += written;
+
+    Serial.printf("[TSDB] Block %u/%u of %08u: %u samples, %.2f B/sample, write amp %.2f\n",
+                  (unsigned)s_blocksInFile, (unsigned)TS_BLOCKS_PER_FILE, (unsigned)s_currentFile,
+                  (unsigned)s_header->count, (float)TS_BLOCK_SIZE / s_header->count,
+                  (float)s_stats.fsBytes / s_stats.payloadBytes);
+
+    if (s_blocksInFile >= TS_BLOCKS_PER_FILE)
+    {
+        s_currentFile++;
+        s_blocksInFile = 0;
+    }
+    rotateSegments();
+    resetBlock();
+}
+
+bool ts_store_begin()
+{
+    if (!LittleFS.exists(TS_DIR) && !LittleFS.mkdir(TS_DIR))
+    {
+        Serial.println("[TSDB] ERROR: Failed to create " TS_DIR);
+        return false;
+    }
+
+    bool found = false;
+    uint32_t first = 0, last = 0;
+    File dir = LittleFS.open(TS_DIR);
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile())
+    {
+        const char *name = strrchr(f.name(), '/');
+        name = name ? name + 1 : f.name();
+        if (strstr(name, ".tsd") == NULL)
+        {
+            continue;
+        }
+        uint32_t number = strtoul(name, NULL, 10);
+        first = found ? min(first, number) : number;
+        last = found ? max(last, number) : number;
+        found = true;
+        s_fileCount++;
+    }
+    dir.close();
+
+    s_firstFile = first;
+    s_currentFile = last;
+    if (found)
+    {
+        // Keep appending to the newest segment only if data and index agree;
+        // a power cut between the two writes starts a fresh segment instead
+        File data = LittleFS.open(segmentPath(last, "tsd"), "r");
+        File index = LittleFS.open(segmentPath(last, "tsi"), "r");
+        size_t blocks = data ? data.size() / TS_BLOCK_SIZE : 0;
+        size_t entries = index ? index.size() / sizeof(TsIndexEntry_t) : 0;
+        bool consistent = data && index && data.size() % TS_BLOCK_SIZE == 0 && blocks == entries;
+        data.close();
+        index.close();
+        if (consistent && blocks < TS_BLOCKS_PER_FILE)
+        {
+            s_blocksInFile = blocks;
+            if (blocks == 0)
+            {
+                s_fileCount--; // Counted again when its first block lands
+            }
+        }
+        else
+        {
+            s_currentFile = last + 1;
+        }
+    }
+
+    resetBlock();
+    s_ready = true;
+    Serial.printf("[TSDB] %u segments (%08u..%08u), appending to %08u\n",
+                  (unsigned)s_fileCount, (unsigned)s_firstFile, (unsigned)last, (unsigned)s_currentFile);
+    return true;
+}
+
+void ts_store_append(uint32_t time, float temp, float humi)
+{
+    if (!s_ready)
+    {
+        return;
+    }
+    // A clock step backwards (SNTP correction, manual set) starts a new block
+    if (s_header->count > 0 && (s_bitPos + TS_SAMPLE_MAX_BITS > TS_PAYLOAD_BITS || time < s_header->lastTime))
+    {
+        sealBlock();
+    }
+
+    float values[TS_CHANNELS] = {temp, humi};
+    if (s_header->count == 0)
+    {
+        s_header->firstTime = time;
+        for (uint8_t ch = 0; ch < TS_CHANNELS; ch++)
+        {
+            memcpy(&s_prevValue[ch], &values[ch], sizeof(uint32_t));
+            putBits(s_prevValue[ch], 32);
+        }
+    }
+    else
+    {
+        putTimestamp(time);
+        for (uint8_t ch = 0; ch < TS_CHANNELS; ch++)
+        {
+            putValue(ch, values[ch]);
+        }
+    }
+    s_header->lastTime = time;
+    s_header->count++;
+}
+
+void getTsStoreStats(TsStoreStats_t *stats)
+{
+    if (stats != NULL)
+    {
+        *stats = s_stats;
+    }
+}
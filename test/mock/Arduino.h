@@ -0,0 +1,100 @@
+#ifndef __MOCK_ARDUINO_H__
+#define __MOCK_ARDUINO_H__
+
+// Host stand-in for the parts of the Arduino-ESP32 core the native tests
+// reach. Time is real (steady clock), Serial goes to stdout, and
+// ESP.getFreeHeap() reports what the test counted in g_mockHeapUsed (see
+// mock_heap.h), since the host heap says nothing about the device's.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "avr/pgmspace.h"
+#include "WString.h"
+#include "Print.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// newlib has it, glibc only since 2.38
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size > 0)
+    {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
+
+using std::max;
+using std::min;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline unsigned long micros()
+{
+    using namespace std::chrono;
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline unsigned long millis()
+{
+    return micros() / 1000UL;
+}
+
+inline void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void yield() {}
+
+inline long random(long howbig)
+{
+    return howbig > 0 ? rand() % howbig : 0;
+}
+
+inline long random(long howsmall, long howbig)
+{
+    return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+class HardwareSerial : public Print
+{
+public:
+    size_t write(uint8_t c) override
+    {
+        return fputc(c, stdout) == EOF ? 0 : 1;
+    }
+};
+
+inline HardwareSerial Serial;
+
+// Heap the code under test allocated since the test started counting
+#define MOCK_HEAP_SIZE (320U * 1024U)
+inline size_t g_mockHeapUsed = 0;
+
+class EspClass
+{
+public:
+    uint32_t getFreeHeap() const
+    {
+        return MOCK_HEAP_SIZE - (uint32_t)g_mockHeapUsed;
+    }
+};
+
+inline EspClass ESP;
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef __MOCK_ASYNCTCP_H__
+#define __MOCK_ASYNCTCP_H__
+
+#include <stddef.h>
+
+// Only the send window is modelled; tests shrink it to simulate a slow peer
+class AsyncClient
+{
+public:
+    size_t space() const { return m_space; }
+    void setSpace(size_t space) { m_space = space; }
+
+private:
+    size_t m_space = 5744; // lwIP TCP_SND_BUF on the ESP32
+};
+
+#endif
@@ -0,0 +1,549 @@
+#ifndef __MOCK_ESPASYNCWEBSERVER_H__
+#define __MOCK_ESPASYNCWEBSERVER_H__
+
+// Host stand-in for ESPAsyncWebServer. Nothing goes on the wire: WebSocket
+// frames and SSE messages stay queued on their client until the test drains
+// them, responses are kept on the request so the test can pull the body.
+// Where the library copies per client (SSE messages) or shares a buffer
+// (AsyncWebSocketSharedBuffer), the mock does the same, so allocations the
+// test counts follow the library's.
+#include <functional>
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "AsyncTCP.h"
+#include "IPAddress.h"
+#include "LittleFS.h"
+
+#define WS_MAX_QUEUED_MESSAGES 32
+
+typedef std::shared_ptr<std::vector<uint8_t>> AsyncWebSocketSharedBuffer;
+
+typedef enum
+{
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef enum
+{
+    WS_EVT_CONNECT,
+    WS_EVT_DISCONNECT,
+    WS_EVT_PONG,
+    WS_EVT_ERROR,
+    WS_EVT_DATA
+} AwsEventType;
+
+typedef enum
+{
+    WS_DISCONNECTED,
+    WS_CONNECTED,
+    WS_DISCONNECTING
+} AwsClientStatus;
+
+typedef enum
+{
+    WS_CONTINUATION,
+    WS_TEXT,
+    WS_BINARY,
+    WS_DISCONNECT = 0x08,
+    WS_PING,
+    WS_PONG
+} AwsFrameType;
+
+typedef struct
+{
+    uint8_t message_opcode;
+    uint32_t num;
+    uint8_t final;
+    uint8_t masked;
+    uint8_t opcode;
+    uint64_t len;
+    uint8_t mask[4];
+    uint64_t index;
+} AwsFrameInfo;
+
+class AsyncWebParameter
+{
+public:
+    AsyncWebParameter(const String &name, const String &value) : m_name(name), m_value(value) {}
+    const String &name() const { return m_name; }
+    const String &value() const { return m_value; }
+
+private:
+    String m_name;
+    String m_value;
+};
+
+typedef AsyncWebParameter AsyncWebHeader;
+
+class AsyncWebServerResponse
+{
+public:
+    AsyncWebServerResponse(int code, const String &contentType) : m_code(code), m_contentType(contentType) {}
+    virtual ~AsyncWebServerResponse() {}
+
+    void addHeader(const String &name, const String &value) { m_headers.emplace_back(name, value); }
+
+    int code() const { return m_code; }
+    const String &contentType() const { return m_contentType; }
+    String header(const String &name) const
+    {
+        for (const AsyncWebHeader &h : m_headers)
+        {
+            if (h.name() == name)
+            {
+                return h.value();
+            }
+        }
+        return String();
+    }
+
+    // Next part of the body, at most maxLen bytes like one TCP send; 0 once done
+    virtual size_t fill(uint8_t *buffer, size_t maxLen) = 0;
+
+private:
+    int m_code;
+    String m_contentType;
+    std::list<AsyncWebHeader> m_headers;
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse
+{
+public:
+    AsyncBasicResponse(int code, const String &contentType, const uint8_t *content, size_t length)
+        : AsyncWebServerResponse(code, contentType), m_content(content, content + length), m_sent(0) {}
+
+    size_t fill(uint8_t *buffer, size_t maxLen) override
+    {
+        size_t n = min(maxLen, m_content.size() - m_sent);
+        memcpy(buffer, m_content.data() + m_sent, n);
+        m_sent += n;
+        return n;
+    }
+
+private:
+    std::vector<uint8_t> m_content;
+    size_t m_sent;
+};
+
+typedef std::function<size_t(uint8_t *, size_t, size_t)> AwsResponseFiller;
+
+class AsyncChunkedResponse : public AsyncWebServerResponse
+{
+public:
+    AsyncChunkedResponse(const String &contentType, AwsResponseFiller filler)
+        : AsyncWebServerResponse(200, contentType), m_filler(filler), m_index(0) {}
+
+    size_t fill(uint8_t *buffer, size_t maxLen) override
+    {
+        size_t n = m_filler(buffer, maxLen, m_index);
+        m_index += n;
+        return n;
+    }
+
+private:
+    AwsResponseFiller m_filler;
+    size_t m_index;
+};
+
+class AsyncWebServerRequest
+{
+public:
+    explicit AsyncWebServerRequest(const String &url) : m_url(url) {}
+
+    // Test side: what the client sent
+    void addParam(const String &name, const String &value) { m_params.emplace_back(name, value); }
+    void addHeader(const String &name, const String &value) { m_headers.emplace_back(name, value); }
+
+    const String &url() const { return m_url; }
+    bool hasParam(const String &name, bool = false) const { return getParam(name) != NULL; }
+    AsyncWebParameter *getParam(const String &name, bool = false) const { return find(m_params, name); }
+    bool hasHeader(const String &name) const { return getHeader(name) != NULL; }
+    AsyncWebHeader *getHeader(const String &name) const { return find(m_headers, name); }
+    String header(const char *name) const
+    {
+        AsyncWebHeader *h = getHeader(name);
+        return h != NULL ? h->value() : String();
+    }
+    bool hasArg(const char *name) const { return hasParam(name); }
+    const String &arg(const String &name) const
+    {
+        static const String empty;
+        AsyncWebParameter *p = getParam(name);
+        return p != NULL ? p->value() : empty;
+    }
+
+    AsyncWebServerResponse *beginResponse(int code, const String &contentType = String(), const String &content = String())
+    {
+        return new AsyncBasicResponse(code, contentType, (const uint8_t *)content.c_str(), content.length());
+    }
+    AsyncWebServerResponse *beginResponse(int code, const String &contentType, const uint8_t *content, size_t length)
+    {
+        return new AsyncBasicResponse(code, contentType, content, length);
+    }
+    AsyncWebServerResponse *beginChunkedResponse(const String &contentType, AwsResponseFiller filler)
+    {
+        return new AsyncChunkedResponse(contentType, filler);
+    }
+
+    void send(AsyncWebServerResponse *response) { m_response.reset(response); }
+    void send(int code, const String &contentType = String(), const String &content = String())
+    {
+        send(beginResponse(code, contentType, content));
+    }
+    void send(FS &, const String &, const String &contentType = String(), bool = false)
+    {
+        send(404, contentType);
+    }
+
+    // Test side: what the handler answered, NULL if nothing yet
+    AsyncWebServerResponse *response() const { return m_response.get(); }
+
+private:
+    static AsyncWebParameter *find(const std::list<AsyncWebParameter> &list, const String &name)
+    {
+        for (const AsyncWebParameter &p : list)
+        {
+            if (p.name() == name)
+            {
+                return const_cast<AsyncWebParameter *>(&p);
+            }
+        }
+        return NULL;
+    }
+
+    String m_url;
+    std::list<AsyncWebParameter> m_params;
+    std::list<AsyncWebHeader> m_headers;
+    std::unique_ptr<AsyncWebServerResponse> m_response;
+};
+
+typedef std::function<void(AsyncWebServerRequest *)> ArRequestHandlerFunction;
+
+class AsyncWebHandler
+{
+public:
+    virtual ~AsyncWebHandler() {}
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler
+{
+public:
+    AsyncCallbackWebHandler(const String &uri, WebRequestMethod method, ArRequestHandlerFunction onRequest)
+        : m_uri(uri), m_method(method), m_onRequest(onRequest) {}
+
+    bool canHandle(const String &url) const { return m_uri == url; }
+    void handleRequest(AsyncWebServerRequest *request) { m_onRequest(request); }
+
+private:
+    String m_uri;
+    WebRequestMethod m_method;
+    ArRequestHandlerFunction m_onRequest;
+};
+
+class AsyncStaticWebHandler : public AsyncWebHandler
+{
+public:
+    AsyncStaticWebHandler &setDefaultFile(const char *) { return *this; }
+    AsyncStaticWebHandler &setCacheControl(const char *) { return *this; }
+};
+
+class AsyncWebSocketClient
+{
+public:
+    explicit AsyncWebSocketClient(uint32_t id) : m_id(id), m_status(WS_CONNECTED) {}
+
+    uint32_t id() const { return m_id; }
+    AwsClientStatus status() const { return m_status; }
+    size_t queueLen() const { return m_queue.size(); }
+    AsyncClient *client() { return &m_tcp; }
+    IPAddress remoteIP() const { return IPAddress(192, 168, 4, (uint8_t)m_id); }
+
+    bool text(AsyncWebSocketSharedBuffer buffer) { return queue(buffer, false); }
+    bool binary(AsyncWebSocketSharedBuffer buffer) { return queue(buffer, true); }
+    bool text(const char *message)
+    {
+        return text(std::make_shared<std::vector<uint8_t>>(message, message + strlen(message)));
+    }
+    bool text(const String &message) { return text(message.c_str()); }
+    void close(uint16_t code = 0, const char * = NULL)
+    {
+        m_status = WS_DISCONNECTED;
+        m_closeCode = code;
+    }
+    uint16_t closeCode() const { return m_closeCode; }
+
+    // Test side: frames waiting to be sent, and sending them
+    typedef struct
+    {
+        AsyncWebSocketSharedBuffer buffer;
+        bool binary;
+    } Frame_t;
+    const std::deque<Frame_t> &queued() const { return m_queue; }
+    size_t drain()
+    {
+        size_t n = m_queue.size();
+        m_queue.clear();
+        return n;
+    }
+
+private:
+    bool queue(const AsyncWebSocketSharedBuffer &buffer, bool binary)
+    {
+        if (m_status != WS_CONNECTED || !buffer || m_queue.size() >= WS_MAX_QUEUED_MESSAGES)
+        {
+            return false;
+        }
+        m_queue.push_back(Frame_t{buffer, binary});
+        return true;
+    }
+
+    uint32_t m_id;
+    AwsClientStatus m_status;
+    uint16_t m_closeCode = 0;
+    AsyncClient m_tcp;
+    std::deque<Frame_t> m_queue;
+};
+
+class AsyncWebSocket;
+typedef std::function<void(AsyncWebSocket *, AsyncWebSocketClient *, AwsEventType, void *, uint8_t *, size_t)> AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler
+{
+public:
+    explicit AsyncWebSocket(const String &url) : m_url(url) {}
+
+    void onEvent(AwsEventHandler handler) { m_handler = handler; }
+    std::list<AsyncWebSocketClient> &getClients() { return m_clients; }
+
+    size_t count() const
+    {
+        size_t n = 0;
+        for (const AsyncWebSocketClient &c : m_clients)
+        {
+            n += c.status() == WS_CONNECTED;
+        }
+        return n;
+    }
+
+    // One buffer shared by every client, like the library
+    void textAll(const char *message)
+    {
+        AsyncWebSocketSharedBuffer buffer = std::make_shared<std::vector<uint8_t>>(message, message + strlen(message));
+        for (AsyncWebSocketClient &c : m_clients)
+        {
+            c.text(buffer);
+        }
+    }
+    void textAll(const String &message) { textAll(message.c_str()); }
+    void closeAll(uint16_t = 0, const char * = NULL)
+    {
+        for (AsyncWebSocketClient &c : m_clients)
+        {
+            c.close();
+        }
+    }
+    void cleanupClients(uint16_t = 8) {}
+
+    // Test side: a client completing the handshake, optionally asking for a subprotocol
+    AsyncWebSocketClient *connect(uint32_t id, const char *protocol = NULL)
+    {
+        m_clients.emplace_back(id);
+        AsyncWebServerRequest request(m_url);
+        if (protocol != NULL)
+        {
+            request.addHeader("Sec-WebSocket-Protocol", protocol);
+        }
+        if (m_handler)
+        {
+            m_handler(this, &m_clients.back(), WS_EVT_CONNECT, &request, NULL, 0);
+        }
+        return &m_clients.back();
+    }
+
+    void disconnect(uint32_t id)
+    {
+        for (auto it = m_clients.begin(); it != m_clients.end(); ++it)
+        {
+            if (it->id() == id)
+            {
+                it->close();
+                if (m_handler)
+                {
+                    m_handler(this, &*it, WS_EVT_DISCONNECT, NULL, NULL, 0);
+                }
+                m_clients.erase(it);
+                return;
+            }
+        }
+    }
+
+private:
+    String m_url;
+    AwsEventHandler m_handler;
+    std::list<AsyncWebSocketClient> m_clients;
+};
+
+class AsyncEventSourceClient
+{
+public:
+    explicit AsyncEventSourceClient(uint32_t lastId) : m_lastId(lastId), m_connected(true) {}
+
+    // Every client queues its own copy of the formatted message, like the library
+    void send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0)
+    {
+        if (m_connected)
+        {
+            m_queue.push_back(format(message, event, id, reconnect));
+        }
+    }
+    uint32_t lastId() const { return m_lastId; }
+    bool connected() const { return m_connected; }
+    size_t packetsWaiting() const { return m_queue.size(); }
+    void close() { m_connected = false; }
+
+    // Test side: messages waiting to be sent, and sending them
+    const std::deque<std::string> &queued() const { return m_queue; }
+    size_t drain()
+    {
+        size_t n = m_queue.size();
+        m_queue.clear();
+        return n;
+    }
+
+    static std::string format(const char *message, const char *event, uint32_t id, uint32_t reconnect)
+    {
+        std::string text;
+        if (reconnect)
+        {
+            text += "retry: " + std::to_string(reconnect) + "\r\n";
+        }
+        if (id)
+        {
+            text += "id: " + std::to_string(id) + "\r\n";
+        }
+        if (event != NULL)
+        {
+            text += std::string("event: ") + event + "\r\n";
+        }
+        if (message != NULL)
+        {
+            text += std::string("data: ") + message + "\r\n";
+        }
+        return text + "\r\n";
+    }
+
+private:
+    uint32_t m_lastId;
+    bool m_connected;
+    std::deque<std::string> m_queue;
+};
+
+typedef std::function<void(AsyncEventSourceClient *)> ArEventHandlerFunction;
+
+class AsyncEventSource : public AsyncWebHandler
+{
+public:
+    explicit AsyncEventSource(const String &url) : m_url(url) {}
+
+    void onConnect(ArEventHandlerFunction handler) { m_handler = handler; }
+
+    void send(const char *message, const char *event = NULL, uint32_t id = 0, uint32_t reconnect = 0)
+    {
+        for (AsyncEventSourceClient &c : m_clients)
+        {
+            c.send(message, event, id, reconnect);
+        }
+    }
+
+    size_t count() const
+    {
+        size_t n = 0;
+        for (const AsyncEventSourceClient &c : m_clients)
+        {
+            n += c.connected();
+        }
+        return n;
+    }
+
+    void close()
+    {
+        for (AsyncEventSourceClient &c : m_clients)
+        {
+            c.close();
+        }
+    }
+
+    // Test side: a client opening the stream, lastId from its Last-Event-ID header
+    AsyncEventSourceClient *connect(uint32_t lastId = 0)
+    {
+        m_clients.emplace_back(lastId);
+        if (m_handler)
+        {
+            m_handler(&m_clients.back());
+        }
+        return &m_clients.back();
+    }
+
+    std::list<AsyncEventSourceClient> &getClients() { return m_clients; }
+
+private:
+    String m_url;
+    ArEventHandlerFunction m_handler;
+    std::list<AsyncEventSourceClient> m_clients;
+};
+
+class AsyncWebServer
+{
+public:
+    explicit AsyncWebServer(uint16_t port) : m_port(port), m_running(false) {}
+
+    void begin() { m_running = true; }
+    void end() { m_running = false; }
+    bool running() const { return m_running; }
+
+    AsyncWebHandler &addHandler(AsyncWebHandler *handler) { return *handler; }
+    bool removeHandler(AsyncWebHandler *) { return true; }
+
+    AsyncCallbackWebHandler &on(const char *uri, WebRequestMethod method, ArRequestHandlerFunction onRequest)
+    {
+        m_handlers.emplace_back(uri, method, onRequest);
+        return m_handlers.back();
+    }
+
+    AsyncStaticWebHandler &serveStatic(const char *, FS &, const char *, const char * = NULL)
+    {
+        m_static.emplace_back();
+        return m_static.back();
+    }
+
+    void onNotFound(ArRequestHandlerFunction) {}
+    void reset() { m_handlers.clear(); }
+
+    // Test side: dispatches to the handler registered with on(), false if none
+    bool handle(AsyncWebServerRequest *request)
+    {
+        for (AsyncCallbackWebHandler &h : m_handlers)
+        {
+            if (h.canHandle(request->url()))
+            {
+                h.handleRequest(request);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    uint16_t m_port;
+    bool m_running;
+    std::list<AsyncCallbackWebHandler> m_handlers;
+    std::list<AsyncStaticWebHandler> m_static;
+};
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef __MOCK_ELEGANTOTA_H__
+#define __MOCK_ELEGANTOTA_H__
+
+class AsyncWebServer;
+
+class ElegantOTAClass
+{
+public:
+    void begin(AsyncWebServer *) {}
+    void loop() {}
+};
+
+inline ElegantOTAClass ElegantOTA;
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef __MOCK_IPADDRESS_H__
+#define __MOCK_IPADDRESS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include "WString.h"
+
+class IPAddress
+{
+public:
+    IPAddress() : m_octets{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : m_octets{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return m_octets[index]; }
+
+    String toString() const
+    {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", m_octets[0], m_octets[1], m_octets[2], m_octets[3]);
+        return String(buffer);
+    }
+
+private:
+    uint8_t m_octets[4];
+};
+
+#endif
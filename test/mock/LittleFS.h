@@ -0,0 +1,32 @@
+#ifndef __MOCK_LITTLEFS_H__
+#define __MOCK_LITTLEFS_H__
+
+// Empty filesystem: nothing exists and every open fails
+#include "Arduino.h"
+
+class File
+{
+public:
+    explicit operator bool() const { return false; }
+    File openNextFile() { return File(); }
+    const char *name() const { return ""; }
+    size_t size() const { return 0; }
+    size_t read(uint8_t *, size_t) { return 0; }
+    size_t write(const uint8_t *, size_t) { return 0; }
+    void close() {}
+};
+
+class FS
+{
+public:
+    bool begin(bool = false) { return true; }
+    bool exists(const char *) { return false; }
+    File open(const char *, const char * = "r", bool = false) { return File(); }
+    bool remove(const char *) { return false; }
+    bool rename(const char *, const char *) { return false; }
+    bool mkdir(const char *) { return false; }
+};
+
+inline FS LittleFS;
+
+#endif
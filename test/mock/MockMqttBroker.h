@@ -0,0 +1,296 @@
+#ifndef __MOCK_MQTT_BROKER_H__
+#define __MOCK_MQTT_BROKER_H__
+
+// In-process MQTT broker behind the Client interface PubSubClient talks to.
+// Outbound bytes are split into packets and answered like a broker would
+// (CONNACK, PUBACK, SUBACK, PINGRESP); inbound bytes are handed out at most
+// one TCP segment per available(), as lwIP does. Every packet the client sent
+// is kept in packets for the test to decode.
+#include <deque>
+#include <utility>
+#include <vector>
+#include "Arduino.h"
+#include "Client.h"
+
+class MockMqttBroker : public Client
+{
+public:
+    // Broker behaviour, change before the client connects
+    bool acceptV5 = true;          // false answers an MQTT 5 CONNECT with "unacceptable protocol version"
+    uint16_t topicAliasMax = 10;   // Topic Alias Maximum in the MQTT 5 CONNACK
+    unsigned long ackDelayMs = 0;  // PUBACK latency (round trip)
+    size_t segmentSize = 1436;     // Inbound bytes available() reports at once
+    size_t writeLimit = SIZE_MAX;  // Bytes one write() accepts, less makes short writes
+    unsigned long writeCostUs = 0; // Time one write() keeps the caller busy, as lwIP's copy and send would
+
+    // What went over the wire
+    std::vector<std::vector<uint8_t>> packets; // Complete outbound packets
+    size_t bytesSent = 0;
+    uint32_t writes = 0;
+    uint32_t reads = 0; // available() and read() calls
+    uint32_t connects = 0;
+    uint8_t protocolLevel = 0; // Of the last CONNECT
+
+    // Queues bytes for the client to read, e.g. a PUBLISH built by publishPacket()
+    void inject(const std::vector<uint8_t> &bytes)
+    {
+        m_rx.insert(m_rx.end(), bytes.begin(), bytes.end());
+    }
+
+    // Link dies without a DISCONNECT: answers not sent yet are lost
+    void dropLink()
+    {
+        m_up = false;
+        m_pending.clear();
+    }
+
+    // Holds every answer back until releaseAcks() (a stalled broker)
+    void holdAcks(bool hold) { m_holdAcks = hold; }
+    void releaseAcks()
+    {
+        m_holdAcks = false;
+        for (auto &p : m_pending)
+        {
+            p.first = 0;
+        }
+    }
+
+    // PUBLISH packets sent, optionally only those with DUP set
+    size_t publishes(bool dupOnly = false) const
+    {
+        size_t n = 0;
+        for (const auto &p : packets)
+        {
+            if ((p[0] & 0xF0) == 0x30 && (!dupOnly || (p[0] & 0x08)))
+            {
+                n++;
+            }
+        }
+        return n;
+    }
+
+    // Packet id of a QoS 1 PUBLISH packet
+    static uint16_t publishId(const std::vector<uint8_t> &p)
+    {
+        size_t i = bodyStart(p);
+        size_t topicLength = (p[i] << 8) | p[i + 1];
+        return (p[i + 2 + topicLength] << 8) | p[i + 3 + topicLength];
+    }
+
+    // Offset of the variable header, after the fixed header's remaining length
+    static size_t bodyStart(const std::vector<uint8_t> &p)
+    {
+        size_t i = 1;
+        while (p[i++] & 0x80)
+        {
+        }
+        return i;
+    }
+
+    // PUBLISH from the broker; payload byte i is i * 7 + 3 so tests can check it
+    static std::vector<uint8_t> publishPacket(const char *topic, size_t payloadLength, uint8_t qos = 0, uint16_t id = 1)
+    {
+        std::vector<uint8_t> body;
+        size_t topicLength = strlen(topic);
+        body.push_back(topicLength >> 8);
+        body.push_back(topicLength & 0xFF);
+        body.insert(body.end(), topic, topic + topicLength);
+        if (qos > 0)
+        {
+            body.push_back(id >> 8);
+            body.push_back(id & 0xFF);
+        }
+        for (size_t i = 0; i < payloadLength; i++)
+        {
+            body.push_back((uint8_t)(i * 7 + 3));
+        }
+        std::vector<uint8_t> packet{(uint8_t)(0x30 | (qos << 1))};
+        size_t length = body.size();
+        do
+        {
+            uint8_t digit = length & 0x7F;
+            length >>= 7;
+            packet.push_back(length ? digit | 0x80 : digit);
+        } while (length);
+        packet.insert(packet.end(), body.begin(), body.end());
+        return packet;
+    }
+
+    int connect(IPAddress, uint16_t) override { return open(); }
+    int connect(const char *, uint16_t) override { return open(); }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        writes++;
+        if (!m_up)
+        {
+            return 0;
+        }
+        size = min(size, writeLimit);
+        for (unsigned long start = micros(); micros() - start < writeCostUs;)
+        {
+        }
+        bytesSent += size;
+        m_out.insert(m_out.end(), buffer, buffer + size);
+        parse();
+        return size;
+    }
+
+    int available() override
+    {
+        reads++;
+        deliver();
+        size_t left = m_rx.size() - m_rxPos;
+        size_t segmentLeft = segmentSize - (m_rxPos % segmentSize);
+        return (int)min(left, segmentLeft);
+    }
+
+    int read() override
+    {
+        reads++;
+        deliver();
+        return m_rxPos < m_rx.size() ? m_rx[m_rxPos++] : -1;
+    }
+
+    int read(uint8_t *buffer, size_t size) override
+    {
+        reads++;
+        size = min(size, m_rx.size() - m_rxPos);
+        memcpy(buffer, m_rx.data() + m_rxPos, size);
+        m_rxPos += size;
+        compact();
+        return (int)size;
+    }
+
+    int peek() override { return m_rxPos < m_rx.size() ? m_rx[m_rxPos] : -1; }
+    void flush() override {}
+    void stop() override { m_up = false; }
+    uint8_t connected() override { return m_up; }
+    operator bool() override { return m_up; }
+
+private:
+    bool m_up = false;
+    bool m_holdAcks = false;
+    std::vector<uint8_t> m_out; // Outbound bytes not forming a whole packet yet
+    std::vector<uint8_t> m_rx;
+    size_t m_rxPos = 0;
+    std::deque<std::pair<unsigned long, std::vector<uint8_t>>> m_pending; // Answers and when they arrive
+
+    int open()
+    {
+        m_up = true;
+        m_out.clear();
+        m_rx.clear();
+        m_rxPos = 0;
+        m_pending.clear();
+        return 1;
+    }
+
+    void answer(std::vector<uint8_t> bytes, unsigned long delayMs = 0)
+    {
+        m_pending.emplace_back(millis() + delayMs, std::move(bytes));
+    }
+
+    void deliver()
+    {
+        while (!m_holdAcks && !m_pending.empty() && m_pending.front().first <= millis())
+        {
+            inject(m_pending.front().second);
+            m_pending.pop_front();
+        }
+    }
+
+    // Drops bytes already read, so long runs do not grow m_rx
+    void compact()
+    {
+        if (m_rxPos > 65536 && m_rxPos * 2 > m_rx.size())
+        {
+            m_rx.erase(m_rx.begin(), m_rx.begin() + m_rxPos);
+            m_rxPos = 0;
+        }
+    }
+
+    void parse()
+    {
+        while (m_out.size() >= 2)
+        {
+            size_t length = 0, multiplier = 1, i = 1;
+            uint8_t digit;
+            do
+            {
+                if (i >= m_out.size())
+                {
+                    return;
+                }
+                digit = m_out[i++];
+                length += (digit & 0x7F) * multiplier;
+                multiplier *= 128;
+            } while (digit & 0x80);
+            if (m_out.size() < i + length)
+            {
+                return;
+            }
+            packets.emplace_back(m_out.begin(), m_out.begin() + i + length);
+            handle(packets.back(), i);
+            m_out.erase(m_out.begin(), m_out.begin() + i + length);
+        }
+    }
+
+    void handle(const std::vector<uint8_t> &p, size_t body)
+    {
+        bool v5 = protocolLevel == 5;
+        switch (p[0] & 0xF0)
+        {
+        case 0x10: // CONNECT: protocol level follows the protocol name
+            connects++;
+            protocolLevel = p[body + 6];
+            if (protocolLevel == 5 && !acceptV5)
+            {
+                answer({0x20, 2, 0, 0x01}); // 3.1.1 return code: unacceptable protocol version
+            }
+            else if (protocolLevel == 5)
+            {
+                // Receive Maximum 10, Topic Alias Maximum, Maximum QoS 1
+                answer({0x20, 11, 0, 0, 8, 0x21, 0, 10, 0x22, (uint8_t)(topicAliasMax >> 8), (uint8_t)topicAliasMax, 0x24, 1});
+            }
+            else
+            {
+                answer({0x20, 2, 0, 0});
+            }
+            break;
+        case 0x30: // PUBLISH
+            if ((p[0] & 0x06) == 0x02)
+            {
+                uint16_t id = publishId(p);
+                if (v5)
+                {
+                    answer({0x40, 3, (uint8_t)(id >> 8), (uint8_t)id, 0}, ackDelayMs);
+                }
+                else
+                {
+                    answer({0x40, 2, (uint8_t)(id >> 8), (uint8_t)id}, ackDelayMs);
+                }
+            }
+            break;
+        case 0x80: // SUBSCRIBE: granted QoS 0
+            if (v5)
+            {
+                answer({0x90, 4, p[body], p[body + 1], 0, 0});
+            }
+            else
+            {
+                answer({0x90, 3, p[body], p[body + 1], 0});
+            }
+            break;
+        case 0xC0: // PINGREQ
+            answer({0xD0, 0});
+            break;
+        case 0xE0: // DISCONNECT
+            m_up = false;
+            break;
+        }
+    }
+};
+
+#endif
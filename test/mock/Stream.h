@@ -0,0 +1,32 @@
+#ifndef __MOCK_STREAM_H__
+#define __MOCK_STREAM_H__
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { m_timeout = timeout; }
+
+    // Without a real socket there is nothing to wait for: returns what is there
+    size_t readBytes(uint8_t *buffer, size_t length)
+    {
+        size_t n = 0;
+        int c;
+        while (n < length && (c = read()) >= 0)
+        {
+            buffer[n++] = (uint8_t)c;
+        }
+        return n;
+    }
+    size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+
+protected:
+    unsigned long m_timeout = 1000;
+};
+
+#endif
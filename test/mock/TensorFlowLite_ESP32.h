@@ -0,0 +1,7 @@
+#ifndef __MOCK_TENSORFLOWLITE_ESP32_H__
+#define __MOCK_TENSORFLOWLITE_ESP32_H__
+
+// Library umbrella header. The native tests build the microfrontend sources
+// from the library directly (see test/test_audio_pipeline) and no interpreter
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef __MOCK_WSTRING_H__
+#define __MOCK_WSTRING_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+// Arduino String on top of std::string, with the members the firmware uses
+class String
+{
+public:
+    String() {}
+    String(const char *str) : m_str(str != NULL ? str : "") {}
+    String(const char *str, size_t length) : m_str(str, length) {}
+    String(const std::string &str) : m_str(str) {}
+    explicit String(char c) : m_str(1, c) {}
+    explicit String(int value) : m_str(std::to_string(value)) {}
+    explicit String(unsigned int value) : m_str(std::to_string(value)) {}
+    explicit String(long value) : m_str(std::to_string(value)) {}
+    explicit String(unsigned long value) : m_str(std::to_string(value)) {}
+    explicit String(double value, unsigned int decimals = 2)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.*f", (int)decimals, value);
+        m_str = buffer;
+    }
+
+    const char *c_str() const { return m_str.c_str(); }
+    size_t length() const { return m_str.length(); } // unsigned int == size_t on the ESP32, ArduinoJson checks for size_t
+    bool isEmpty() const { return m_str.empty(); }
+    bool reserve(unsigned int size)
+    {
+        m_str.reserve(size);
+        return true;
+    }
+
+    bool concat(const char *str)
+    {
+        m_str += str;
+        return true;
+    }
+    bool concat(const String &str)
+    {
+        m_str += str.m_str;
+        return true;
+    }
+    bool concat(char c)
+    {
+        m_str += c;
+        return true;
+    }
+
+    String &operator+=(const String &str)
+    {
+        m_str += str.m_str;
+        return *this;
+    }
+    String &operator+=(const char *str)
+    {
+        m_str += str;
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        m_str += c;
+        return *this;
+    }
+
+    bool operator==(const String &other) const { return m_str == other.m_str; }
+    bool operator==(const char *other) const { return m_str == (other != NULL ? other : ""); }
+    bool operator!=(const String &other) const { return !(*this == other); }
+    bool operator!=(const char *other) const { return !(*this == other); }
+    char operator[](unsigned int index) const { return index < m_str.length() ? m_str[index] : 0; }
+    char charAt(unsigned int index) const { return (*this)[index]; }
+
+    String substring(unsigned int from) const { return from < m_str.length() ? String(m_str.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+        {
+            std::swap(from, to);
+        }
+        return from < m_str.length() ? String(m_str.substr(from, to - from)) : String();
+    }
+    int indexOf(char c, unsigned int from = 0) const { return found(m_str.find(c, from)); }
+    int indexOf(const char *str, unsigned int from = 0) const { return found(m_str.find(str, from)); }
+    int indexOf(const String &str, unsigned int from = 0) const { return found(m_str.find(str.m_str, from)); }
+    int lastIndexOf(char c) const { return found(m_str.rfind(c)); }
+    bool startsWith(const String &prefix) const { return m_str.compare(0, prefix.m_str.length(), prefix.m_str) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return m_str.length() >= suffix.m_str.length() &&
+               m_str.compare(m_str.length() - suffix.m_str.length(), suffix.m_str.length(), suffix.m_str) == 0;
+    }
+    long toInt() const { return atol(m_str.c_str()); }
+    float toFloat() const { return (float)atof(m_str.c_str()); }
+
+    friend String operator+(const String &lhs, const String &rhs) { return String(lhs.m_str + rhs.m_str); }
+    friend String operator+(const String &lhs, const char *rhs) { return String(lhs.m_str + rhs); }
+    friend String operator+(const char *lhs, const String &rhs) { return String(lhs + rhs.m_str); }
+
+private:
+    static int found(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    std::string m_str;
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef __MOCK_WIFI_H__
+#define __MOCK_WIFI_H__
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+#endif
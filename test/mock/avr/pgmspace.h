@@ -0,0 +1,18 @@
+#ifndef __MOCK_PGMSPACE_H__
+#define __MOCK_PGMSPACE_H__
+
+// Flash and RAM share one address space on the ESP32 and on the host, so
+// PROGMEM data is read in place. ArduinoJson brings the remaining *_P calls
+// (build with -DARDUINOJSON_ENABLE_PROGMEM=1 for f_str() and F() strings).
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_byte_near(p) pgm_read_byte(p)
+
+class __FlashStringHelper;
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper *>(p))
+#define F(s) FPSTR(s)
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef __MOCK_ROM_MINIZ_H__
+#define __MOCK_ROM_MINIZ_H__
+
+// The ROM's tinfl API on top of zlib. Inflating with a 12 bit window refuses
+// streams that announce a bigger one, as tinfl does when the caller's
+// dictionary is 4 KB. zlib allocates from an arena inside the decompressor,
+// so freeing the decompressor mid-stream does not leak, like on the device.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <zlib.h>
+
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+
+typedef enum
+{
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+enum
+{
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+    TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+    TINFL_FLAG_COMPUTE_ADLER32 = 8,
+};
+
+#define MOCK_TINFL_WINDOW_BITS 12
+#define MOCK_TINFL_ARENA_SIZE (16 * 1024)
+
+typedef struct
+{
+    int m_state; // 0 before the stream, 1 inflating, 2 done, 3 failed
+    z_stream stream;
+    size_t arenaUsed;
+    alignas(16) uint8_t arena[MOCK_TINFL_ARENA_SIZE];
+} tinfl_decompressor;
+
+#define tinfl_init(r)     \
+    do                    \
+    {                     \
+        (r)->m_state = 0; \
+    } while (0)
+
+// Largest dictionary tinfl_decompress() was handed, the device has to fit it
+inline size_t g_mockTinflDictionarySize = 0;
+
+inline voidpf mock_tinfl_alloc(voidpf opaque, uInt items, uInt size)
+{
+    tinfl_decompressor *r = (tinfl_decompressor *)opaque;
+    size_t bytes = ((size_t)items * size + 15) & ~(size_t)15;
+    if (r->arenaUsed + bytes > sizeof(r->arena))
+    {
+        return Z_NULL;
+    }
+    voidpf block = r->arena + r->arenaUsed;
+    r->arenaUsed += bytes;
+    return block;
+}
+
+inline void mock_tinfl_free(voidpf, voidpf) {}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *in, size_t *inSize, mz_uint8 *outStart,
+                                     mz_uint8 *outNext, size_t *outSize, const mz_uint32 flags)
+{
+    const size_t dictionary = (size_t)(outNext - outStart) + *outSize;
+    if ((dictionary & (dictionary - 1)) != 0 || outNext < outStart || !(flags & TINFL_FLAG_PARSE_ZLIB_HEADER))
+    {
+        return TINFL_STATUS_BAD_PARAM;
+    }
+    if (dictionary > g_mockTinflDictionarySize)
+    {
+        g_mockTinflDictionarySize = dictionary;
+    }
+    if (r->m_state == 0)
+    {
+        memset(&r->stream, 0, sizeof(r->stream));
+        r->arenaUsed = 0;
+        r->stream.zalloc = mock_tinfl_alloc;
+        r->stream.zfree = mock_tinfl_free;
+        r->stream.opaque = r;
+        if (inflateInit2(&r->stream, MOCK_TINFL_WINDOW_BITS) != Z_OK)
+        {
+            r->m_state = 3;
+            return TINFL_STATUS_FAILED;
+        }
+        r->m_state = 1;
+    }
+    if (r->m_state == 2)
+    {
+        *inSize = 0;
+        *outSize = 0;
+        return TINFL_STATUS_DONE;
+    }
+    if (r->m_state == 3)
+    {
+        *inSize = 0;
+        *outSize = 0;
+        return TINFL_STATUS_FAILED;
+    }
+
+    r->stream.next_in = (Bytef *)in;
+    r->stream.avail_in = *inSize;
+    r->stream.next_out = outNext;
+    r->stream.avail_out = *outSize;
+    const int result = inflate(&r->stream, Z_NO_FLUSH);
+    *inSize -= r->stream.avail_in;
+    *outSize -= r->stream.avail_out;
+    if (result == Z_STREAM_END)
+    {
+        r->m_state = 2;
+        return TINFL_STATUS_DONE;
+    }
+    if (result == Z_DATA_ERROR)
+    {
+        r->m_state = 3;
+        return strcmp(r->stream.msg ? r->stream.msg : "", "incorrect data check") == 0 ? TINFL_STATUS_ADLER32_MISMATCH : TINFL_STATUS_FAILED;
+    }
+    if (result != Z_OK && result != Z_BUF_ERROR)
+    {
+        r->m_state = 3;
+        return TINFL_STATUS_FAILED;
+    }
+    return r->stream.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef __MOCK_ESP_ERR_H__
+#define __MOCK_ESP_ERR_H__
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef __MOCK_ESP_HEAP_CAPS_H__
+#define __MOCK_ESP_HEAP_CAPS_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+// The host stands in for a board with PSRAM
+inline void *heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+inline void heap_caps_free(void *ptr) { free(ptr); }
+
+#endif
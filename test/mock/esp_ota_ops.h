@@ -0,0 +1,123 @@
+#ifndef __MOCK_ESP_OTA_OPS_H__
+#define __MOCK_ESP_OTA_OPS_H__
+
+// Two OTA slots, one of them running. esp_ota_begin() erases the other one,
+// writes append to it and the state of the last update is kept so a test can
+// tell a finished update from an aborted one. esp_ota_end() does not validate
+// the image, the code under test has to.
+#include "esp_partition.h"
+
+typedef uint32_t esp_ota_handle_t;
+
+typedef enum
+{
+    MOCK_OTA_IDLE,
+    MOCK_OTA_WRITING,
+    MOCK_OTA_ENDED,
+    MOCK_OTA_ABORTED,
+} MockOtaState_t;
+
+struct MockOta
+{
+    esp_partition_t slots[2];
+    const esp_partition_t *running;
+    const esp_partition_t *boot;
+    MockOtaState_t state;
+    esp_ota_handle_t handle;
+};
+
+inline MockOta g_mockOta;
+
+// Both slots of the given size, booted from slot 0 holding image
+inline void mock_ota_init(const std::vector<uint8_t> &image, uint32_t slotSize)
+{
+    g_mockOta.slots[0] = {"ota_0", slotSize, image};
+    g_mockOta.slots[1] = {"ota_1", slotSize, {}};
+    g_mockOta.running = &g_mockOta.slots[0];
+    g_mockOta.boot = &g_mockOta.slots[0];
+    g_mockOta.state = MOCK_OTA_IDLE;
+    g_mockOta.handle = 0;
+    g_mockPartitionReads = 0;
+}
+
+inline const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return g_mockOta.running;
+}
+
+inline const esp_partition_t *esp_ota_get_boot_partition(void)
+{
+    return g_mockOta.boot;
+}
+
+inline const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start)
+{
+    if (start == NULL)
+    {
+        start = g_mockOta.running;
+    }
+    return start == &g_mockOta.slots[0] ? &g_mockOta.slots[1] : &g_mockOta.slots[0];
+}
+
+inline esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t imageSize, esp_ota_handle_t *handle)
+{
+    if (partition == NULL || partition == g_mockOta.running || handle == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (imageSize > partition->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    const_cast<esp_partition_t *>(partition)->data.clear();
+    g_mockOta.state = MOCK_OTA_WRITING;
+    *handle = ++g_mockOta.handle;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    esp_partition_t *update = const_cast<esp_partition_t *>(esp_ota_get_next_update_partition(NULL));
+    if (handle != g_mockOta.handle || g_mockOta.state != MOCK_OTA_WRITING)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (update->data.size() + size > update->size)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    update->data.insert(update->data.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    if (handle != g_mockOta.handle || g_mockOta.state != MOCK_OTA_WRITING)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_mockOta.state = MOCK_OTA_ENDED;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    if (handle != g_mockOta.handle || g_mockOta.state != MOCK_OTA_WRITING)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_mockOta.state = MOCK_OTA_ABORTED;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+    if (partition == NULL || (partition != g_mockOta.running && g_mockOta.state != MOCK_OTA_ENDED))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_mockOta.boot = partition;
+    return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef __MOCK_ESP_PARTITION_H__
+#define __MOCK_ESP_PARTITION_H__
+
+// A partition is a vector of bytes up to its size. Reads past what has been
+// written fail like reads past the end of the partition, and every read
+// counts in g_mockPartitionReads.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include "esp_err.h"
+
+typedef struct
+{
+    const char *label;
+    uint32_t size;
+    std::vector<uint8_t> data;
+} esp_partition_t;
+
+inline uint32_t g_mockPartitionReads = 0;
+
+inline esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size)
+{
+    g_mockPartitionReads++;
+    if (partition == NULL || offset + size > partition->size || offset + size > partition->data.size())
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, partition->data.data() + offset, size);
+    return ESP_OK;
+}
+
+#endif
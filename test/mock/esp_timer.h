@@ -0,0 +1,13 @@
+#ifndef __MOCK_ESP_TIMER_H__
+#define __MOCK_ESP_TIMER_H__
+
+#include <stdint.h>
+#include <chrono>
+
+inline int64_t esp_timer_get_time()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
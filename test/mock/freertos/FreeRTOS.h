@@ -0,0 +1,200 @@
+#ifndef __MOCK_FREERTOS_H__
+#define __MOCK_FREERTOS_H__
+
+// Single-threaded stand-in for the FreeRTOS calls the firmware makes. The
+// native tests drive every task body directly, so a semaphore only has to
+// count, a queue is a FIFO that never blocks, and delays return at once.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+
+typedef uint32_t TickType_t;
+typedef uint32_t EventBits_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define portNUM_PROCESSORS 2
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define BIT0 0x00000001
+#define BIT1 0x00000002
+#define BIT2 0x00000004
+#define BIT3 0x00000008
+#define BIT4 0x00000010
+#define BIT5 0x00000020
+#define BIT6 0x00000040
+#define BIT7 0x00000080
+
+typedef struct
+{
+    int locked;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+// Semaphores: a count, plus the holder depth for recursive mutexes
+struct MockSemaphore
+{
+    int count;
+    int depth;
+};
+typedef MockSemaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new MockSemaphore{1, 0}; }
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new MockSemaphore{1, 0}; }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new MockSemaphore{0, 0}; }
+inline void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t)
+{
+    if (sem == NULL || sem->count == 0)
+    {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    if (sem == NULL)
+    {
+        return pdFALSE;
+    }
+    sem->count++;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t)
+{
+    if (sem == NULL)
+    {
+        return pdFALSE;
+    }
+    sem->depth++;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    if (sem == NULL || sem->depth == 0)
+    {
+        return pdFALSE;
+    }
+    sem->depth--;
+    return pdTRUE;
+}
+
+// Queues copy fixed-size items like the real ones
+struct MockQueue
+{
+    size_t length;
+    size_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+typedef MockQueue *QueueHandle_t;
+typedef void *QueueSetHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    return new MockQueue{length, itemSize, {}};
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t)
+{
+    if (queue == NULL || queue->items.size() >= queue->length)
+    {
+        return pdFAIL;
+    }
+    const uint8_t *bytes = (const uint8_t *)item;
+    queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    return pdPASS;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t)
+{
+    if (queue == NULL || queue->items.empty())
+    {
+        return pdFAIL;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdPASS;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue != NULL ? (UBaseType_t)queue->items.size() : 0;
+}
+
+// Event groups
+struct MockEventGroup
+{
+    EventBits_t bits;
+};
+typedef MockEventGroup *EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() { return new MockEventGroup{0}; }
+inline void vEventGroupDelete(EventGroupHandle_t group) { delete group; }
+
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    return group != NULL ? group->bits : 0;
+}
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    if (group != NULL)
+    {
+        group->bits |= bits;
+    }
+    return xEventGroupGetBits(group);
+}
+
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    EventBits_t previous = xEventGroupGetBits(group);
+    if (group != NULL)
+    {
+        group->bits &= ~bits;
+    }
+    return previous;
+}
+
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit, BaseType_t, TickType_t)
+{
+    EventBits_t current = xEventGroupGetBits(group);
+    if (clearOnExit)
+    {
+        xEventGroupClearBits(group, bits);
+    }
+    return current;
+}
+
+// Tasks are never started; tests call the task bodies' helpers directly
+inline void vTaskDelay(TickType_t) {}
+inline void vTaskDelete(TaskHandle_t) {}
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+inline TickType_t xTaskGetTickCount() { return 0; }
+
+inline BaseType_t xTaskCreate(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *created)
+{
+    if (created != NULL)
+    {
+        *created = NULL;
+    }
+    return pdPASS;
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef __MOCK_FREERTOS_RINGBUF_H__
+#define __MOCK_FREERTOS_RINGBUF_H__
+
+// No-split ring buffer: items are stored whole, each taking its size rounded
+// up to 4 bytes plus an 8 byte header out of the buffer, as in ESP-IDF. Send
+// and receive never block, like every call with a zero timeout.
+#include "FreeRTOS.h"
+
+typedef enum
+{
+    RINGBUF_TYPE_NOSPLIT = 0,
+    RINGBUF_TYPE_ALLOWSPLIT,
+    RINGBUF_TYPE_BYTEBUF,
+} RingbufferType_t;
+
+struct MockRingbuffer
+{
+    size_t size;
+    size_t used;
+    std::deque<std::vector<uint8_t>> items;
+    std::vector<uint8_t> *acquired; // Item between SendAcquire and SendComplete
+    size_t lent;                    // Items handed out by Receive and not returned yet
+};
+typedef MockRingbuffer *RingbufHandle_t;
+
+inline size_t mock_ringbuf_footprint(size_t itemSize)
+{
+    return ((itemSize + 3) & ~(size_t)3) + 8;
+}
+
+inline RingbufHandle_t xRingbufferCreate(size_t size, RingbufferType_t)
+{
+    return new MockRingbuffer{size, 0, {}, NULL, 0};
+}
+
+inline void vRingbufferDelete(RingbufHandle_t ring)
+{
+    delete ring->acquired;
+    delete ring;
+}
+
+inline BaseType_t xRingbufferSendAcquire(RingbufHandle_t ring, void **item, size_t itemSize, TickType_t)
+{
+    if (ring->acquired != NULL || ring->used + mock_ringbuf_footprint(itemSize) > ring->size)
+    {
+        return pdFALSE;
+    }
+    ring->acquired = new std::vector<uint8_t>(itemSize);
+    ring->used += mock_ringbuf_footprint(itemSize);
+    *item = ring->acquired->data();
+    return pdTRUE;
+}
+
+inline BaseType_t xRingbufferSendComplete(RingbufHandle_t ring, void *item)
+{
+    if (ring->acquired == NULL || ring->acquired->data() != item)
+    {
+        return pdFALSE;
+    }
+    ring->items.push_back(std::move(*ring->acquired));
+    delete ring->acquired;
+    ring->acquired = NULL;
+    return pdTRUE;
+}
+
+inline BaseType_t xRingbufferSend(RingbufHandle_t ring, const void *data, size_t size, TickType_t ticks)
+{
+    void *item;
+    if (xRingbufferSendAcquire(ring, &item, size, ticks) != pdTRUE)
+    {
+        return pdFALSE;
+    }
+    memcpy(item, data, size);
+    return xRingbufferSendComplete(ring, item);
+}
+
+// Items are returned in order, the way the firmware uses them
+inline void *xRingbufferReceive(RingbufHandle_t ring, size_t *itemSize, TickType_t)
+{
+    if (ring->lent >= ring->items.size())
+    {
+        return NULL;
+    }
+    std::vector<uint8_t> &item = ring->items[ring->lent++];
+    *itemSize = item.size();
+    return item.data();
+}
+
+inline void vRingbufferReturnItem(RingbufHandle_t ring, void *item)
+{
+    if (ring->lent == 0 || ring->items.front().data() != item)
+    {
+        return;
+    }
+    ring->used -= mock_ringbuf_footprint(ring->items.front().size());
+    ring->items.pop_front();
+    ring->lent--;
+}
+
+inline size_t xRingbufferGetCurFreeSize(RingbufHandle_t ring)
+{
+    return ring->size - ring->used;
+}
+
+#endif
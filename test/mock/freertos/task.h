@@ -0,0 +1,6 @@
+#ifndef __MOCK_FREERTOS_TASK_H__
+#define __MOCK_FREERTOS_TASK_H__
+
+#include "FreeRTOS.h"
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef __MOCK_MBEDTLS_MD_H__
+#define __MOCK_MBEDTLS_MD_H__
+
+// The mbedtls 2.x message digest API for SHA-256, the only hash the firmware
+// asks for. The context is allocated by mbedtls_md_setup() and released by
+// mbedtls_md_free(), as in mbedtls, so a missing free shows up as a leak.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define MBEDTLS_VERSION_MAJOR 2
+#define MBEDTLS_MD_MAX_SIZE 64
+#define MBEDTLS_ERR_MD_BAD_INPUT_DATA -0x5100
+
+typedef enum
+{
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_MD5,
+    MBEDTLS_MD_SHA1,
+    MBEDTLS_MD_SHA224,
+    MBEDTLS_MD_SHA256,
+    MBEDTLS_MD_SHA384,
+    MBEDTLS_MD_SHA512,
+} mbedtls_md_type_t;
+
+typedef struct
+{
+    mbedtls_md_type_t type;
+    unsigned char size;
+} mbedtls_md_info_t;
+
+typedef struct
+{
+    const mbedtls_md_info_t *md_info;
+    void *md_ctx;
+    void *hmac_ctx;
+} mbedtls_md_context_t;
+
+typedef struct
+{
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t block[64];
+    size_t used;
+} mock_sha256_context;
+
+inline const mbedtls_md_info_t mock_sha256_info = {MBEDTLS_MD_SHA256, 32};
+
+inline void mock_sha256_compress(mock_sha256_context *ctx, const uint8_t *block)
+{
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+    {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) | ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t v[8];
+    memcpy(v, ctx->state, sizeof(v));
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = v[7] + (rotr(v[4], 6) ^ rotr(v[4], 11) ^ rotr(v[4], 25)) + ((v[4] & v[5]) ^ (~v[4] & v[6])) + k[i] + w[i];
+        uint32_t t2 = (rotr(v[0], 2) ^ rotr(v[0], 13) ^ rotr(v[0], 22)) + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(v + 1, v, 7 * sizeof(uint32_t));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        ctx->state[i] += v[i];
+    }
+}
+
+inline void mbedtls_md_init(mbedtls_md_context_t *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+inline void mbedtls_md_free(mbedtls_md_context_t *ctx)
+{
+    if (ctx == NULL)
+    {
+        return;
+    }
+    delete (mock_sha256_context *)ctx->md_ctx;
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+inline const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t type)
+{
+    return type == MBEDTLS_MD_SHA256 ? &mock_sha256_info : NULL;
+}
+
+inline unsigned char mbedtls_md_get_size(const mbedtls_md_info_t *info)
+{
+    return info == NULL ? 0 : info->size;
+}
+
+inline int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *info, int hmac)
+{
+    if (ctx == NULL || info == NULL || hmac != 0)
+    {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    ctx->md_info = info;
+    ctx->md_ctx = new mock_sha256_context();
+    return 0;
+}
+
+inline int mbedtls_md_starts(mbedtls_md_context_t *ctx)
+{
+    if (ctx == NULL || ctx->md_ctx == NULL)
+    {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    mock_sha256_context *sha = (mock_sha256_context *)ctx->md_ctx;
+    memcpy(sha->state, initial, sizeof(initial));
+    sha->length = 0;
+    sha->used = 0;
+    return 0;
+}
+
+inline int mbedtls_md_update(mbedtls_md_context_t *ctx, const unsigned char *input, size_t length)
+{
+    if (ctx == NULL || ctx->md_ctx == NULL)
+    {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    mock_sha256_context *sha = (mock_sha256_context *)ctx->md_ctx;
+    sha->length += length;
+    while (length > 0)
+    {
+        size_t chunk = 64 - sha->used < length ? 64 - sha->used : length;
+        memcpy(sha->block + sha->used, input, chunk);
+        sha->used += chunk;
+        input += chunk;
+        length -= chunk;
+        if (sha->used == 64)
+        {
+            mock_sha256_compress(sha, sha->block);
+            sha->used = 0;
+        }
+    }
+    return 0;
+}
+
+inline int mbedtls_md_finish(mbedtls_md_context_t *ctx, unsigned char *output)
+{
+    if (ctx == NULL || ctx->md_ctx == NULL)
+    {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+    mock_sha256_context *sha = (mock_sha256_context *)ctx->md_ctx;
+    const uint64_t bits = sha->length * 8;
+    uint8_t padding[72] = {0x80};
+    size_t padLength = (sha->used < 56 ? 56 : 120) - sha->used;
+    for (int i = 0; i < 8; i++)
+    {
+        padding[padLength + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    mbedtls_md_update(ctx, padding, padLength + 8);
+    for (int i = 0; i < 8; i++)
+    {
+        output[i * 4] = (uint8_t)(sha->state[i] >> 24);
+        output[i * 4 + 1] = (uint8_t)(sha->state[i] >> 16);
+        output[i * 4 + 2] = (uint8_t)(sha->state[i] >> 8);
+        output[i * 4 + 3] = (uint8_t)sha->state[i];
+    }
+    return 0;
+}
+
+#endif
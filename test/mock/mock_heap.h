@@ -0,0 +1,66 @@
+#ifndef __MOCK_HEAP_H__
+#define __MOCK_HEAP_H__
+
+// Counts every new/delete of the test program: g_mockHeapUsed feeds
+// ESP.getFreeHeap(), the peak and the number of allocations let a test check
+// what a code path costs. Include from exactly one file of a test, it
+// replaces the global operators.
+#include <cstdlib>
+#include <new>
+#include "Arduino.h"
+
+typedef struct
+{
+    size_t peak;        // Highest g_mockHeapUsed since mock_heap_reset()
+    uint32_t allocations;
+    uint32_t frees;
+} MockHeapStats_t;
+
+inline MockHeapStats_t g_mockHeap;
+
+// Starts a measurement from the current usage
+inline void mock_heap_reset()
+{
+    g_mockHeap.peak = g_mockHeapUsed;
+    g_mockHeap.allocations = 0;
+    g_mockHeap.frees = 0;
+}
+
+// Size header in front of every block, kept 16 byte aligned
+static constexpr size_t MOCK_HEAP_HEADER = 16;
+
+void *operator new(size_t size)
+{
+    uint8_t *block = (uint8_t *)malloc(size + MOCK_HEAP_HEADER);
+    if (block == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    *(size_t *)block = size;
+    g_mockHeapUsed += size;
+    g_mockHeap.allocations++;
+    if (g_mockHeapUsed > g_mockHeap.peak)
+    {
+        g_mockHeap.peak = g_mockHeapUsed;
+    }
+    return block + MOCK_HEAP_HEADER;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    uint8_t *block = (uint8_t *)ptr - MOCK_HEAP_HEADER;
+    g_mockHeapUsed -= *(size_t *)block;
+    g_mockHeap.frees++;
+    free(block);
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { operator delete(ptr); }
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef __MOCK_MQTT_CLIENT_H__
+#define __MOCK_MQTT_CLIENT_H__
+
+// esp-mqtt (ESP-IDF 4.4 API) without its task: the calls the client makes
+// run synchronously, and the test plays the MQTT task with the mock_mqtt_*
+// helpers below, which deliver events to the registered handler. Every
+// socket write counts in socketWrites and costs writeCostUs, so a test can
+// see which task pays for it.
+#include <deque>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "esp_err.h"
+
+#ifndef ESP_IDF_VERSION_MAJOR
+#define ESP_IDF_VERSION_MAJOR 4
+#endif
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+
+typedef enum
+{
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+    MQTT_EVENT_BEFORE_CONNECT,
+    MQTT_EVENT_DELETED,
+} esp_mqtt_event_id_t;
+
+typedef enum
+{
+    MQTT_TRANSPORT_UNKNOWN = 0,
+    MQTT_TRANSPORT_OVER_TCP,
+    MQTT_TRANSPORT_OVER_SSL,
+    MQTT_TRANSPORT_OVER_WS,
+    MQTT_TRANSPORT_OVER_WSS,
+} esp_mqtt_transport_t;
+
+typedef enum
+{
+    MQTT_PROTOCOL_UNDEFINED = 0,
+    MQTT_PROTOCOL_V_3_1,
+    MQTT_PROTOCOL_V_3_1_1,
+} esp_mqtt_protocol_ver_t;
+
+typedef struct
+{
+    const char *host;
+    uint32_t port;
+    const char *client_id;
+    const char *username;
+    const char *password;
+    int keepalive;
+    int task_prio;
+    int task_stack;
+    int buffer_size;
+    const char *cert_pem;
+    esp_mqtt_transport_t transport;
+    bool disable_auto_reconnect;
+    int reconnect_timeout_ms;
+    esp_mqtt_protocol_ver_t protocol_ver;
+    int network_timeout_ms;
+    bool disable_keepalive;
+} esp_mqtt_client_config_t;
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef struct
+{
+    esp_mqtt_event_id_t event_id;
+    esp_mqtt_client_handle_t client;
+    char *data;
+    int data_len;
+    int total_data_len;
+    int current_data_offset;
+    char *topic;
+    int topic_len;
+    int msg_id;
+} esp_mqtt_event_t;
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+
+// How the mock broker answers a connection attempt
+typedef enum
+{
+    MOCK_MQTT_ACCEPT,
+    MOCK_MQTT_REFUSE, // CONNACK with an error: MQTT_EVENT_DISCONNECTED
+    MOCK_MQTT_SILENT, // No answer before connect() stops waiting
+} MockMqttAnswer_t;
+
+typedef struct
+{
+    std::string topic;
+    std::string payload;
+    int qos;
+    int msgId;
+} MockMqttMessage_t;
+
+struct esp_mqtt_client
+{
+    esp_mqtt_client_config_t config;
+    esp_event_handler_t handler;
+    bool started;
+    bool connected;
+    bool autoReconnectPending; // The task waits for its next automatic attempt
+
+    MockMqttAnswer_t answer;
+    unsigned long writeCostUs;
+    uint32_t socketWrites;
+    uint32_t starts;
+    uint32_t stops;
+    uint32_t reconnects;
+    int nextMsgId;
+    std::deque<MockMqttMessage_t> outbox;  // Enqueued, waiting for the task
+    std::vector<MockMqttMessage_t> sent;   // On the wire, in order
+    std::vector<std::string> subscriptions;
+};
+
+// The client the code under test created last
+inline esp_mqtt_client_handle_t g_mockMqttClient = NULL;
+
+inline void mock_mqtt_event(esp_mqtt_client_handle_t client, esp_mqtt_event_t event)
+{
+    event.client = client;
+    if (client->handler != NULL)
+    {
+        client->handler(NULL, "MQTT_EVENTS", event.event_id, &event);
+    }
+}
+
+inline void mock_mqtt_socket_write(esp_mqtt_client_handle_t client)
+{
+    for (unsigned long start = micros(); micros() - start < client->writeCostUs;)
+    {
+    }
+    client->socketWrites++;
+}
+
+// The task's connection attempt, answered the way the test configured
+inline void mock_mqtt_attempt(esp_mqtt_client_handle_t client)
+{
+    esp_mqtt_event_t event = {};
+    event.event_id = MQTT_EVENT_BEFORE_CONNECT;
+    mock_mqtt_event(client, event);
+    if (client->answer == MOCK_MQTT_SILENT)
+    {
+        return;
+    }
+    mock_mqtt_socket_write(client);
+    client->connected = client->answer == MOCK_MQTT_ACCEPT;
+    client->autoReconnectPending = !client->connected && !client->config.disable_auto_reconnect;
+    event.event_id = client->connected ? MQTT_EVENT_CONNECTED : MQTT_EVENT_DISCONNECTED;
+    mock_mqtt_event(client, event);
+}
+
+// One pass of the MQTT task: everything in the outbox goes out
+inline void mock_mqtt_run(esp_mqtt_client_handle_t client)
+{
+    while (client->connected && !client->outbox.empty())
+    {
+        mock_mqtt_socket_write(client);
+        client->sent.push_back(client->outbox.front());
+        client->outbox.pop_front();
+        esp_mqtt_event_t event = {};
+        event.event_id = MQTT_EVENT_PUBLISHED;
+        event.msg_id = client->sent.back().msgId;
+        mock_mqtt_event(client, event);
+    }
+}
+
+// A PUBLISH from the broker. As in esp-mqtt the topic is not null-terminated,
+// the payload follows it in the same receive buffer; a message bigger than
+// the buffer arrives in parts, offset says which one
+inline void mock_mqtt_receive(esp_mqtt_client_handle_t client, const char *topic, const std::string &payload,
+                              size_t offset = 0, size_t length = SIZE_MAX)
+{
+    length = min(length, payload.size() - offset);
+    std::string buffer = std::string(topic) + payload.substr(offset, length) + "#";
+    esp_mqtt_event_t event = {};
+    event.event_id = MQTT_EVENT_DATA;
+    event.topic = offset == 0 ? &buffer[0] : NULL;
+    event.topic_len = offset == 0 ? strlen(topic) : 0;
+    event.data = &buffer[strlen(topic)];
+    event.data_len = length;
+    event.total_data_len = payload.size();
+    event.current_data_offset = offset;
+    mock_mqtt_event(client, event);
+}
+
+// The broker closes the connection
+inline void mock_mqtt_drop(esp_mqtt_client_handle_t client)
+{
+    client->connected = false;
+    client->autoReconnectPending = !client->config.disable_auto_reconnect;
+    esp_mqtt_event_t event = {};
+    event.event_id = MQTT_EVENT_DISCONNECTED;
+    mock_mqtt_event(client, event);
+}
+
+inline esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    esp_mqtt_client_handle_t client = new esp_mqtt_client();
+    client->config = *config;
+    client->answer = MOCK_MQTT_ACCEPT;
+    client->nextMsgId = 1;
+    g_mockMqttClient = client;
+    return client;
+}
+
+inline esp_err_t esp_mqtt_set_config(esp_mqtt_client_handle_t client, const esp_mqtt_client_config_t *config)
+{
+    client->config = *config;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t, esp_event_handler_t handler, void *)
+{
+    client->handler = handler;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL || client->started)
+    {
+        return ESP_FAIL;
+    }
+    client->started = true;
+    client->starts++;
+    mock_mqtt_attempt(client);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL || !client->started)
+    {
+        return ESP_FAIL;
+    }
+    client->started = false;
+    client->stops++;
+    if (client->connected)
+    {
+        mock_mqtt_drop(client);
+    }
+    client->autoReconnectPending = false;
+    return ESP_OK;
+}
+
+// Only cuts short the wait for an automatic reconnect, as in esp-mqtt
+inline esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL || !client->started || !client->autoReconnectPending)
+    {
+        return ESP_FAIL;
+    }
+    client->reconnects++;
+    mock_mqtt_attempt(client);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL || !client->connected)
+    {
+        return ESP_FAIL;
+    }
+    mock_mqtt_socket_write(client);
+    client->connected = false;
+    esp_mqtt_event_t event = {};
+    event.event_id = MQTT_EVENT_DISCONNECTED;
+    mock_mqtt_event(client, event);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_mqtt_client_destroy(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (g_mockMqttClient == client)
+    {
+        g_mockMqttClient = NULL;
+    }
+    delete client;
+    return ESP_OK;
+}
+
+// Sent from the caller's task, like esp-mqtt's blocking publish
+inline int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos, int)
+{
+    if (client == NULL || !client->connected)
+    {
+        return -1;
+    }
+    mock_mqtt_socket_write(client);
+    int msgId = qos > 0 ? client->nextMsgId++ : 0;
+    client->sent.push_back({topic, std::string(data, len), qos, msgId});
+    return msgId;
+}
+
+// Copied into the outbox; the task sends it on its next pass
+inline int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos, int, bool store)
+{
+    if (client == NULL || (qos == 0 && !store))
+    {
+        return -1;
+    }
+    int msgId = client->nextMsgId++;
+    client->outbox.push_back({topic, std::string(data, len), qos, msgId});
+    return msgId;
+}
+
+inline int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int)
+{
+    if (client == NULL || !client->connected)
+    {
+        return -1;
+    }
+    mock_mqtt_socket_write(client);
+    client->subscriptions.push_back(topic);
+    return client->nextMsgId++;
+}
+
+inline int esp_mqtt_client_unsubscribe(esp_mqtt_client_handle_t client, const char *topic)
+{
+    if (client == NULL || !client->connected)
+    {
+        return -1;
+    }
+    mock_mqtt_socket_write(client);
+    return client->nextMsgId++;
+}
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef __MOCK_SDKCONFIG_H__
+#define __MOCK_SDKCONFIG_H__
+
+// The firmware's target, selects the ROM headers the ESP-IDF code includes
+#define CONFIG_IDF_TARGET_ESP32S3 1
+
+#endif
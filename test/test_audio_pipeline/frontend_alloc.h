@@ -0,0 +1,21 @@
+#ifndef __FRONTEND_ALLOC_H__
+#define __FRONTEND_ALLOC_H__
+
+// The microfrontend allocates its state with malloc/calloc; its sources are
+// built with these in their place so the test can report the frontend heap
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+void *frontend_malloc(size_t size);
+void *frontend_calloc(size_t count, size_t size);
+void frontend_free(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+// C half of the TFLM microfrontend, straight from the library sources
+#include <stdlib.h>
+#include "frontend_alloc.h"
+
+#define malloc(size) frontend_malloc(size)
+#define calloc(count, size) frontend_calloc(count, size)
+#define free(ptr) frontend_free(ptr)
+
+#include "tensorflow/lite/experimental/microfrontend/lib/filterbank.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/filterbank_util.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/frontend.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/frontend_util.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/log_lut.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/log_scale.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/log_scale_util.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/noise_reduction.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/noise_reduction_util.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/pcan_gain_control.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/pcan_gain_control_util.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/window.c"
+#include "tensorflow/lite/experimental/microfrontend/lib/window_util.c"
@@ -0,0 +1,10 @@
+// C++ half of the TFLM microfrontend, straight from the library sources
+#include <stdlib.h>
+#include "frontend_alloc.h"
+
+#define malloc(size) frontend_malloc(size)
+#define calloc(count, size) frontend_calloc(count, size)
+#define free(ptr) frontend_free(ptr)
+
+#include "tensorflow/lite/experimental/microfrontend/lib/fft.cpp"
+#include "tensorflow/lite/experimental/microfrontend/lib/fft_util.cpp"
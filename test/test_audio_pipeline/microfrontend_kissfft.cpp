@@ -0,0 +1,10 @@
+// int16 kissfft of the TFLM microfrontend; kiss_fft.h has to be seen with
+// FIXED_POINT set, so it cannot share a file with fft.cpp
+#include <stdlib.h>
+#include "frontend_alloc.h"
+
+#define malloc(size) frontend_malloc(size)
+#define calloc(count, size) frontend_calloc(count, size)
+#define free(ptr) frontend_free(ptr)
+
+#include "tensorflow/lite/experimental/microfrontend/lib/kiss_fft_int16.cpp"
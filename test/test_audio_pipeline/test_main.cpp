@@ -0,0 +1,339 @@
+// Host harness for the audio feature pipeline (task_audio.cpp): runs a WAV
+// recording frame by frame through the same frontend and feature window the
+// feature task uses, and reports frames/s and the memory the pipeline holds.
+//
+// A synthetic recording is used by default: machine hum with a bearing-like
+// click train in the last seconds. AUDIO_TEST_WAV=<16 kHz 16-bit PCM .wav>
+// runs a real recording instead.
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "frontend_alloc.h"
+#include "../../src/task_audio.cpp"
+
+#define WAV_SECONDS 10
+#define WAV_FAULT_SECONDS 3 // Clicks in the last seconds of the synthetic recording
+
+// Frontend heap, counted through frontend_alloc.h. Every block carries its size.
+static size_t s_frontendHeap = 0;
+static size_t s_frontendHeapPeak = 0;
+
+extern "C" void *frontend_malloc(size_t size)
+{
+    size_t *block = (size_t *)malloc(sizeof(max_align_t) + size);
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    *block = size;
+    s_frontendHeap += size;
+    s_frontendHeapPeak = max(s_frontendHeapPeak, s_frontendHeap);
+    return (uint8_t *)block + sizeof(max_align_t);
+}
+
+extern "C" void *frontend_calloc(size_t count, size_t size)
+{
+    void *ptr = frontend_malloc(count * size);
+    if (ptr != NULL)
+    {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+extern "C" void frontend_free(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    size_t *block = (size_t *)((uint8_t *)ptr - sizeof(max_align_t));
+    s_frontendHeap -= *block;
+    free(block);
+}
+
+typedef struct
+{
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint16_t bitsPerSample;
+    std::vector<int16_t> samples; // First channel only
+} Wav_t;
+
+static uint32_t readLe(const uint8_t *data, size_t bytes)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        value |= (uint32_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+static void writeLe(std::vector<uint8_t> &out, uint32_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++)
+    {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+// RIFF/WAVE with a PCM "fmt " chunk; other chunks are skipped
+static bool parseWav(const std::vector<uint8_t> &file, Wav_t *wav)
+{
+    if (file.size() < 12 || memcmp(file.data(), "RIFF", 4) != 0 || memcmp(file.data() + 8, "WAVE", 4) != 0)
+    {
+        return false;
+    }
+    bool haveFormat = false;
+    size_t pos = 12;
+    while (pos + 8 <= file.size())
+    {
+        const uint8_t *chunk = file.data() + pos;
+        size_t size = readLe(chunk + 4, 4);
+        if (size > file.size() - pos - 8)
+        {
+            return false;
+        }
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+        {
+            haveFormat = readLe(chunk + 8, 2) == 1; // PCM
+            wav->channels = (uint16_t)readLe(chunk + 10, 2);
+            wav->sampleRate = readLe(chunk + 12, 4);
+            wav->bitsPerSample = (uint16_t)readLe(chunk + 22, 2);
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            if (!haveFormat || wav->bitsPerSample != 16 || wav->channels == 0)
+            {
+                return false;
+            }
+            size_t frameBytes = 2U * wav->channels;
+            wav->samples.clear();
+            for (size_t i = 0; i + frameBytes <= size; i += frameBytes)
+            {
+                wav->samples.push_back((int16_t)readLe(chunk + 8 + i, 2));
+            }
+            return true;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+static std::vector<uint8_t> makeWav(const std::vector<int16_t> &samples)
+{
+    std::vector<uint8_t> out;
+    out.insert(out.end(), {'R', 'I', 'F', 'F'});
+    writeLe(out, 36 + samples.size() * 2, 4);
+    out.insert(out.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    writeLe(out, 16, 4);
+    writeLe(out, 1, 2); // PCM
+    writeLe(out, 1, 2); // Mono
+    writeLe(out, AUDIO_SAMPLE_RATE, 4);
+    writeLe(out, AUDIO_SAMPLE_RATE * 2, 4);
+    writeLe(out, 2, 2);
+    writeLe(out, 16, 2);
+    out.insert(out.end(), {'d', 'a', 't', 'a'});
+    writeLe(out, samples.size() * 2, 4);
+    for (int16_t s : samples)
+    {
+        writeLe(out, (uint16_t)s, 2);
+    }
+    return out;
+}
+
+// 100 Hz hum with harmonics and noise; clicks (short 3 kHz bursts, 25 per
+// second) added over the last WAV_FAULT_SECONDS
+static std::vector<int16_t> synthesizeRecording()
+{
+    std::vector<int16_t> samples(WAV_SECONDS * AUDIO_SAMPLE_RATE);
+    uint32_t seed = 12345;
+    const size_t faultStart = (WAV_SECONDS - WAV_FAULT_SECONDS) * AUDIO_SAMPLE_RATE;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        double t = (double)i / AUDIO_SAMPLE_RATE;
+        double v = 3000 * sin(2 * M_PI * 100 * t) + 1200 * sin(2 * M_PI * 200 * t) + 600 * sin(2 * M_PI * 300 * t);
+        seed = seed * 1664525U + 1013904223U;
+        v += (double)((int32_t)(seed >> 16) % 400);
+        size_t inClick = i % (AUDIO_SAMPLE_RATE / 25);
+        if (i >= faultStart && inClick < 160)
+        {
+            v += 8000 * sin(2 * M_PI * 3000 * t) * (1.0 - inClick / 160.0);
+        }
+        samples[i] = (int16_t)constrain(v, -32768.0, 32767.0);
+    }
+    return samples;
+}
+
+static std::vector<uint8_t> loadFile(const char *path)
+{
+    std::vector<uint8_t> data;
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return data;
+    }
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(f);
+    return data;
+}
+
+static float newestSliceMean()
+{
+    const int8_t *slice = s_features[(s_featureHead + AUDIO_FEATURE_COUNT - 1) % AUDIO_FEATURE_COUNT];
+    int32_t sum = 0;
+    for (size_t i = 0; i < AUDIO_FEATURE_SIZE; i++)
+    {
+        sum += slice[i];
+    }
+    return (float)sum / AUDIO_FEATURE_SIZE;
+}
+
+static bool s_frontendReady = false;
+
+void setUp(void)
+{
+    if (s_frontendReady)
+    {
+        FrontendFreeStateContents(&s_frontend);
+    }
+    memset(s_features, 0, sizeof(s_features));
+    s_featureHead = 0;
+    s_featureFill = 0;
+    s_stats = AudioStats_t();
+    s_frontendHeapPeak = s_frontendHeap;
+    s_frontendReady = audio_frontend_begin();
+}
+
+void tearDown(void) {}
+
+void test_wav_reader_round_trip(void)
+{
+    std::vector<int16_t> samples = {0, 1, -1, 32767, -32768, 1234};
+    Wav_t wav;
+    TEST_ASSERT_TRUE(parseWav(makeWav(samples), &wav));
+    TEST_ASSERT_EQUAL_UINT32(AUDIO_SAMPLE_RATE, wav.sampleRate);
+    TEST_ASSERT_EQUAL(1, wav.channels);
+    TEST_ASSERT_TRUE(wav.samples == samples);
+
+    std::vector<uint8_t> truncated = makeWav(samples);
+    truncated.resize(truncated.size() - 3);
+    TEST_ASSERT_FALSE(parseWav(truncated, &wav));
+}
+
+// Frontend output 0..~670 maps onto int8 like micro_speech
+void test_slice_quantization(void)
+{
+    const uint16_t values[] = {0, 333, 666, 1000};
+    audio_push_slice(values, 4);
+    const int8_t *slot = s_features[0];
+    TEST_ASSERT_EQUAL_INT8(-128, slot[0]);
+    TEST_ASSERT_EQUAL_INT8(0, slot[1]);
+    TEST_ASSERT_EQUAL_INT8(127, slot[2]);
+    TEST_ASSERT_EQUAL_INT8(127, slot[3]);
+    TEST_ASSERT_EQUAL_INT8(-128, slot[4]); // Channels the frontend did not produce
+    TEST_ASSERT_EQUAL_MEMORY(s_features[0], s_features[AUDIO_FEATURE_COUNT], AUDIO_FEATURE_SIZE);
+}
+
+// The window handed to the model is one contiguous block, oldest slice first
+void test_feature_window_is_contiguous(void)
+{
+    uint16_t values[AUDIO_FEATURE_SIZE];
+    for (size_t n = 0; n < 3 * AUDIO_FEATURE_COUNT; n++)
+    {
+        for (size_t i = 0; i < AUDIO_FEATURE_SIZE; i++)
+        {
+            values[i] = (uint16_t)((n * 7 + i) % 600);
+        }
+        audio_push_slice(values, AUDIO_FEATURE_SIZE);
+        if (s_featureFill < AUDIO_FEATURE_COUNT)
+        {
+            continue;
+        }
+        const int8_t *window = &s_features[s_featureHead][0];
+        for (size_t k = 0; k < AUDIO_FEATURE_COUNT; k++)
+        {
+            size_t slice = n + 1 - AUDIO_FEATURE_COUNT + k;
+            int32_t expected = (int32_t)(((slice * 7) % 600) * 256 + 333) / 666 - 128;
+            TEST_ASSERT_EQUAL_INT8(expected, window[k * AUDIO_FEATURE_SIZE]);
+        }
+    }
+}
+
+void test_pipeline_over_wav(void)
+{
+    TEST_ASSERT_TRUE(s_frontendReady);
+
+    Wav_t wav;
+    const char *path = getenv("AUDIO_TEST_WAV");
+    bool synthetic = (path == NULL || path[0] == 0);
+    TEST_ASSERT_TRUE_MESSAGE(parseWav(synthetic ? makeWav(synthesizeRecording()) : loadFile(path), &wav),
+                             "not a 16-bit PCM WAV file");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(AUDIO_SAMPLE_RATE, wav.sampleRate, "recording must be 16 kHz");
+
+    const size_t frames = wav.samples.size() / AUDIO_FRAME_SAMPLES;
+    const size_t faultFrame = (WAV_SECONDS - WAV_FAULT_SECONDS) * AUDIO_SAMPLE_RATE / AUDIO_FRAME_SAMPLES;
+    double humLevel = 0, faultLevel = 0;
+    size_t humSlices = 0, faultSlices = 0;
+
+    int64_t start = esp_timer_get_time();
+    for (size_t f = 0; f < frames; f++)
+    {
+        uint32_t slices = s_stats.slicesGenerated;
+        audio_process_frame(&wav.samples[f * AUDIO_FRAME_SAMPLES]);
+        if (s_stats.slicesGenerated == slices)
+        {
+            continue;
+        }
+        // Levels once noise reduction has settled on the hum
+        if (f >= faultFrame + 25)
+        {
+            faultLevel += newestSliceMean();
+            faultSlices++;
+        }
+        else if (f >= 100 && f < faultFrame)
+        {
+            humLevel += newestSliceMean();
+            humSlices++;
+        }
+    }
+    double seconds = (esp_timer_get_time() - start) / 1e6;
+
+    // One window of look-back, then a slice per 20 ms frame
+    TEST_ASSERT_EQUAL_UINT32(frames - 1, s_stats.slicesGenerated);
+    TEST_ASSERT_EQUAL_UINT32(s_stats.slicesGenerated - (AUDIO_FEATURE_COUNT - 1), s_stats.windowsInvoked);
+
+    size_t staticBytes = sizeof(s_frames) + sizeof(s_discard) + sizeof(s_features) + sizeof(s_frontend);
+    char report[200];
+    snprintf(report, sizeof(report), "%u frames, %.0f frames/s (%.0fx real time), static %u B + frontend heap peak %u B",
+             (unsigned)frames, frames / seconds, frames / seconds * AUDIO_STEP_MS / 1000.0,
+             (unsigned)staticBytes, (unsigned)s_frontendHeapPeak);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_GREATER_THAN(1000 / AUDIO_STEP_MS, (int)(frames / seconds));
+
+    if (synthetic)
+    {
+        humLevel /= humSlices;
+        faultLevel /= faultSlices;
+        snprintf(report, sizeof(report), "mean feature: hum %.1f, clicks %.1f", humLevel, faultLevel);
+        TEST_MESSAGE(report);
+        TEST_ASSERT_TRUE_MESSAGE(faultLevel > humLevel + 10, "clicks not visible in the features");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_wav_reader_round_trip);
+    RUN_TEST(test_slice_quantization);
+    RUN_TEST(test_feature_window_is_contiguous);
+    RUN_TEST(test_pipeline_over_wav);
+    return UNITY_END();
+}
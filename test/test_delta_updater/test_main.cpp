@@ -0,0 +1,268 @@
+// Host test for Espressif_Delta_Updater: a patch built here in the format of
+// tools/delta_patch.py reconstructs the new image in the update partition
+// whatever size the chunks arrive in, a package without the patch magic is
+// written as a complete image, and a patch for another image, a corrupted,
+// truncated or overlong patch never becomes the boot partition.
+#include <unity.h>
+#include <random>
+#include "esp_ota_ops.h"
+#include "../../lib/ThingsBoard/HashGenerator.cpp"
+#include "../../lib/ThingsBoard/Espressif_Updater.cpp"
+#include "../../lib/ThingsBoard/Espressif_Delta_Updater.cpp"
+
+#define OLD_IMAGE_SIZE (64 * 1024)
+#define SLOT_SIZE (128 * 1024)
+#define PATCH_HEADER_SIZE 76
+
+// One patch record: diff bytes on top of the source from sourceOffset on,
+// then bytes the source does not have
+typedef struct
+{
+    uint32_t sourceOffset;
+    uint32_t diffLength;
+    uint32_t extraLength;
+} Piece_t;
+
+// Code that moved, changed here and there, new code in between and a longer tail
+static const Piece_t PIECES[] = {
+    {0, 20000, 3000},
+    {30000, 20000, 0},
+    {10000, 5000, 100},
+    {50000, OLD_IMAGE_SIZE - 50000, 4000},
+};
+
+static std::vector<uint8_t> s_old;
+static std::vector<uint8_t> s_new;
+static std::vector<uint8_t> s_patch;
+
+static void putLe32(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+static void sha256(const std::vector<uint8_t> &data, uint8_t *hash)
+{
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+    mbedtls_md_starts(&ctx);
+    mbedtls_md_update(&ctx, data.data(), data.size());
+    mbedtls_md_finish(&ctx, hash);
+    mbedtls_md_free(&ctx);
+}
+
+// New image and its patch against s_old, compressed with the 4 KB window
+// the updater inflates with, as tools/delta_patch.py does
+static void buildPatch(void)
+{
+    std::mt19937 rng(42);
+    std::vector<uint8_t> records;
+    s_new.clear();
+    for (size_t p = 0; p < sizeof(PIECES) / sizeof(PIECES[0]); p++)
+    {
+        const Piece_t &piece = PIECES[p];
+        const bool last = p + 1 == sizeof(PIECES) / sizeof(PIECES[0]);
+        const int32_t seek = last ? 0 : (int32_t)PIECES[p + 1].sourceOffset - (int32_t)(piece.sourceOffset + piece.diffLength);
+        putLe32(records, piece.diffLength);
+        putLe32(records, piece.extraLength);
+        putLe32(records, (uint32_t)seek);
+        for (uint32_t i = 0; i < piece.diffLength; i++)
+        {
+            // A relocated address every few hundred bytes
+            const uint8_t diff = i % 397 == 0 ? (uint8_t)(p + 1) : 0;
+            records.push_back(diff);
+            s_new.push_back(s_old[piece.sourceOffset + i] + diff);
+        }
+        for (uint32_t i = 0; i < piece.extraLength; i++)
+        {
+            records.push_back((uint8_t)rng());
+            s_new.push_back(records.back());
+        }
+    }
+
+    s_patch.assign({'T', 'B', 'D', '1'});
+    putLe32(s_patch, s_old.size());
+    putLe32(s_patch, s_new.size());
+    s_patch.resize(PATCH_HEADER_SIZE);
+    sha256(s_old, &s_patch[12]);
+    sha256(s_new, &s_patch[44]);
+
+    z_stream stream = {};
+    deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 12, 8, Z_DEFAULT_STRATEGY);
+    std::vector<uint8_t> body(deflateBound(&stream, records.size()));
+    stream.next_in = records.data();
+    stream.avail_in = records.size();
+    stream.next_out = body.data();
+    stream.avail_out = body.size();
+    deflate(&stream, Z_FINISH);
+    body.resize(stream.total_out);
+    deflateEnd(&stream);
+    s_patch.insert(s_patch.end(), body.begin(), body.end());
+}
+
+// Feeds the package the way the OTA_Handler does, false once a chunk is refused
+static bool feed(Espressif_Delta_Updater &updater, std::vector<uint8_t> &package, size_t chunk)
+{
+    if (!updater.begin(package.size()))
+    {
+        return false;
+    }
+    for (size_t offset = 0; offset < package.size(); offset += chunk)
+    {
+        const size_t length = std::min(chunk, package.size() - offset);
+        if (updater.write(&package[offset], length) != length)
+        {
+            updater.reset();
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool bootsIntoUpdate(void)
+{
+    return g_mockOta.boot == &g_mockOta.slots[1] && g_mockOta.state == MOCK_OTA_ENDED;
+}
+
+void setUp(void)
+{
+    if (s_old.empty())
+    {
+        std::mt19937 rng(7);
+        s_old.resize(OLD_IMAGE_SIZE);
+        for (uint8_t &b : s_old)
+        {
+            b = (uint8_t)rng();
+        }
+        buildPatch();
+    }
+    mock_ota_init(s_old, SLOT_SIZE);
+}
+
+void tearDown(void) {}
+
+void test_reconstructs_the_image_whatever_the_chunk_size(void)
+{
+    Espressif_Delta_Updater updater;
+    const size_t chunks[] = {1, 7, 77, PATCH_HEADER_SIZE, 1024, 4096, 65536};
+    for (size_t chunk : chunks)
+    {
+        mock_ota_init(s_old, SLOT_SIZE);
+        TEST_ASSERT_TRUE(feed(updater, s_patch, chunk));
+        TEST_ASSERT_TRUE(updater.end());
+        TEST_ASSERT_TRUE(bootsIntoUpdate());
+        TEST_ASSERT_TRUE(g_mockOta.slots[1].data == s_new);
+    }
+
+    char report[160];
+    snprintf(report, sizeof(report), "%u B image from a %u B patch (%.1f %%), %u partition reads, %u B dictionary",
+             (unsigned)s_new.size(), (unsigned)s_patch.size(), 100.0 * s_patch.size() / s_new.size(),
+             (unsigned)g_mockPartitionReads, (unsigned)g_mockTinflDictionarySize);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_TRUE(s_patch.size() < s_new.size() / 4);
+    TEST_ASSERT_EQUAL_UINT32(DELTA_DICTIONARY_SIZE, g_mockTinflDictionarySize);
+}
+
+void test_full_image_is_written_unchanged(void)
+{
+    Espressif_Delta_Updater updater;
+    std::vector<uint8_t> image = s_new;
+    image[0] = 0xE9; // ESP image magic
+    const size_t chunks[] = {1, 50, 1024};
+    for (size_t chunk : chunks)
+    {
+        mock_ota_init(s_old, SLOT_SIZE);
+        TEST_ASSERT_TRUE(feed(updater, image, chunk));
+        TEST_ASSERT_TRUE(updater.end());
+        TEST_ASSERT_TRUE(bootsIntoUpdate());
+        TEST_ASSERT_TRUE(g_mockOta.slots[1].data == image);
+    }
+
+    // Reset in the middle aborts the full image update
+    mock_ota_init(s_old, SLOT_SIZE);
+    TEST_ASSERT_TRUE(updater.begin(image.size()));
+    TEST_ASSERT_EQUAL(1000, (int)updater.write(image.data(), 1000));
+    updater.reset();
+    TEST_ASSERT_EQUAL(MOCK_OTA_ABORTED, g_mockOta.state);
+    TEST_ASSERT_TRUE(g_mockOta.boot == g_mockOta.running);
+}
+
+void test_patch_for_another_image_is_refused(void)
+{
+    std::vector<uint8_t> other = s_old;
+    other[OLD_IMAGE_SIZE / 2] ^= 1;
+    mock_ota_init(other, SLOT_SIZE);
+
+    Espressif_Delta_Updater updater;
+    TEST_ASSERT_TRUE(updater.begin(s_patch.size()));
+    // Refused with the header, before the update partition is touched
+    TEST_ASSERT_EQUAL(0, (int)updater.write(s_patch.data(), PATCH_HEADER_SIZE + 10));
+    TEST_ASSERT_EQUAL(MOCK_OTA_IDLE, g_mockOta.state);
+    TEST_ASSERT_EQUAL(0, (int)updater.write(s_patch.data() + PATCH_HEADER_SIZE + 10, 10));
+    TEST_ASSERT_FALSE(updater.end());
+    TEST_ASSERT_TRUE(g_mockOta.boot == g_mockOta.running);
+}
+
+void test_corrupted_patch_is_refused(void)
+{
+    Espressif_Delta_Updater updater;
+    std::mt19937 rng(3);
+    for (int i = 0; i < 50; i++)
+    {
+        std::vector<uint8_t> corrupted = s_patch;
+        // Target hash or compressed body
+        const size_t at = i == 0 ? 44 : PATCH_HEADER_SIZE + rng() % (s_patch.size() - PATCH_HEADER_SIZE);
+        corrupted[at] ^= 0x5A;
+        mock_ota_init(s_old, SLOT_SIZE);
+        if (feed(updater, corrupted, 1024))
+        {
+            TEST_ASSERT_FALSE(updater.end());
+        }
+        TEST_ASSERT_TRUE(g_mockOta.boot == g_mockOta.running);
+        TEST_ASSERT_TRUE(g_mockOta.state == MOCK_OTA_ABORTED);
+    }
+}
+
+void test_truncated_patch_is_refused(void)
+{
+    Espressif_Delta_Updater updater;
+    std::vector<uint8_t> truncated(s_patch.begin(), s_patch.end() - 1);
+    TEST_ASSERT_TRUE(feed(updater, truncated, 1024));
+    TEST_ASSERT_FALSE(updater.end());
+    TEST_ASSERT_EQUAL(MOCK_OTA_ABORTED, g_mockOta.state);
+    TEST_ASSERT_TRUE(g_mockOta.boot == g_mockOta.running);
+}
+
+void test_bytes_after_the_patch_are_refused(void)
+{
+    Espressif_Delta_Updater updater;
+    std::vector<uint8_t> longer = s_patch;
+    longer.push_back(0);
+    TEST_ASSERT_FALSE(feed(updater, longer, 1024));
+    TEST_ASSERT_EQUAL(MOCK_OTA_ABORTED, g_mockOta.state);
+    TEST_ASSERT_TRUE(g_mockOta.boot == g_mockOta.running);
+}
+
+void test_begin_refused_while_an_update_waits_for_a_reboot(void)
+{
+    Espressif_Delta_Updater updater;
+    TEST_ASSERT_TRUE(feed(updater, s_patch, 4096));
+    TEST_ASSERT_TRUE(updater.end());
+    TEST_ASSERT_FALSE(updater.begin(s_patch.size()));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reconstructs_the_image_whatever_the_chunk_size);
+    RUN_TEST(test_full_image_is_written_unchanged);
+    RUN_TEST(test_patch_for_another_image_is_refused);
+    RUN_TEST(test_corrupted_patch_is_refused);
+    RUN_TEST(test_truncated_patch_is_refused);
+    RUN_TEST(test_bytes_after_the_patch_are_refused);
+    RUN_TEST(test_begin_refused_while_an_update_waits_for_a_reboot);
+    return UNITY_END();
+}
@@ -0,0 +1,267 @@
+// Host test for GET /api/history (task_webserver.cpp over sensor_history.cpp):
+// fills 24 h of 1 Hz samples, pulls the chunked response the way the server
+// sends it, checks the bucket aggregates and reports the peak heap the
+// response holds while it streams.
+#include <unity.h>
+#include "mock_heap.h"
+#include "../../src/sensor_history.cpp"
+#include "../../src/task_webserver.cpp"
+
+#define DAY_SECONDS 86400
+#define T0 1760000000UL // 2025-10-09 08:53:20 UTC, the first sample
+#define CHUNK_SIZE 1436 // One TCP segment
+#define RESPONSE_HEAP_LIMIT 2048
+
+// The test owns the clock: this time() replaces the C library's for the program
+#ifndef __THROW
+#define __THROW
+#endif
+static time_t s_now = 0;
+extern "C" time_t time(time_t *t) __THROW
+{
+    if (t != NULL)
+    {
+        *t = s_now;
+    }
+    return s_now;
+}
+
+// Collaborators task_webserver.cpp links against on the device
+EventGroupHandle_t g_netEvents = NULL;
+WifiConfig_t *g_wifiConfig = NULL;
+QueueHandle_t xQueueRelayControl = NULL;
+QueueHandle_t xQueueSettings = NULL;
+void getSensorData(float *temp, float *humi) { *temp = *humi = NAN; }
+void bootMilestone(EventBits_t, const char *) {}
+EventBits_t waitBootEvents(EventBits_t bits) { return bits; }
+void getPowerStats(PowerStats_t *stats) { memset(stats, 0, sizeof(PowerStats_t)); }
+void power_waitNextPeriod(TickType_t *) {}
+void getTsStoreStats(TsStoreStats_t *stats) { memset(stats, 0, sizeof(TsStoreStats_t)); }
+
+// Sample i of the day, in the store's x100 fixed point
+static int16_t sampleTemp(uint32_t i) { return (int16_t)(2000 + 500 * sin(2 * M_PI * i / DAY_SECONDS) + i % 60); }
+static uint16_t sampleHumi(uint32_t i) { return (uint16_t)(5000 + i % 600); }
+
+typedef struct
+{
+    int code;
+    String contentType;
+    std::string body;
+    size_t chunks;
+    size_t heapPeak; // Above the heap in use before the request
+    double ms;
+} HistoryResponse_t;
+
+static HistoryResponse_t get(const char *query[][2], size_t params)
+{
+    HistoryResponse_t r = {};
+    r.body.reserve(8 * 1024 * 1024); // Collecting the body is not part of the response's heap
+    mock_heap_reset();
+    size_t heapStart = g_mockHeapUsed;
+    int64_t start = esp_timer_get_time();
+    {
+        AsyncWebServerRequest request("/api/history");
+        for (size_t i = 0; i < params; i++)
+        {
+            request.addParam(query[i][0], query[i][1]);
+        }
+        server.handle(&request);
+        AsyncWebServerResponse *response = request.response();
+        if (response == NULL)
+        {
+            return r;
+        }
+        r.code = response->code();
+        r.contentType = response->contentType();
+        uint8_t chunk[CHUNK_SIZE];
+        size_t n;
+        while ((n = response->fill(chunk, sizeof(chunk))) > 0)
+        {
+            r.body.append((const char *)chunk, n);
+            r.chunks++;
+        }
+    }
+    r.ms = (esp_timer_get_time() - start) / 1000.0;
+    r.heapPeak = g_mockHeap.peak - heapStart;
+    return r;
+}
+
+static std::vector<std::string> lines(const std::string &body)
+{
+    std::vector<std::string> out;
+    size_t pos = 0;
+    while (pos < body.size())
+    {
+        size_t end = body.find('\n', pos);
+        if (end == std::string::npos)
+        {
+            end = body.size();
+        }
+        out.push_back(body.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    return out;
+}
+
+void setUp(void)
+{
+    static bool s_filled = false;
+    registerHandlers();
+    if (!s_filled)
+    {
+        s_filled = true;
+        history_init();
+        for (uint32_t i = 0; i < DAY_SECONDS; i++)
+        {
+            s_now = T0 + i;
+            history_append(sampleTemp(i) / 100.0f, sampleHumi(i) / 100.0f);
+        }
+    }
+    s_now = T0 + DAY_SECONDS - 1;
+}
+
+void tearDown(void) {}
+
+void test_store_holds_the_whole_day(void)
+{
+    uint32_t oldest, count;
+    history_range(&oldest, &count);
+    TEST_ASSERT_EQUAL_UINT32(T0, oldest);
+    TEST_ASSERT_EQUAL_UINT32(DAY_SECONDS, count);
+}
+
+void test_day_at_1hz_as_csv(void)
+{
+    char from[16], to[16];
+    snprintf(from, sizeof(from), "%lu", T0);
+    snprintf(to, sizeof(to), "%lu", T0 + DAY_SECONDS);
+    const char *query[][2] = {{"from", from}, {"to", to}, {"step", "1"}, {"format", "csv"}};
+    HistoryResponse_t r = get(query, 4);
+
+    TEST_ASSERT_EQUAL(200, r.code);
+    TEST_ASSERT_EQUAL_STRING("text/csv", r.contentType.c_str());
+    std::vector<std::string> rows = lines(r.body);
+    TEST_ASSERT_EQUAL(DAY_SECONDS + 1, (int)rows.size());
+    TEST_ASSERT_EQUAL_STRING("time,count,temp_min,temp_max,temp_avg,humi_min,humi_max,humi_avg", rows[0].c_str());
+
+    for (uint32_t i = 0; i < DAY_SECONDS; i += 997)
+    {
+        char expected[160];
+        float temp = sampleTemp(i) / 100.0f;
+        float humi = sampleHumi(i) / 100.0f;
+        snprintf(expected, sizeof(expected), "%lu,1,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f", T0 + i, temp, temp, temp, humi, humi, humi);
+        TEST_ASSERT_EQUAL_STRING(expected, rows[i + 1].c_str());
+    }
+
+    char report[200];
+    snprintf(report, sizeof(report), "24 h at 1 Hz: %u rows, %u bytes in %u chunks, %.0f ms, peak heap %u B during the response",
+             (unsigned)(rows.size() - 1), (unsigned)r.body.size(), (unsigned)r.chunks, r.ms, (unsigned)r.heapPeak);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_TRUE(r.heapPeak < RESPONSE_HEAP_LIMIT);
+}
+
+void test_day_in_minute_buckets_as_json(void)
+{
+    char from[16], to[16];
+    snprintf(from, sizeof(from), "%lu", T0);
+    snprintf(to, sizeof(to), "%lu", T0 + DAY_SECONDS);
+    const char *query[][2] = {{"from", from}, {"to", to}, {"step", "60"}};
+    HistoryResponse_t r = get(query, 3);
+    TEST_ASSERT_EQUAL(200, r.code);
+    TEST_ASSERT_TRUE(r.heapPeak < RESPONSE_HEAP_LIMIT);
+
+    DynamicJsonDocument doc(1024 * 1024);
+    TEST_ASSERT_TRUE(deserializeJson(doc, r.body.c_str()) == DeserializationError::Ok);
+    TEST_ASSERT_EQUAL_UINT32(T0, doc["from"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_UINT32(60, doc["step"].as<uint32_t>());
+    JsonArray data = doc["data"];
+    TEST_ASSERT_EQUAL(DAY_SECONDS / 60, (int)data.size());
+
+    for (size_t b = 0; b < data.size(); b += 37)
+    {
+        int32_t tMin = INT16_MAX, tMax = INT16_MIN, hMin = UINT16_MAX, hMax = 0;
+        double tSum = 0, hSum = 0;
+        for (uint32_t i = b * 60; i < b * 60 + 60; i++)
+        {
+            tMin = min(tMin, (int32_t)sampleTemp(i));
+            tMax = max(tMax, (int32_t)sampleTemp(i));
+            tSum += sampleTemp(i);
+            hMin = min(hMin, (int32_t)sampleHumi(i));
+            hMax = max(hMax, (int32_t)sampleHumi(i));
+            hSum += sampleHumi(i);
+        }
+        JsonArray row = data[b];
+        TEST_ASSERT_EQUAL_UINT32(T0 + b * 60, row[0].as<uint32_t>());
+        TEST_ASSERT_EQUAL_UINT32(60, row[1].as<uint32_t>());
+        TEST_ASSERT_FLOAT_WITHIN(0.006, tMin / 100.0, row[2].as<float>());
+        TEST_ASSERT_FLOAT_WITHIN(0.006, tMax / 100.0, row[3].as<float>());
+        TEST_ASSERT_FLOAT_WITHIN(0.006, tSum / 6000.0, row[4].as<float>());
+        TEST_ASSERT_FLOAT_WITHIN(0.006, hMin / 100.0, row[5].as<float>());
+        TEST_ASSERT_FLOAT_WITHIN(0.006, hMax / 100.0, row[6].as<float>());
+        TEST_ASSERT_FLOAT_WITHIN(0.006, hSum / 6000.0, row[7].as<float>());
+    }
+}
+
+void test_default_range_is_the_last_hour(void)
+{
+    HistoryResponse_t r = get(NULL, 0);
+    TEST_ASSERT_EQUAL(200, r.code);
+
+    DynamicJsonDocument doc(64 * 1024);
+    TEST_ASSERT_TRUE(deserializeJson(doc, r.body.c_str()) == DeserializationError::Ok);
+    TEST_ASSERT_EQUAL_UINT32(s_now + 1, doc["to"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_UINT32(s_now + 1 - 3600, doc["from"].as<uint32_t>());
+    TEST_ASSERT_EQUAL(60, (int)doc["data"].size());
+}
+
+void test_range_before_the_oldest_sample_starts_at_its_bucket(void)
+{
+    char from[16], to[16];
+    snprintf(from, sizeof(from), "%lu", T0 - 3600 - 30);
+    snprintf(to, sizeof(to), "%lu", T0 + 600);
+    const char *query[][2] = {{"from", from}, {"to", to}, {"step", "60"}, {"format", "csv"}};
+    HistoryResponse_t r = get(query, 4);
+
+    std::vector<std::string> rows = lines(r.body);
+    TEST_ASSERT_EQUAL(1 + 11, (int)rows.size()); // Half a bucket before T0, then ten full ones
+    TEST_ASSERT_EQUAL_UINT32(T0 - 30, (uint32_t)strtoul(rows[1].c_str(), NULL, 10));
+    TEST_ASSERT_EQUAL_UINT32(30, (uint32_t)strtoul(strchr(rows[1].c_str(), ',') + 1, NULL, 10));
+}
+
+void test_invalid_ranges_are_rejected(void)
+{
+    const char *zeroStep[][2] = {{"step", "0"}};
+    TEST_ASSERT_EQUAL(400, get(zeroStep, 1).code);
+
+    const char *reversed[][2] = {{"from", "1760000100"}, {"to", "1760000000"}};
+    TEST_ASSERT_EQUAL(400, get(reversed, 2).code);
+
+    const char *tooMany[][2] = {{"from", "1700000000"}, {"to", "1760000000"}, {"step", "1"}};
+    TEST_ASSERT_EQUAL(400, get(tooMany, 3).code);
+}
+
+void test_unset_clock_answers_503(void)
+{
+    s_now = 42; // Uptime seconds, SNTP not done yet
+    HistoryResponse_t r = get(NULL, 0);
+    TEST_ASSERT_EQUAL(503, r.code);
+
+    // Nothing is recorded either
+    uint32_t oldest, count;
+    history_append(25.0f, 50.0f);
+    history_range(&oldest, &count);
+    TEST_ASSERT_EQUAL_UINT32(DAY_SECONDS, count);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_store_holds_the_whole_day);
+    RUN_TEST(test_day_at_1hz_as_csv);
+    RUN_TEST(test_day_in_minute_buckets_as_json);
+    RUN_TEST(test_default_range_is_the_last_hour);
+    RUN_TEST(test_range_before_the_oldest_sample_starts_at_its_bucket);
+    RUN_TEST(test_invalid_ranges_are_rejected);
+    RUN_TEST(test_unset_clock_answers_503);
+    return UNITY_END();
+}
@@ -0,0 +1,268 @@
+// Host test for the two ThingsBoard MQTT backends coreiot can run on. esp-mqtt
+// itself cannot run on the host, so mqtt_client.h is a mock whose task the
+// test drives; what is measured is the work left on the publishing task:
+// Arduino_MQTT_Client writes to the socket there, Espressif_MQTT_Client with
+// enqueued messages only copies into the outbox. Also covers the parts of
+// Espressif_MQTT_Client coreiot relies on: connect() waiting for the broker,
+// the stop/start reconnect and the receive queue drained by loop().
+
+// Builds the Arduino backend and PubSubClient as for the ESP32
+#define ARDUINO 10819
+#define ESP32
+#include <unity.h>
+#include "esp_timer.h"
+#include "MockMqttBroker.h"
+#include "../../lib/PubSubClient/PubSubClient.cpp"
+#include "../../lib/ThingsBoard/Arduino_MQTT_Client.cpp"
+#include "../../lib/ThingsBoard/Espressif_MQTT_Client.cpp"
+
+#define BENCH_TOPIC "v1/devices/me/telemetry"
+#define BENCH_PAYLOAD "{\"temperature\":28.50,\"humidity\":61.20}"
+#define BENCH_PUBLISHES 200
+#define WRITE_COST_US 100 // A socket write that has to wait for lwIP
+
+typedef struct
+{
+    std::string topic;
+    std::string payload;
+} Received_t;
+
+static std::vector<Received_t> s_received;
+
+static void onMessage(char *topic, uint8_t *payload, unsigned int length)
+{
+    s_received.push_back({topic, std::string((const char *)payload, length)});
+}
+
+typedef struct
+{
+    double us;     // Calling task time per publish
+    double writes; // Socket writes on the calling task per publish
+} PublishCost_t;
+
+static PublishCost_t publishAll(IMQTT_Client &client, const uint32_t &writes)
+{
+    uint32_t writesBefore = writes;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_PUBLISHES; i++)
+    {
+        if (!client.publish(BENCH_TOPIC, (const uint8_t *)BENCH_PAYLOAD, strlen(BENCH_PAYLOAD)))
+        {
+            return {0, -1};
+        }
+    }
+    return {(double)(esp_timer_get_time() - start) / BENCH_PUBLISHES, (double)(writes - writesBefore) / BENCH_PUBLISHES};
+}
+
+void setUp(void)
+{
+    s_received.clear();
+}
+
+void tearDown(void) {}
+
+void test_publish_cost_on_the_calling_task(void)
+{
+    MockMqttBroker broker;
+    broker.writeCostUs = WRITE_COST_US;
+    Arduino_MQTT_Client arduino(broker);
+    TEST_ASSERT_TRUE(arduino.connect("bench", "token", NULL));
+    PublishCost_t arduinoCost = publishAll(arduino, broker.writes);
+    TEST_ASSERT_EQUAL(BENCH_PUBLISHES, (int)broker.publishes());
+
+    // One Espressif_MQTT_Client at a time, events go to the last one created
+    PublishCost_t blockingCost;
+    {
+        Espressif_MQTT_Client blocking;
+        TEST_ASSERT_TRUE(blocking.connect("bench", "token", NULL));
+        g_mockMqttClient->writeCostUs = WRITE_COST_US;
+        blockingCost = publishAll(blocking, g_mockMqttClient->socketWrites);
+        TEST_ASSERT_EQUAL(BENCH_PUBLISHES, (int)g_mockMqttClient->sent.size());
+    }
+
+    Espressif_MQTT_Client enqueued;
+    enqueued.set_enqueue_messages(true);
+    TEST_ASSERT_TRUE(enqueued.connect("bench", "token", NULL));
+    esp_mqtt_client_handle_t task = g_mockMqttClient;
+    task->writeCostUs = WRITE_COST_US;
+    PublishCost_t enqueuedCost = publishAll(enqueued, task->socketWrites);
+
+    char report[200];
+    snprintf(report, sizeof(report), "calling task per publish: arduino %.1f us / %.1f writes, esp-mqtt publish %.1f us / %.1f, esp-mqtt enqueue %.1f us / %.1f",
+             arduinoCost.us, arduinoCost.writes, blockingCost.us, blockingCost.writes, enqueuedCost.us, enqueuedCost.writes);
+    TEST_MESSAGE(report);
+
+    // PubSubClient writes the header and the payload segment itself
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, (float)arduinoCost.writes);
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, (float)blockingCost.writes);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, (float)enqueuedCost.writes);
+    TEST_ASSERT_TRUE(enqueuedCost.us * 4 < arduinoCost.us);
+
+    // The MQTT task sends the outbox later, in order
+    TEST_ASSERT_EQUAL(BENCH_PUBLISHES, (int)task->outbox.size());
+    mock_mqtt_run(task);
+    TEST_ASSERT_EQUAL(BENCH_PUBLISHES, (int)task->socketWrites - 1);
+    TEST_ASSERT_EQUAL(BENCH_PUBLISHES, (int)task->sent.size());
+    for (int i = 1; i < BENCH_PUBLISHES; i++)
+    {
+        TEST_ASSERT_TRUE(task->sent[i - 1].msgId < task->sent[i].msgId);
+    }
+    TEST_ASSERT_EQUAL_STRING(BENCH_PAYLOAD, task->sent.back().payload.c_str());
+}
+
+void test_connect_waits_for_the_broker(void)
+{
+    Espressif_MQTT_Client client;
+    client.set_disable_auto_reconnect(true);
+    TEST_ASSERT_TRUE(client.connect("bench", "token", NULL));
+    TEST_ASSERT_TRUE(client.connected());
+    esp_mqtt_client_handle_t task = g_mockMqttClient;
+
+    // No answer: false, not the true start() alone would give
+    mock_mqtt_drop(task);
+    task->answer = MOCK_MQTT_SILENT;
+    TEST_ASSERT_FALSE(client.connect("bench", "token", NULL));
+    TEST_ASSERT_FALSE(client.connected());
+
+    // Refused: the disconnected event ends the wait
+    task->answer = MOCK_MQTT_REFUSE;
+    TEST_ASSERT_FALSE(client.connect("bench", "token", NULL));
+
+    task->answer = MOCK_MQTT_ACCEPT;
+    TEST_ASSERT_TRUE(client.connect("bench", "token", NULL));
+    TEST_ASSERT_TRUE(client.connected());
+    TEST_ASSERT_TRUE(client.subscribe("v1/devices/me/rpc/request/+"));
+}
+
+void test_reconnect_restarts_the_task_without_auto_reconnect(void)
+{
+    Espressif_MQTT_Client client;
+    client.set_disable_auto_reconnect(true);
+    client.connect("bench", "token", NULL);
+    esp_mqtt_client_handle_t task = g_mockMqttClient;
+
+    mock_mqtt_drop(task);
+    TEST_ASSERT_TRUE(client.connect("bench", "token", NULL));
+    TEST_ASSERT_EQUAL_UINT32(0, task->reconnects);
+    TEST_ASSERT_EQUAL_UINT32(1, task->stops);
+    TEST_ASSERT_EQUAL_UINT32(2, task->starts);
+
+    // After disconnect() too
+    client.disconnect();
+    TEST_ASSERT_TRUE(client.connect("bench", "token", NULL));
+    TEST_ASSERT_EQUAL_UINT32(3, task->starts);
+}
+
+void test_reconnect_uses_the_pending_automatic_attempt(void)
+{
+    Espressif_MQTT_Client client;
+    client.connect("bench", "token", NULL);
+    esp_mqtt_client_handle_t task = g_mockMqttClient;
+
+    mock_mqtt_drop(task);
+    TEST_ASSERT_TRUE(client.connect("bench", "token", NULL));
+    TEST_ASSERT_EQUAL_UINT32(1, task->reconnects);
+    TEST_ASSERT_EQUAL_UINT32(1, task->starts);
+}
+
+void test_received_messages_wait_for_loop(void)
+{
+    Espressif_MQTT_Client client;
+    client.set_callback(onMessage);
+    TEST_ASSERT_TRUE(client.set_receive_queue_size(6 * 1024));
+    client.connect("bench", "token", NULL);
+    TEST_ASSERT_FALSE(client.set_receive_queue_size(1024));
+
+    mock_mqtt_receive(g_mockMqttClient, "v1/devices/me/rpc/request/1", "{\"method\":\"getValueLED_GPIO\"}");
+    mock_mqtt_receive(g_mockMqttClient, "v1/devices/me/attributes", "{\"fw_version\":\"1.1.0\"}");
+    mock_mqtt_receive(g_mockMqttClient, "v2/fw/response/0/chunk/0", std::string(1000, '\x5a'));
+    TEST_ASSERT_EQUAL(0, (int)s_received.size());
+
+    TEST_ASSERT_TRUE(client.loop());
+    TEST_ASSERT_EQUAL(3, (int)s_received.size());
+    TEST_ASSERT_EQUAL_STRING("v1/devices/me/rpc/request/1", s_received[0].topic.c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"method\":\"getValueLED_GPIO\"}", s_received[0].payload.c_str());
+    TEST_ASSERT_EQUAL_STRING("v1/devices/me/attributes", s_received[1].topic.c_str());
+    TEST_ASSERT_EQUAL_STRING("v2/fw/response/0/chunk/0", s_received[2].topic.c_str());
+    TEST_ASSERT_TRUE(s_received[2].payload == std::string(1000, '\x5a'));
+
+    // Handed over once
+    client.loop();
+    TEST_ASSERT_EQUAL(3, (int)s_received.size());
+}
+
+void test_fragments_and_overflow_are_dropped(void)
+{
+    Espressif_MQTT_Client client;
+    client.set_callback(onMessage);
+    client.set_receive_queue_size(256);
+    client.connect("bench", "token", NULL);
+    esp_mqtt_client_handle_t task = g_mockMqttClient;
+
+    // Bigger than esp-mqtt's buffer: arrives in two parts, neither is queued
+    std::string big(300, 'b');
+    mock_mqtt_receive(task, "t/big", big, 0, 150);
+    mock_mqtt_receive(task, "t/big", big, 150);
+
+    // The queue holds two of these, the third is dropped
+    for (int i = 0; i < 3; i++)
+    {
+        mock_mqtt_receive(task, "t/m", std::string(100, '0' + i));
+    }
+    client.loop();
+    TEST_ASSERT_EQUAL(2, (int)s_received.size());
+    TEST_ASSERT_TRUE(s_received[0].payload == std::string(100, '0'));
+    TEST_ASSERT_TRUE(s_received[1].payload == std::string(100, '1'));
+
+    // Room again once loop() returned them
+    mock_mqtt_receive(task, "t/m", std::string(100, '3'));
+    client.loop();
+    TEST_ASSERT_EQUAL(3, (int)s_received.size());
+}
+
+void test_connect_drops_messages_of_the_previous_session(void)
+{
+    Espressif_MQTT_Client client;
+    client.set_callback(onMessage);
+    client.set_receive_queue_size(1024);
+    client.set_disable_auto_reconnect(true);
+    client.connect("bench", "token", NULL);
+    esp_mqtt_client_handle_t task = g_mockMqttClient;
+
+    // Queued, but the connection drops before loop() ran
+    mock_mqtt_receive(task, "v1/devices/me/rpc/request/1", "{}");
+    mock_mqtt_drop(task);
+
+    client.connect("bench", "token", NULL);
+    mock_mqtt_receive(task, "v1/devices/me/rpc/request/2", "{}");
+    client.loop();
+    TEST_ASSERT_EQUAL(1, (int)s_received.size());
+    TEST_ASSERT_EQUAL_STRING("v1/devices/me/rpc/request/2", s_received[0].topic.c_str());
+}
+
+void test_without_queue_the_callback_gets_a_terminated_topic(void)
+{
+    Espressif_MQTT_Client client;
+    client.set_callback(onMessage);
+    client.connect("bench", "token", NULL);
+
+    // Called from the MQTT task's event, the topic is cut where the payload starts
+    mock_mqtt_receive(g_mockMqttClient, "v1/devices/me/attributes", "{\"a\":1}");
+    TEST_ASSERT_EQUAL(1, (int)s_received.size());
+    TEST_ASSERT_EQUAL_STRING("v1/devices/me/attributes", s_received[0].topic.c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"a\":1}", s_received[0].payload.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_publish_cost_on_the_calling_task);
+    RUN_TEST(test_connect_waits_for_the_broker);
+    RUN_TEST(test_reconnect_restarts_the_task_without_auto_reconnect);
+    RUN_TEST(test_reconnect_uses_the_pending_automatic_attempt);
+    RUN_TEST(test_received_messages_wait_for_loop);
+    RUN_TEST(test_fragments_and_overflow_are_dropped);
+    RUN_TEST(test_connect_drops_messages_of_the_previous_session);
+    RUN_TEST(test_without_queue_the_callback_gets_a_terminated_topic);
+    return UNITY_END();
+}
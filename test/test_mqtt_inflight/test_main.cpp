@@ -0,0 +1,186 @@
+// Host test for PubSubClient's QoS 1 in-flight window: telemetry throughput
+// against a broker with a 20 ms PUBACK round trip for windows of 1, 4 and 16,
+// and what happens to unacknowledged messages across a reconnect.
+#include <unity.h>
+#include "MockMqttBroker.h"
+#include "../../lib/PubSubClient/PubSubClient.cpp"
+
+#define BENCH_TOPIC "v1/devices/me/telemetry"
+#define BENCH_PAYLOAD "{\"temperature\":28.50,\"humidity\":61.20}"
+#define BENCH_RTT_MS 20
+#define BENCH_MS 400
+
+static boolean publishTelemetry(PubSubClient &client)
+{
+    return client.publish(BENCH_TOPIC, (const uint8_t *)BENCH_PAYLOAD, strlen(BENCH_PAYLOAD), false, 1);
+}
+
+// Packet ids of the QoS 1 PUBLISH packets sent, from the n-th packet on
+static std::vector<uint16_t> publishedIds(const MockMqttBroker &broker, size_t from = 0)
+{
+    std::vector<uint16_t> ids;
+    for (size_t i = from; i < broker.packets.size(); i++)
+    {
+        const std::vector<uint8_t> &p = broker.packets[i];
+        if ((p[0] & 0xF6) == 0x32)
+        {
+            ids.push_back(MockMqttBroker::publishId(p));
+        }
+    }
+    return ids;
+}
+
+// Messages acknowledged within BENCH_MS, publishing whenever the window has room
+static uint32_t acknowledgedIn(uint8_t window)
+{
+    MockMqttBroker broker;
+    broker.ackDelayMs = BENCH_RTT_MS;
+    PubSubClient client(broker);
+    client.setInflightWindow(window);
+    client.connect("bench");
+
+    uint32_t sent = 0;
+    unsigned long start = millis();
+    while (millis() - start < BENCH_MS)
+    {
+        client.loop();
+        if (publishTelemetry(client))
+        {
+            sent++;
+        }
+    }
+    return sent - client.getInflightCount();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_window_scales_throughput_with_round_trip(void)
+{
+    uint32_t acked[3];
+    const uint8_t windows[3] = {1, 4, 16};
+    for (int i = 0; i < 3; i++)
+    {
+        acked[i] = acknowledgedIn(windows[i]);
+        char report[120];
+        snprintf(report, sizeof(report), "window %2u: %4u msg/s at %d ms round trip",
+                 windows[i], (unsigned)(acked[i] * 1000 / BENCH_MS), BENCH_RTT_MS);
+        TEST_MESSAGE(report);
+    }
+
+    // One message per round trip with a window of 1, about window times that otherwise
+    TEST_ASSERT_TRUE(acked[0] <= BENCH_MS / BENCH_RTT_MS + 1);
+    TEST_ASSERT_TRUE(acked[1] >= 3 * acked[0]);
+    TEST_ASSERT_TRUE(acked[2] >= 3 * acked[1]);
+}
+
+void test_full_window_refuses_until_acked(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.setInflightWindow(4);
+    client.connect("bench");
+    broker.holdAcks(true);
+
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_TRUE(publishTelemetry(client));
+    }
+    TEST_ASSERT_FALSE(publishTelemetry(client));
+    TEST_ASSERT_EQUAL_UINT8(4, client.getInflightCount());
+    // The window can only be resized while empty
+    TEST_ASSERT_FALSE(client.setInflightWindow(8));
+
+    broker.releaseAcks();
+    client.loop();
+    client.loop();
+    TEST_ASSERT_EQUAL_UINT8(2, client.getInflightCount());
+    TEST_ASSERT_TRUE(publishTelemetry(client));
+    TEST_ASSERT_EQUAL(5, (int)broker.publishes());
+}
+
+void test_unacked_messages_are_resent_in_order_after_reconnect(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.setInflightWindow(4);
+    client.connect("bench");
+    broker.holdAcks(true);
+
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_TRUE(publishTelemetry(client));
+    }
+    std::vector<uint16_t> sent = publishedIds(broker);
+
+    // The link dies with nothing acknowledged; the loop notices
+    broker.dropLink();
+    broker.holdAcks(false);
+    TEST_ASSERT_FALSE(client.loop());
+    TEST_ASSERT_EQUAL(MQTT_CONNECTION_LOST, client.state());
+    TEST_ASSERT_EQUAL_UINT8(4, client.getInflightCount());
+
+    size_t before = broker.packets.size();
+    TEST_ASSERT_TRUE(client.connect("bench"));
+    std::vector<uint16_t> resent = publishedIds(broker, before);
+    TEST_ASSERT_EQUAL(4, (int)resent.size());
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(sent[i], resent[i]);
+    }
+    // Every resent copy has DUP set
+    TEST_ASSERT_EQUAL(4, (int)broker.publishes(true));
+
+    // Their PUBACKs empty the window, new messages go out without DUP
+    client.loop();
+    client.loop();
+    client.loop();
+    client.loop();
+    TEST_ASSERT_EQUAL_UINT8(0, client.getInflightCount());
+    TEST_ASSERT_TRUE(publishTelemetry(client));
+    TEST_ASSERT_EQUAL(4, (int)broker.publishes(true));
+    TEST_ASSERT_TRUE(MockMqttBroker::publishId(broker.packets.back()) != sent.back());
+}
+
+void test_publish_while_link_is_down_stays_in_window(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.setInflightWindow(4);
+    client.connect("bench");
+
+    // Writes fail before the socket reports the link down: the message is kept
+    broker.writeLimit = 0;
+    TEST_ASSERT_TRUE(publishTelemetry(client));
+    TEST_ASSERT_EQUAL(0, (int)broker.publishes());
+    TEST_ASSERT_EQUAL_UINT8(1, client.getInflightCount());
+
+    broker.dropLink();
+    broker.writeLimit = SIZE_MAX;
+    client.loop();
+    size_t before = broker.packets.size();
+    TEST_ASSERT_TRUE(client.connect("bench"));
+    TEST_ASSERT_EQUAL(1, (int)publishedIds(broker, before).size());
+    TEST_ASSERT_EQUAL(1, (int)broker.publishes(true));
+}
+
+void test_window_of_zero_refuses_qos1(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.setInflightWindow(0);
+    client.connect("bench");
+    TEST_ASSERT_FALSE(publishTelemetry(client));
+    TEST_ASSERT_EQUAL(0, (int)broker.publishes());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_window_scales_throughput_with_round_trip);
+    RUN_TEST(test_full_window_refuses_until_acked);
+    RUN_TEST(test_unacked_messages_are_resent_in_order_after_reconnect);
+    RUN_TEST(test_publish_while_link_is_down_stays_in_window);
+    RUN_TEST(test_window_of_zero_refuses_qos1);
+    return UNITY_END();
+}
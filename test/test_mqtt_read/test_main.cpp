@@ -0,0 +1,282 @@
+// Host benchmark for PubSubClient's bulk packet reader: inbound PUBLISH
+// packets of 100 B, 1 KB and 16 KB go through loop() from a broker that hands
+// out one TCP segment per available(), and the test counts Client calls and
+// time per message against the byte-at-a-time reader it replaced.
+#include <unity.h>
+#include "esp_timer.h"
+#include "MockMqttBroker.h"
+#include "../../lib/PubSubClient/PubSubClient.cpp"
+
+#define BENCH_TOPIC "v1/devices/me/rpc/request/1"
+#define BENCH_BUFFER 20000
+
+// Collects a streamed payload
+class Sink : public Stream
+{
+public:
+    std::vector<uint8_t> data;
+    size_t write(uint8_t b) override
+    {
+        data.push_back(b);
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        data.insert(data.end(), buffer, buffer + size);
+        return size;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+static std::string s_topic;
+static std::vector<uint8_t> s_payload;
+static uint32_t s_callbacks = 0;
+
+static void onMessage(char *topic, uint8_t *payload, unsigned int length)
+{
+    s_topic = topic;
+    s_payload.assign(payload, payload + length);
+    s_callbacks++;
+}
+
+// Payload byte i as MockMqttBroker::publishPacket() builds it
+static bool payloadMatches(const std::vector<uint8_t> &payload, size_t length)
+{
+    if (payload.size() != length)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        if (payload[i] != (uint8_t)(i * 7 + 3))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// readPacket() before the bulk reads: available() and read() for every byte
+static uint32_t readPacketPerByte(Client &client, uint8_t *buffer, uint32_t size)
+{
+    uint32_t len = 0;
+    auto readByte = [&client](uint8_t *result)
+    {
+        while (!client.available())
+        {
+        }
+        *result = client.read();
+    };
+    readByte(&buffer[len++]);
+    uint32_t multiplier = 1, length = 0;
+    uint8_t digit;
+    do
+    {
+        readByte(&digit);
+        buffer[len++] = digit;
+        length += (digit & 127) * multiplier;
+        multiplier <<= 7;
+    } while (digit & 128);
+    for (uint32_t i = 0; i < length; i++)
+    {
+        readByte(&digit);
+        if (len < size)
+        {
+            buffer[len++] = digit;
+        }
+    }
+    return len;
+}
+
+typedef struct
+{
+    double us;    // Per message
+    double calls; // Client calls per message
+} ReadCost_t;
+
+static void connect(PubSubClient &client, MockMqttBroker &broker)
+{
+    client.setBufferSize(BENCH_BUFFER);
+    client.setCallback(onMessage);
+    client.connect("bench");
+}
+
+static ReadCost_t readBulk(size_t payloadLength, uint8_t qos, int messages)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    connect(client, broker);
+    std::vector<uint8_t> packet = MockMqttBroker::publishPacket(BENCH_TOPIC, payloadLength, qos);
+    for (int i = 0; i < messages; i++)
+    {
+        broker.inject(packet);
+    }
+
+    s_callbacks = 0;
+    broker.reads = 0;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < messages; i++)
+    {
+        client.loop();
+    }
+    ReadCost_t cost = {(double)(esp_timer_get_time() - start) / messages, (double)broker.reads / messages};
+    if (s_callbacks != (uint32_t)messages || !payloadMatches(s_payload, payloadLength))
+    {
+        cost.calls = -1;
+    }
+    return cost;
+}
+
+static ReadCost_t readPerByte(size_t payloadLength, uint8_t qos, int messages)
+{
+    MockMqttBroker broker;
+    broker.connect("localhost", 1883);
+    std::vector<uint8_t> packet = MockMqttBroker::publishPacket(BENCH_TOPIC, payloadLength, qos);
+    for (int i = 0; i < messages; i++)
+    {
+        broker.inject(packet);
+    }
+
+    std::vector<uint8_t> buffer(BENCH_BUFFER);
+    broker.reads = 0;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < messages; i++)
+    {
+        if (readPacketPerByte(broker, buffer.data(), buffer.size()) != packet.size())
+        {
+            return {0, -1};
+        }
+    }
+    return {(double)(esp_timer_get_time() - start) / messages, (double)broker.reads / messages};
+}
+
+void setUp(void)
+{
+    s_topic.clear();
+    s_payload.clear();
+    s_callbacks = 0;
+}
+
+void tearDown(void) {}
+
+static void compareReaders(size_t payloadLength, int messages)
+{
+    for (uint8_t qos = 0; qos <= 1; qos++)
+    {
+        ReadCost_t bulk = readBulk(payloadLength, qos, messages);
+        ReadCost_t perByte = readPerByte(payloadLength, qos, messages);
+
+        char report[200];
+        snprintf(report, sizeof(report), "%5u B QoS %u: bulk %.2f us and %.1f client calls per message, per byte %.2f us and %.1f calls",
+                 (unsigned)payloadLength, qos, bulk.us, bulk.calls, perByte.us, perByte.calls);
+        TEST_MESSAGE(report);
+
+        TEST_ASSERT_TRUE_MESSAGE(bulk.calls > 0, "payload not delivered intact");
+        TEST_ASSERT_TRUE(perByte.calls > 0);
+        // Two calls per byte before; now two per TCP segment after the fixed header
+        TEST_ASSERT_TRUE(perByte.calls >= 2 * payloadLength);
+        TEST_ASSERT_TRUE(bulk.calls <= 16 + 2 * ((payloadLength + 64) / 1436 + 2));
+    }
+}
+
+void test_small_messages(void) { compareReaders(100, 2000); }
+void test_1k_messages(void) { compareReaders(1024, 500); }
+void test_16k_messages(void) { compareReaders(16384, 100); }
+
+void test_qos1_publish_is_acked_with_its_id(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    connect(client, broker);
+    broker.inject(MockMqttBroker::publishPacket(BENCH_TOPIC, 1024, 1, 0x1234));
+    client.loop();
+
+    TEST_ASSERT_EQUAL_STRING(BENCH_TOPIC, s_topic.c_str());
+    TEST_ASSERT_TRUE(payloadMatches(s_payload, 1024));
+    const std::vector<uint8_t> &ack = broker.packets.back();
+    TEST_ASSERT_EQUAL_HEX8(0x40, ack[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x12, ack[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x34, ack[3]);
+}
+
+void test_packet_split_across_small_segments(void)
+{
+    MockMqttBroker broker;
+    broker.segmentSize = 7; // The fixed header, the topic and the payload all straddle segments
+    PubSubClient client(broker);
+    connect(client, broker);
+    for (int i = 0; i < 3; i++)
+    {
+        broker.inject(MockMqttBroker::publishPacket(BENCH_TOPIC, 300 + i, 1, i + 1));
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        client.loop();
+        TEST_ASSERT_EQUAL_STRING(BENCH_TOPIC, s_topic.c_str());
+        TEST_ASSERT_TRUE(payloadMatches(s_payload, 300 + i));
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, s_callbacks);
+}
+
+void test_stream_gets_every_payload_byte(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    Sink sink;
+    client.setStream(sink);
+    connect(client, broker);
+    for (int i = 0; i < 4; i++)
+    {
+        broker.inject(MockMqttBroker::publishPacket(BENCH_TOPIC, 16384, i % 2, i + 1));
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        client.loop();
+    }
+    TEST_ASSERT_EQUAL(4 * 16384, (int)sink.data.size());
+    for (int i = 0; i < 4; i++)
+    {
+        std::vector<uint8_t> one(sink.data.begin() + i * 16384, sink.data.begin() + (i + 1) * 16384);
+        TEST_ASSERT_TRUE(payloadMatches(one, 16384));
+    }
+}
+
+void test_payload_larger_than_buffer_is_streamed_whole(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    Sink sink;
+    client.setStream(sink);
+    client.setCallback(onMessage);
+    client.setBufferSize(128);
+    client.connect("bench");
+    broker.inject(MockMqttBroker::publishPacket("t/x", 5000));
+    broker.inject(MockMqttBroker::publishPacket("t/y", 10));
+    client.loop();
+    client.loop();
+
+    // The stream takes both payloads, whole
+    TEST_ASSERT_EQUAL(5000 + 10, (int)sink.data.size());
+    std::vector<uint8_t> first(sink.data.begin(), sink.data.begin() + 5000);
+    TEST_ASSERT_TRUE(payloadMatches(first, 5000));
+    // The callback sees what fit in the buffer, the next packet is read cleanly
+    TEST_ASSERT_EQUAL_UINT32(2, s_callbacks);
+    TEST_ASSERT_EQUAL_STRING("t/y", s_topic.c_str());
+    TEST_ASSERT_TRUE(payloadMatches(s_payload, 10));
+    TEST_ASSERT_TRUE(client.connected());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_small_messages);
+    RUN_TEST(test_1k_messages);
+    RUN_TEST(test_16k_messages);
+    RUN_TEST(test_qos1_publish_is_acked_with_its_id);
+    RUN_TEST(test_packet_split_across_small_segments);
+    RUN_TEST(test_stream_gets_every_payload_byte);
+    RUN_TEST(test_payload_larger_than_buffer_is_streamed_whole);
+    return UNITY_END();
+}
@@ -0,0 +1,118 @@
+// Host test for PubSubClient::publish(topic, MQTTSegment*, count): large
+// payloads go out from the caller's memory through the default 256 B buffer,
+// byte for byte what the copying publish() puts on the wire, and a short
+// write drops the connection instead of leaving half a packet behind.
+#include <unity.h>
+#include "MockMqttBroker.h"
+#include "../../lib/PubSubClient/PubSubClient.cpp"
+
+#define BENCH_TOPIC "v1/devices/me/rpc/response/17"
+
+static std::vector<uint8_t> makePayload(size_t length)
+{
+    std::vector<uint8_t> payload(length);
+    for (size_t i = 0; i < length; i++)
+    {
+        payload[i] = 'a' + i % 26;
+    }
+    return payload;
+}
+
+// Payload of a QoS 0 PUBLISH packet
+static std::vector<uint8_t> payloadOf(const std::vector<uint8_t> &p)
+{
+    size_t i = MockMqttBroker::bodyStart(p);
+    size_t topicLength = (p[i] << 8) | p[i + 1];
+    return std::vector<uint8_t>(p.begin() + i + 2 + topicLength, p.end());
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_segments_match_the_copying_publish(void)
+{
+    const size_t sizes[] = {100, 1000, 20000};
+    for (size_t length : sizes)
+    {
+        std::vector<uint8_t> payload = makePayload(length);
+
+        MockMqttBroker copyBroker;
+        PubSubClient copying(copyBroker);
+        copying.setBufferSize(length + 64);
+        copying.connect("bench");
+        TEST_ASSERT_TRUE(copying.publish(BENCH_TOPIC, payload.data(), length, false));
+
+        MockMqttBroker segmentBroker;
+        PubSubClient segmented(segmentBroker);
+        segmented.connect("bench");
+        uint32_t writesBefore = segmentBroker.writes;
+        MQTTSegment segments[2] = {{payload.data(), length / 2}, {payload.data() + length / 2, length - length / 2}};
+        TEST_ASSERT_TRUE(segmented.publish(BENCH_TOPIC, segments, 2, false));
+
+        char report[160];
+        snprintf(report, sizeof(report), "%5u B: copy needs a %u B buffer and copies %u B, segments use %u B and copy %u B in %u writes",
+                 (unsigned)length, copying.getBufferSize(), (unsigned)(2 + strlen(BENCH_TOPIC) + length),
+                 segmented.getBufferSize(), (unsigned)(2 + strlen(BENCH_TOPIC)), (unsigned)(segmentBroker.writes - writesBefore));
+        TEST_MESSAGE(report);
+
+        // Header, then each segment straight from the caller's memory
+        TEST_ASSERT_EQUAL_UINT32(3, segmentBroker.writes - writesBefore);
+        TEST_ASSERT_EQUAL(MQTT_MAX_PACKET_SIZE, segmented.getBufferSize());
+        TEST_ASSERT_TRUE(copyBroker.packets.back() == segmentBroker.packets.back());
+    }
+}
+
+void test_payload_beyond_the_buffer_limit(void)
+{
+    // Over what the 16 bit buffer size can ever hold
+    std::vector<uint8_t> payload = makePayload(70000);
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.connect("bench");
+    TEST_ASSERT_FALSE(client.publish(BENCH_TOPIC, payload.data(), payload.size(), false));
+
+    MQTTSegment segments[3] = {{payload.data(), 1}, {payload.data() + 1, 0}, {payload.data() + 1, payload.size() - 1}};
+    TEST_ASSERT_TRUE(client.publish(BENCH_TOPIC, segments, 3, false));
+    TEST_ASSERT_EQUAL(1, (int)broker.publishes());
+    TEST_ASSERT_TRUE(payloadOf(broker.packets.back()) == payload);
+    TEST_ASSERT_TRUE(client.connected());
+}
+
+void test_no_segments_sends_an_empty_payload(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.connect("bench");
+    TEST_ASSERT_TRUE(client.publish(BENCH_TOPIC, (const MQTTSegment *)NULL, 0, true));
+    TEST_ASSERT_EQUAL(1, (int)broker.publishes());
+    TEST_ASSERT_EQUAL_HEX8(0x31, broker.packets.back()[0]);
+    TEST_ASSERT_EQUAL(0, (int)payloadOf(broker.packets.back()).size());
+}
+
+void test_short_write_drops_the_connection(void)
+{
+    std::vector<uint8_t> payload = makePayload(5000);
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.connect("bench");
+
+    // The socket takes the header, then only part of a segment
+    broker.writeLimit = 1000;
+    MQTTSegment segments[2] = {{payload.data(), 500}, {payload.data() + 500, 4500}};
+    TEST_ASSERT_FALSE(client.publish(BENCH_TOPIC, segments, 2, false));
+    TEST_ASSERT_EQUAL(MQTT_CONNECTION_LOST, client.state());
+    TEST_ASSERT_FALSE(client.connected());
+    TEST_ASSERT_FALSE(broker.connected());
+    // The broker never saw a whole packet it could misparse
+    TEST_ASSERT_EQUAL(0, (int)broker.publishes());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_segments_match_the_copying_publish);
+    RUN_TEST(test_payload_beyond_the_buffer_limit);
+    RUN_TEST(test_no_segments_sends_an_empty_payload);
+    RUN_TEST(test_short_write_drops_the_connection);
+    return UNITY_END();
+}
@@ -0,0 +1,348 @@
+// Host test for PubSubClient's MQTT 5 mode: uplink bytes for an hour of 1 Hz
+// telemetry with full 3.1.1 topics, MQTT 5 topic aliases and ThingsBoard's
+// v2 short topics, the fallback to 3.1.1 when the broker refuses level 5,
+// alias reuse when there are more topics than aliases, QoS 1 resends after
+// the protocol level changed, and inbound MQTT 5 publishes with properties.
+#include <unity.h>
+#include "MockMqttBroker.h"
+#include "../../lib/PubSubClient/PubSubClient.cpp"
+
+#define FULL_TOPIC "v1/devices/me/telemetry"
+#define SHORT_TOPIC "v2/t"
+#define BENCH_PAYLOAD "{\"temperature\":28.50,\"humidity\":61.20}"
+#define BENCH_MESSAGES 3600 // One hour at 1 Hz
+
+static std::string s_topic;
+static std::string s_payload;
+
+static void onMessage(char *topic, uint8_t *payload, unsigned int length)
+{
+    s_topic = topic;
+    s_payload.assign((const char *)payload, length);
+}
+
+// Collects a streamed payload
+class Sink : public Stream
+{
+public:
+    std::string data;
+    size_t write(uint8_t b) override
+    {
+        data += (char)b;
+        return 1;
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+// Uplink bytes for BENCH_MESSAGES telemetry messages, connection setup excluded
+static size_t bytesPerHour(uint8_t version, const char *topic, uint8_t qos)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.setProtocolVersion(version);
+    client.setInflightWindow(4);
+    client.connect("ESP32Client-1a2b", "token", NULL);
+
+    size_t start = broker.bytesSent;
+    for (int i = 0; i < BENCH_MESSAGES; i++)
+    {
+        if (!client.publish(topic, (const uint8_t *)BENCH_PAYLOAD, strlen(BENCH_PAYLOAD), false, qos))
+        {
+            return 0;
+        }
+        client.loop();
+    }
+    return broker.bytesSent - start;
+}
+
+// Topic and Topic Alias of an outbound MQTT 5 PUBLISH, alias 0 for none
+static std::string publishTopic(const std::vector<uint8_t> &p, uint16_t *alias)
+{
+    size_t i = MockMqttBroker::bodyStart(p);
+    size_t topicLength = (p[i] << 8) | p[i + 1];
+    std::string topic(p.begin() + i + 2, p.begin() + i + 2 + topicLength);
+    i += 2 + topicLength + ((p[0] & 0x06) ? 2 : 0);
+    *alias = p[i] == 3 && p[i + 1] == MQTT_PROP_TOPIC_ALIAS ? (p[i + 2] << 8) | p[i + 3] : 0;
+    return topic;
+}
+
+// Inbound MQTT 5 QoS 1 PUBLISH with Payload Format Indicator and Message Expiry
+static std::vector<uint8_t> v5Publish(const char *topic, const char *payload, uint16_t id)
+{
+    std::vector<uint8_t> body;
+    size_t topicLength = strlen(topic);
+    body.push_back(topicLength >> 8);
+    body.push_back(topicLength & 0xFF);
+    body.insert(body.end(), topic, topic + topicLength);
+    body.push_back(id >> 8);
+    body.push_back(id & 0xFF);
+    const uint8_t properties[] = {7, 0x01, 1, 0x02, 0, 0, 0, 60};
+    body.insert(body.end(), properties, properties + sizeof(properties));
+    body.insert(body.end(), payload, payload + strlen(payload));
+    std::vector<uint8_t> packet{0x32, (uint8_t)body.size()};
+    packet.insert(packet.end(), body.begin(), body.end());
+    return packet;
+}
+
+void setUp(void)
+{
+    s_topic.clear();
+    s_payload.clear();
+}
+
+void tearDown(void) {}
+
+void test_uplink_bytes_per_hour(void)
+{
+    struct
+    {
+        const char *name;
+        uint8_t version;
+        const char *topic;
+    } modes[] = {
+        {"3.1.1 full topic", MQTT_VERSION_3_1_1, FULL_TOPIC},
+        {"MQTT 5 topic alias", MQTT_VERSION_5, FULL_TOPIC},
+        {"3.1.1 short topic", MQTT_VERSION_3_1_1, SHORT_TOPIC},
+        {"MQTT 5 alias + short", MQTT_VERSION_5, SHORT_TOPIC},
+    };
+    size_t bytes[4][2];
+    for (int m = 0; m < 4; m++)
+    {
+        for (uint8_t qos = 0; qos <= 1; qos++)
+        {
+            bytes[m][qos] = bytesPerHour(modes[m].version, modes[m].topic, qos);
+            TEST_ASSERT_TRUE(bytes[m][qos] > 0);
+        }
+        char report[160];
+        snprintf(report, sizeof(report), "%-20s %.1f B/msg, %u B/hour at QoS 0, %u B/hour at QoS 1",
+                 modes[m].name, (double)bytes[m][0] / BENCH_MESSAGES, (unsigned)bytes[m][0], (unsigned)bytes[m][1]);
+        TEST_MESSAGE(report);
+    }
+
+    const size_t payload = strlen(BENCH_PAYLOAD);
+    // 3.1.1: fixed header, topic length, topic, payload
+    TEST_ASSERT_EQUAL_UINT32(BENCH_MESSAGES * (2 + 2 + strlen(FULL_TOPIC) + payload), bytes[0][0]);
+    // Alias: the topic goes out once, then an empty topic and a 4 byte property block
+    TEST_ASSERT_EQUAL_UINT32(BENCH_MESSAGES * (2 + 2 + 4 + payload) + strlen(FULL_TOPIC), bytes[1][0]);
+    // Short topic
+    TEST_ASSERT_EQUAL_UINT32(BENCH_MESSAGES * (2 + 2 + strlen(SHORT_TOPIC) + payload), bytes[2][0]);
+    // QoS 1 adds the packet id to every message
+    for (int m = 0; m < 4; m++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(bytes[m][0] + BENCH_MESSAGES * 2, bytes[m][1]);
+    }
+    TEST_ASSERT_TRUE(bytes[1][0] < bytes[0][0] * 3 / 4);
+}
+
+void test_falls_back_to_3_1_1_when_refused(void)
+{
+    MockMqttBroker broker;
+    broker.acceptV5 = false;
+    PubSubClient client(broker);
+    client.setProtocolVersion(MQTT_VERSION_5);
+
+    TEST_ASSERT_TRUE(client.connect("bench"));
+    TEST_ASSERT_EQUAL_UINT32(2, broker.connects);
+    TEST_ASSERT_EQUAL_UINT8(MQTT_VERSION_3_1_1, broker.protocolLevel);
+    TEST_ASSERT_EQUAL_UINT8(MQTT_VERSION_3_1_1, client.getProtocolVersion());
+
+    // Plain 3.1.1 PUBLISH: full topic, no property block
+    client.publish(FULL_TOPIC, "a");
+    const std::vector<uint8_t> expected = {0x30, 2 + 23 + 1, 0, 23, 'v', '1', '/', 'd', 'e', 'v', 'i', 'c', 'e', 's', '/',
+                                           'm', 'e', '/', 't', 'e', 'l', 'e', 'm', 'e', 't', 'r', 'y', 'a'};
+    TEST_ASSERT_TRUE(broker.packets.back() == expected);
+
+    // Stays at 3.1.1 on the next connect
+    client.disconnect();
+    TEST_ASSERT_TRUE(client.connect("bench"));
+    TEST_ASSERT_EQUAL_UINT32(3, broker.connects);
+    TEST_ASSERT_EQUAL_UINT8(MQTT_VERSION_3_1_1, broker.protocolLevel);
+}
+
+void test_aliases_are_reused_least_recently_used_first(void)
+{
+    MockMqttBroker broker;
+    broker.topicAliasMax = 2;
+    PubSubClient client(broker);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.connect("bench");
+
+    const char *topics[] = {"t/tele", "r/1", "t/tele", "r/2", "t/tele", "r/1"};
+    struct
+    {
+        const char *topic; // Sent, "" when only the alias goes out
+        uint16_t alias;
+    } expected[] = {{"t/tele", 1}, {"r/1", 2}, {"", 1}, {"r/2", 2}, {"", 1}, {"r/1", 2}};
+
+    size_t first = broker.packets.size();
+    for (const char *topic : topics)
+    {
+        TEST_ASSERT_TRUE(client.publish(topic, "x"));
+    }
+    for (int i = 0; i < 6; i++)
+    {
+        uint16_t alias;
+        std::string topic = publishTopic(broker.packets[first + i], &alias);
+        TEST_ASSERT_EQUAL_STRING(expected[i].topic, topic.c_str());
+        TEST_ASSERT_EQUAL_UINT16(expected[i].alias, alias);
+    }
+}
+
+void test_aliases_do_not_survive_a_reconnect(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.connect("bench");
+    client.publish(FULL_TOPIC, "a");
+    client.publish(FULL_TOPIC, "b");
+
+    broker.dropLink();
+    client.loop();
+    TEST_ASSERT_TRUE(client.connect("bench"));
+    client.publish(FULL_TOPIC, "c");
+    uint16_t alias;
+    TEST_ASSERT_EQUAL_STRING(FULL_TOPIC, publishTopic(broker.packets.back(), &alias).c_str());
+    TEST_ASSERT_EQUAL_UINT16(1, alias);
+}
+
+void test_qos1_resend_carries_the_full_topic(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setInflightWindow(2);
+    client.connect("bench");
+    broker.holdAcks(true);
+    client.publish(FULL_TOPIC, (const uint8_t *)"a", 1, false, 1);
+    client.publish(FULL_TOPIC, (const uint8_t *)"b", 1, false, 1);
+    uint16_t alias;
+    TEST_ASSERT_EQUAL_STRING("", publishTopic(broker.packets.back(), &alias).c_str());
+
+    broker.dropLink();
+    broker.holdAcks(false);
+    client.loop();
+    TEST_ASSERT_TRUE(client.connect("bench"));
+    TEST_ASSERT_EQUAL(2, (int)broker.publishes(true));
+    TEST_ASSERT_EQUAL_STRING(FULL_TOPIC, publishTopic(broker.packets.back(), &alias).c_str());
+    TEST_ASSERT_EQUAL_UINT16(0, alias);
+}
+
+// Payload of a QoS 1 PUBLISH and whether its encoding fits the level: a
+// property length byte of 0 after the packet id on MQTT 5, none on 3.1.1
+static bool qos1Payload(const std::vector<uint8_t> &p, bool v5, std::string *payload)
+{
+    size_t i = MockMqttBroker::bodyStart(p);
+    size_t remaining = 0;
+    for (size_t shift = 0, k = 1; k < i; k++, shift += 7)
+    {
+        remaining |= (size_t)(p[k] & 0x7F) << shift;
+    }
+    if (remaining != p.size() - i)
+    {
+        return false;
+    }
+    i += 2 + ((p[i] << 8) | p[i + 1]) + 2;
+    if (v5 && p[i++] != 0)
+    {
+        return false;
+    }
+    payload->assign(p.begin() + i, p.end());
+    return true;
+}
+
+void test_qos1_resend_follows_a_protocol_change(void)
+{
+    // 100 B: 127 B remaining length on 3.1.1, 128 B and a 2 byte length field on MQTT 5
+    const std::string payloads[] = {"a", std::string(100, 'b')};
+    MockMqttBroker broker;
+    broker.acceptV5 = false;
+    PubSubClient client(broker);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setInflightWindow(2);
+    TEST_ASSERT_TRUE(client.connect("bench"));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_VERSION_3_1_1, client.getProtocolVersion());
+    broker.holdAcks(true);
+    for (const std::string &payload : payloads)
+    {
+        TEST_ASSERT_TRUE(client.publish(FULL_TOPIC, (const uint8_t *)payload.data(), payload.size(), false, 1));
+    }
+
+    // Broker changed to one that speaks MQTT 5: the stored 3.1.1 packets get a property block
+    broker.dropLink();
+    client.loop();
+    broker.acceptV5 = true;
+    broker.holdAcks(false);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    TEST_ASSERT_TRUE(client.connect("bench"));
+    // The link dies again before the PUBACKs arrive
+    broker.holdAcks(true);
+    broker.dropLink();
+    client.loop();
+    TEST_ASSERT_EQUAL_UINT8(MQTT_VERSION_5, broker.protocolLevel);
+    TEST_ASSERT_EQUAL(2, (int)broker.publishes(true));
+    for (int i = 0; i < 2; i++)
+    {
+        std::string payload;
+        TEST_ASSERT_TRUE(qos1Payload(broker.packets[broker.packets.size() - 2 + i], true, &payload));
+        TEST_ASSERT_TRUE(payload == payloads[i]);
+    }
+
+    // And back: a broker that refuses level 5 gets them without one
+    broker.acceptV5 = false;
+    broker.holdAcks(false);
+    TEST_ASSERT_TRUE(client.connect("bench"));
+    TEST_ASSERT_EQUAL_UINT8(MQTT_VERSION_3_1_1, broker.protocolLevel);
+    TEST_ASSERT_EQUAL(4, (int)broker.publishes(true));
+    for (int i = 0; i < 2; i++)
+    {
+        std::string payload;
+        TEST_ASSERT_TRUE(qos1Payload(broker.packets[broker.packets.size() - 2 + i], false, &payload));
+        TEST_ASSERT_TRUE(payload == payloads[i]);
+    }
+
+    // Their PUBACKs drain the window, one per loop()
+    client.loop();
+    client.loop();
+    TEST_ASSERT_EQUAL_UINT8(0, client.getInflightCount());
+}
+
+void test_inbound_publish_properties_are_skipped(void)
+{
+    MockMqttBroker broker;
+    PubSubClient client(broker);
+    client.setProtocolVersion(MQTT_VERSION_5);
+    client.setCallback(onMessage);
+    client.connect("bench");
+
+    broker.inject(v5Publish("v1/devices/me/rpc/request/7", "{\"method\":\"getState\"}", 0x0107));
+    client.loop();
+    TEST_ASSERT_EQUAL_STRING("v1/devices/me/rpc/request/7", s_topic.c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"method\":\"getState\"}", s_payload.c_str());
+    // Success is implied when an MQTT 5 PUBACK leaves out the reason code
+    const std::vector<uint8_t> puback = {0x40, 2, 0x01, 0x07};
+    TEST_ASSERT_TRUE(broker.packets.back() == puback);
+
+    // The stream gets the payload without the properties too
+    Sink sink;
+    client.setStream(sink);
+    broker.inject(v5Publish("v1/devices/me/rpc/request/8", "hello", 8));
+    client.loop();
+    TEST_ASSERT_EQUAL_STRING("hello", sink.data.c_str());
+    TEST_ASSERT_EQUAL_STRING("hello", s_payload.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_uplink_bytes_per_hour);
+    RUN_TEST(test_falls_back_to_3_1_1_when_refused);
+    RUN_TEST(test_aliases_are_reused_least_recently_used_first);
+    RUN_TEST(test_aliases_do_not_survive_a_reconnect);
+    RUN_TEST(test_qos1_resend_carries_the_full_topic);
+    RUN_TEST(test_qos1_resend_follows_a_protocol_change);
+    RUN_TEST(test_inbound_publish_properties_are_skipped);
+    return UNITY_END();
+}
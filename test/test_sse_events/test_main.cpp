@@ -0,0 +1,233 @@
+// Host test for the /events SSE stream (task_webserver.cpp): Last-Event-ID
+// resume from the in-RAM history, and the heap a broadcast holds per SSE
+// client compared with a WebSocket client.
+//
+// The mock queues what the library queues per client (a formatted copy of
+// every SSE message, a reference to the shared buffer for WebSocket), so the
+// heap numbers cover the queued messages; the connection objects themselves
+// are not modelled.
+#include <unity.h>
+#include "mock_heap.h"
+#include "../../src/task_webserver.cpp"
+
+#define BENCH_CLIENTS 8
+
+// Collaborators task_webserver.cpp links against on the device
+EventGroupHandle_t g_netEvents = NULL;
+WifiConfig_t *g_wifiConfig = NULL;
+QueueHandle_t xQueueRelayControl = NULL;
+QueueHandle_t xQueueSettings = NULL;
+void getSensorData(float *temp, float *humi) { *temp = *humi = NAN; }
+void bootMilestone(EventBits_t, const char *) {}
+EventBits_t waitBootEvents(EventBits_t bits) { return bits; }
+void getPowerStats(PowerStats_t *stats) { memset(stats, 0, sizeof(PowerStats_t)); }
+void power_waitNextPeriod(TickType_t *) {}
+void getTsStoreStats(TsStoreStats_t *stats) { memset(stats, 0, sizeof(TsStoreStats_t)); }
+bool history_timeValid() { return false; }
+uint32_t history_now() { return 0; }
+bool history_aggregate(uint32_t, uint32_t, HistoryBucket_t *) { return false; }
+void history_range(uint32_t *oldest, uint32_t *count) { *oldest = *count = 0; }
+
+static void makeSensorFrame(JsonDocument &doc, float temp)
+{
+    doc.clear();
+    doc["page"] = "home";
+    JsonObject value = doc.createNestedObject("value");
+    value["temp"] = temp;
+    value["humi"] = 60.2;
+}
+
+static void broadcast(int count)
+{
+    StaticJsonDocument<200> doc;
+    for (int i = 0; i < count; i++)
+    {
+        makeSensorFrame(doc, 20.0f + i);
+        Webserver_sendDocument(doc);
+    }
+}
+
+// "id: N" of a queued message, 0 if it has none
+static uint32_t messageId(const std::string &message)
+{
+    size_t pos = message.find("id: ");
+    return pos == std::string::npos ? 0 : (uint32_t)strtoul(message.c_str() + pos + 4, NULL, 10);
+}
+
+// Ids the client got, in the order it got them
+static std::vector<uint32_t> receivedIds(const AsyncEventSourceClient *client)
+{
+    std::vector<uint32_t> ids;
+    for (const std::string &message : client->queued())
+    {
+        uint32_t id = messageId(message);
+        if (id != 0)
+        {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+// Consecutive ids, so nothing retained was skipped or sent twice
+static bool idsConsecutive(const std::vector<uint32_t> &ids)
+{
+    for (size_t i = 1; i < ids.size(); i++)
+    {
+        if (ids[i] != ids[i - 1] + 1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void setUp(void)
+{
+    registerHandlers();
+    while (!ws.getClients().empty())
+    {
+        ws.disconnect(ws.getClients().front().id());
+    }
+    events.getClients().clear();
+    memset(s_sseHistory, 0, sizeof(s_sseHistory));
+    s_sseNextId = 1;
+}
+
+void tearDown(void) {}
+
+void test_new_client_gets_retry_without_replay(void)
+{
+    broadcast(3);
+    AsyncEventSourceClient *client = events.connect();
+
+    TEST_ASSERT_EQUAL(1, (int)client->packetsWaiting());
+    const std::string &hello = client->queued().front();
+    TEST_ASSERT_TRUE(hello.find("retry: 2000\r\n") != std::string::npos);
+    TEST_ASSERT_TRUE(hello.find("data: hello\r\n") != std::string::npos);
+    TEST_ASSERT_EQUAL_UINT32(0, messageId(hello));
+}
+
+void test_live_events_carry_ids_and_page_as_event(void)
+{
+    AsyncEventSourceClient *client = events.connect();
+    client->drain();
+    broadcast(2);
+
+    TEST_ASSERT_EQUAL(2, (int)client->packetsWaiting());
+    const std::string &first = client->queued().front();
+    TEST_ASSERT_EQUAL_UINT32(1, messageId(first));
+    TEST_ASSERT_TRUE(first.find("event: home\r\n") != std::string::npos);
+    TEST_ASSERT_TRUE(first.find("data: {\"page\":\"home\"") != std::string::npos);
+    TEST_ASSERT_EQUAL_UINT32(2, messageId(client->queued().back()));
+}
+
+void test_resume_replays_missed_events_in_order(void)
+{
+    broadcast(10);
+    AsyncEventSourceClient *client = events.connect(4);
+
+    std::vector<uint32_t> ids = receivedIds(client);
+    TEST_ASSERT_EQUAL(6, (int)ids.size());
+    TEST_ASSERT_TRUE(idsConsecutive(ids));
+    TEST_ASSERT_EQUAL_UINT32(5, ids.front());
+    TEST_ASSERT_EQUAL_UINT32(10, ids.back());
+
+    // Nothing missed: nothing replayed
+    AsyncEventSourceClient *current = events.connect(10);
+    TEST_ASSERT_EQUAL(0, (int)current->packetsWaiting());
+}
+
+void test_resume_after_wrap_starts_at_oldest_retained(void)
+{
+    broadcast(WS_SSE_HISTORY + 20);
+    AsyncEventSourceClient *client = events.connect(3);
+
+    std::vector<uint32_t> ids = receivedIds(client);
+    TEST_ASSERT_EQUAL(WS_SSE_HISTORY, (int)ids.size());
+    TEST_ASSERT_TRUE(idsConsecutive(ids));
+    TEST_ASSERT_EQUAL_UINT32(21, ids.front());
+    TEST_ASSERT_EQUAL_UINT32(WS_SSE_HISTORY + 20, ids.back());
+}
+
+void test_oversized_event_is_streamed_without_id(void)
+{
+    AsyncEventSourceClient *live = events.connect();
+    live->drain();
+    broadcast(1);
+
+    std::string note(WS_SSE_EVENT_SIZE, 'x');
+    StaticJsonDocument<512> big;
+    big["page"] = "device";
+    big["value"]["note"] = note.c_str(); // Linked, not copied: note outlives the broadcast
+    Webserver_sendDocument(big);
+    broadcast(1);
+
+    TEST_ASSERT_EQUAL(3, (int)live->packetsWaiting());
+    const std::string &oversized = live->queued()[1];
+    TEST_ASSERT_EQUAL_UINT32(0, messageId(oversized));
+    TEST_ASSERT_TRUE(oversized.find("event: device\r\n") != std::string::npos);
+    TEST_ASSERT_TRUE(oversized.find(note) != std::string::npos);
+
+    // It took no id, so the stream resumes across it without a gap
+    AsyncEventSourceClient *resumed = events.connect(1);
+    std::vector<uint32_t> ids = receivedIds(resumed);
+    TEST_ASSERT_EQUAL(1, (int)ids.size());
+    TEST_ASSERT_EQUAL_UINT32(2, ids.front());
+}
+
+// Heap still held once a broadcast returned, i.e. what sits in the queues.
+// A first broadcast is drained before, so the queues' own nodes exist already
+static size_t heapHeldByBroadcast()
+{
+    broadcast(1);
+    for (AsyncWebSocketClient &c : ws.getClients())
+    {
+        c.drain();
+    }
+    for (AsyncEventSourceClient &c : events.getClients())
+    {
+        c.drain();
+    }
+    size_t before = g_mockHeapUsed;
+    broadcast(1);
+    return g_mockHeapUsed - before;
+}
+
+void test_heap_per_client_sse_vs_ws(void)
+{
+    for (uint32_t id = 1; id <= BENCH_CLIENTS; id++)
+    {
+        ws.connect(id);
+    }
+    size_t wsHeld = heapHeldByBroadcast();
+    setUp();
+
+    for (int i = 0; i < BENCH_CLIENTS; i++)
+    {
+        events.connect();
+    }
+    size_t sseHeld = heapHeldByBroadcast();
+
+    char report[160];
+    snprintf(report, sizeof(report), "%d clients, heap held per broadcast: ws %u B (%u B/client), sse %u B (%u B/client)",
+             BENCH_CLIENTS, (unsigned)wsHeld, (unsigned)(wsHeld / BENCH_CLIENTS),
+             (unsigned)sseHeld, (unsigned)(sseHeld / BENCH_CLIENTS));
+    TEST_MESSAGE(report);
+
+    // WebSocket clients share a pool buffer, every SSE client holds its own copy
+    TEST_ASSERT_EQUAL(0, (int)wsHeld);
+    TEST_ASSERT_TRUE(sseHeld >= BENCH_CLIENTS * strlen("id: 1\r\nevent: home\r\ndata: {}\r\n\r\n"));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_new_client_gets_retry_without_replay);
+    RUN_TEST(test_live_events_carry_ids_and_page_as_event);
+    RUN_TEST(test_resume_replays_missed_events_in_order);
+    RUN_TEST(test_resume_after_wrap_starts_at_oldest_retained);
+    RUN_TEST(test_oversized_event_is_streamed_without_id);
+    RUN_TEST(test_heap_per_client_sse_vs_ws);
+    return UNITY_END();
+}
@@ -0,0 +1,227 @@
+// Host benchmark for the WebSocket fan-out (task_webserver.cpp): 8 simulated
+// clients take the same sensor frame through Webserver_sendDocument(), and
+// the test counts heap allocations and time per broadcast against the
+// serialize-to-String + ws.textAll() path it replaced.
+#include <unity.h>
+#include "mock_heap.h"
+#include "../../src/task_webserver.cpp"
+
+#define BENCH_CLIENTS 8
+#define BENCH_BROADCASTS 2000
+
+// Collaborators task_webserver.cpp links against on the device
+EventGroupHandle_t g_netEvents = NULL;
+WifiConfig_t *g_wifiConfig = NULL;
+QueueHandle_t xQueueRelayControl = NULL;
+QueueHandle_t xQueueSettings = NULL;
+void getSensorData(float *temp, float *humi) { *temp = *humi = NAN; }
+void bootMilestone(EventBits_t, const char *) {}
+EventBits_t waitBootEvents(EventBits_t bits) { return bits; }
+void getPowerStats(PowerStats_t *stats) { memset(stats, 0, sizeof(PowerStats_t)); }
+void power_waitNextPeriod(TickType_t *) {}
+void getTsStoreStats(TsStoreStats_t *stats) { memset(stats, 0, sizeof(TsStoreStats_t)); }
+bool history_timeValid() { return false; }
+uint32_t history_now() { return 0; }
+bool history_aggregate(uint32_t, uint32_t, HistoryBucket_t *) { return false; }
+void history_range(uint32_t *oldest, uint32_t *count) { *oldest = *count = 0; }
+
+// Same frame Webserver_RTOS_Task sends every POWER_PERIOD_MS
+static void makeSensorFrame(JsonDocument &doc, float temp)
+{
+    doc.clear();
+    doc["page"] = "home";
+    JsonObject value = doc.createNestedObject("value");
+    value["temp"] = temp;
+    value["humi"] = 60.2;
+}
+
+// Clients send everything queued, so every pool slot comes back
+static void drainClients()
+{
+    for (AsyncWebSocketClient &c : ws.getClients())
+    {
+        c.drain();
+    }
+}
+
+static void connectClients(size_t json, size_t msgpack)
+{
+    uint32_t id = 1;
+    for (size_t i = 0; i < json; i++)
+    {
+        ws.connect(id++);
+    }
+    for (size_t i = 0; i < msgpack; i++)
+    {
+        ws.connect(id++, WS_PROTO_MSGPACK);
+    }
+}
+
+void setUp(void)
+{
+    registerHandlers();
+    while (!ws.getClients().empty())
+    {
+        ws.disconnect(ws.getClients().front().id());
+    }
+    s_protoStats = WsProtocolStats_t();
+}
+
+void tearDown(void) {}
+
+void test_broadcast_shares_one_buffer_per_encoding(void)
+{
+    connectClients(BENCH_CLIENTS - 2, 2);
+    StaticJsonDocument<200> doc;
+    makeSensorFrame(doc, 28.5);
+
+    Webserver_sendDocument(doc);
+
+    // One serialization per encoding in use, the same buffer in every queue
+    TEST_ASSERT_EQUAL_UINT32(1, s_protoStats.jsonMessages);
+    TEST_ASSERT_EQUAL_UINT32(1, s_protoStats.msgpackMessages);
+    const uint8_t *json = NULL;
+    const uint8_t *msgpack = NULL;
+    for (AsyncWebSocketClient &c : ws.getClients())
+    {
+        TEST_ASSERT_EQUAL(1, (int)c.queueLen());
+        const AsyncWebSocketClient::Frame_t &frame = c.queued().front();
+        const uint8_t *&shared = frame.binary ? msgpack : json;
+        if (shared == NULL)
+        {
+            shared = frame.buffer->data();
+        }
+        TEST_ASSERT_TRUE_MESSAGE(shared == frame.buffer->data(), "client got its own copy");
+    }
+    TEST_ASSERT_TRUE(json != NULL && msgpack != NULL);
+
+    String expected;
+    serializeJson(doc, expected);
+    const std::vector<uint8_t> &sent = *ws.getClients().front().queued().front().buffer;
+    TEST_ASSERT_EQUAL(expected.length(), (int)sent.size());
+    TEST_ASSERT_EQUAL_MEMORY(expected.c_str(), sent.data(), sent.size());
+    drainClients();
+}
+
+void test_steady_state_broadcast_does_not_allocate(void)
+{
+    connectClients(BENCH_CLIENTS, 0);
+    StaticJsonDocument<200> doc;
+
+    // Pool path: Webserver_sendDocument into the shared, pre-reserved buffers
+    mock_heap_reset();
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_BROADCASTS; i++)
+    {
+        makeSensorFrame(doc, 20.0f + (i % 100) * 0.1f);
+        Webserver_sendDocument(doc);
+        drainClients();
+    }
+    int64_t poolUs = esp_timer_get_time() - start;
+    uint32_t poolAllocations = g_mockHeap.allocations;
+
+    // Previous path: a String per broadcast, copied into a new message buffer by textAll()
+    mock_heap_reset();
+    start = esp_timer_get_time();
+    for (int i = 0; i < BENCH_BROADCASTS; i++)
+    {
+        makeSensorFrame(doc, 20.0f + (i % 100) * 0.1f);
+        String data;
+        serializeJson(doc, data);
+        ws.textAll(data);
+        drainClients();
+    }
+    int64_t textAllUs = esp_timer_get_time() - start;
+    uint32_t textAllAllocations = g_mockHeap.allocations;
+
+    char report[200];
+    snprintf(report, sizeof(report), "%d clients: pool %.2f us and %.2f allocations per broadcast, textAll %.2f us and %.2f allocations",
+             BENCH_CLIENTS, (double)poolUs / BENCH_BROADCASTS, (double)poolAllocations / BENCH_BROADCASTS,
+             (double)textAllUs / BENCH_BROADCASTS, (double)textAllAllocations / BENCH_BROADCASTS);
+    TEST_MESSAGE(report);
+
+    TEST_ASSERT_EQUAL_UINT32(BENCH_BROADCASTS, s_protoStats.broadcasts);
+    TEST_ASSERT_EQUAL_UINT32(0, s_protoStats.poolMisses);
+    TEST_ASSERT_EQUAL_UINT32(0, poolAllocations);
+    TEST_ASSERT_TRUE(textAllAllocations >= BENCH_BROADCASTS);
+}
+
+void test_pool_falls_back_to_heap_while_every_slot_is_queued(void)
+{
+    connectClients(1, 0);
+    StaticJsonDocument<200> doc;
+    makeSensorFrame(doc, 28.5);
+
+    // Device events are always queued, a client that never sends holds every slot
+    for (int i = 0; i < WS_BROADCAST_POOL_SIZE + 2; i++)
+    {
+        Webserver_sendDocument(doc);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, s_protoStats.poolMisses);
+
+    drainClients();
+    Webserver_sendDocument(doc);
+    TEST_ASSERT_EQUAL_UINT32(2, s_protoStats.poolMisses);
+    drainClients();
+}
+
+void test_congested_client_keeps_only_the_latest_frame(void)
+{
+    connectClients(2, 0);
+    AsyncWebSocketClient &slow = ws.getClients().back();
+    slow.client()->setSpace(0);
+    StaticJsonDocument<200> doc;
+
+    for (int i = 0; i < 5; i++)
+    {
+        makeSensorFrame(doc, 20.0f + i);
+        Webserver_sendDocument(doc, true);
+        ws.getClients().front().drain();
+    }
+    TEST_ASSERT_EQUAL(0, (int)slow.queueLen());
+    WsClientState_t *st = findClientState(slow.id());
+    TEST_ASSERT_EQUAL_UINT32(4, st->framesDropped);
+
+    // Send window opens again: only the newest frame goes out
+    slow.client()->setSpace(5744);
+    Webserver_flushPending();
+    TEST_ASSERT_EQUAL(1, (int)slow.queueLen());
+    const std::vector<uint8_t> &frame = *slow.queued().front().buffer;
+    TEST_ASSERT_TRUE(std::string(frame.begin(), frame.end()).find("\"temp\":24") != std::string::npos);
+    drainClients();
+}
+
+void test_msgpack_client_without_a_slot_is_refused(void)
+{
+    connectClients(WS_MAX_PROTO_CLIENTS, 0);
+    AsyncWebSocketClient *json = ws.connect(100);
+    AsyncWebSocketClient *binary = ws.connect(101, WS_PROTO_MSGPACK);
+
+    // A JSON client without a slot only misses the flow control, text is its protocol anyway
+    TEST_ASSERT_EQUAL(WS_CONNECTED, json->status());
+    // The handshake already accepted iot.msgpack, so text frames are no option
+    TEST_ASSERT_EQUAL(WS_DISCONNECTED, binary->status());
+    TEST_ASSERT_EQUAL(WS_CLOSE_TRY_AGAIN_LATER, binary->closeCode());
+
+    StaticJsonDocument<200> doc;
+    makeSensorFrame(doc, 28.5);
+    Webserver_sendDocument(doc);
+    TEST_ASSERT_EQUAL(1, (int)json->queued().size());
+    TEST_ASSERT_FALSE(json->queued().front().binary);
+
+    // Once a slot is free the next binary client gets it
+    ws.disconnect(1);
+    TEST_ASSERT_EQUAL(WS_CONNECTED, ws.connect(102, WS_PROTO_MSGPACK)->status());
+    drainClients();
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_broadcast_shares_one_buffer_per_encoding);
+    RUN_TEST(test_steady_state_broadcast_does_not_allocate);
+    RUN_TEST(test_pool_falls_back_to_heap_while_every_slot_is_queued);
+    RUN_TEST(test_congested_client_keeps_only_the_latest_frame);
+    RUN_TEST(test_msgpack_client_without_a_slot_is_refused);
+    return UNITY_END();
+}
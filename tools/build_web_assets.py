@@ -0,0 +1,209 @@
+# Builds the dashboard bundle that gets flashed to LittleFS.
+#
+# data/*           -> .pio/webdist/www/index.html.gz
+#                     .pio/webdist/www/assets/<name>.<hash>.<ext>.gz
+#
+# Assets are lightly minified, gzipped and renamed with a content hash so the
+# firmware can serve them with "immutable" cache headers; index.html keeps its
+# name and is revalidated through the ETag the web server derives from the gzip
+# CRC. Runs automatically as a PlatformIO pre-script (see platformio.ini) or by
+# hand: python tools/build_web_assets.py
+#
+# Non-web files in data/ (anything not listed in WEB_EXTENSIONS) are copied
+# through unchanged so the filesystem image keeps them.
+#
+# The same gzipped bytes are also emitted as const arrays in
+# .pio/webgen/web_assets_embedded.h for -DWEB_ASSETS_EMBEDDED builds, which
+# serve the dashboard straight from flash without touching LittleFS.
+
+import gzip
+import hashlib
+import os
+import re
+import shutil
+import zlib
+
+WEB_EXTENSIONS = (".html", ".js", ".css")
+INDEX_FILE = "index.html"
+ASSET_DIR = "assets"
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    env = None
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SRC_DIR = os.path.join(PROJECT_DIR, "data")
+OUT_DIR = os.path.join(PROJECT_DIR, ".pio", "webdist")
+WWW_DIR = os.path.join(OUT_DIR, "www")
+GEN_DIR = os.path.join(PROJECT_DIR, ".pio", "webgen")
+EMBED_HEADER = os.path.join(GEN_DIR, "web_assets_embedded.h")
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".js": "application/javascript",
+    ".css": "text/css",
+}
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    out = []
+    parts = re.split(r"([{}])", text)
+    for i in range(0, len(parts), 2):
+        part = parts[i]
+        brace = parts[i + 1] if i + 1 < len(parts) else ""
+        if brace == "{":
+            # Selector or @-rule prelude: a space before ":" or ">" can be a
+            # descendant combinator (".card :hover"), so only "," is safe
+            part = re.sub(r"\s*,\s*", ",", part)
+        else:
+            # Declarations
+            part = re.sub(r"\s*([;:,])\s*", r"\1", part)
+        out.append(part.strip() + brace)
+    return "".join(out).replace(";}", "}").strip()
+
+
+def minify_js(text):
+    # Conservative: drop whole-line comments and indentation only. Anything
+    # smarter needs a real tokenizer (template literals, "ws://" in strings).
+    lines = []
+    for line in text.splitlines():
+        stripped = line.strip()
+        if not stripped or stripped.startswith("//"):
+            continue
+        lines.append(stripped)
+    return "\n".join(lines) + "\n"
+
+
+def minify_html(text):
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    return "\n".join(l.strip() for l in text.splitlines() if l.strip()) + "\n"
+
+
+def minify(name, text):
+    if name.endswith(".min.js"):
+        return text
+    if name.endswith(".css"):
+        return minify_css(text)
+    if name.endswith(".js"):
+        return minify_js(text)
+    if name.endswith(".html"):
+        return minify_html(text)
+    return text
+
+
+def write_gzip(path, data):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    # mtime=0 keeps the output (and therefore the ETag) reproducible
+    with open(path, "wb") as f:
+        with gzip.GzipFile(filename="", mode="wb", fileobj=f, compresslevel=9, mtime=0) as gz:
+            gz.write(data)
+    return os.path.getsize(path)
+
+
+def hashed_name(name, data):
+    digest = hashlib.sha1(data).hexdigest()[:8]
+    base, ext = (name[:-7], ".min.js") if name.endswith(".min.js") else os.path.splitext(name)
+    return "%s.%s%s" % (base, digest, ext)
+
+
+def write_embedded_header(entries):
+    # entries: (uri, source name, gzipped bytes, etag, immutable); URIs that
+    # serve the same source file ("/" and "/index.html") share one array
+    os.makedirs(GEN_DIR, exist_ok=True)
+    out = [
+        "// Generated by tools/build_web_assets.py - do not edit",
+        "#pragma once",
+        "#include <Arduino.h>",
+        "",
+    ]
+    arrays = {}
+    for uri, name, data, etag, immutable in entries:
+        if name in arrays:
+            continue
+        arrays[name] = "WEB_ASSET_%d" % len(arrays)
+        out.append("// %s (%d bytes gzipped)" % (name, len(data)))
+        out.append("static const uint8_t %s[] PROGMEM = {" % arrays[name])
+        for off in range(0, len(data), 24):
+            out.append("    " + ",".join("0x%02x" % b for b in data[off:off + 24]) + ",")
+        out.append("};")
+        out.append("")
+    out.append("static const EmbeddedWebAsset_t EMBEDDED_WEB_ASSETS[] = {")
+    for uri, name, data, etag, immutable in entries:
+        mime = MIME_TYPES.get(os.path.splitext(name)[1], "application/octet-stream")
+        out.append('    {"%s", "%s", %s, %d, "%s", %s},'
+                   % (uri, mime, arrays[name], len(data), etag, "true" if immutable else "false"))
+    out.append("};")
+    out.append("static const size_t EMBEDDED_WEB_ASSET_COUNT = %d;" % len(entries))
+    with open(EMBED_HEADER, "w") as f:
+        f.write("\n".join(out) + "\n")
+
+
+def gzip_bytes(path, data):
+    write_gzip(path, data)
+    with open(path, "rb") as f:
+        return f.read(), "%08x" % (zlib.crc32(data) & 0xFFFFFFFF)
+
+
+def build():
+    if not os.path.isdir(SRC_DIR):
+        print("[web] no data/ directory, skipping asset bundle")
+        return
+
+    shutil.rmtree(OUT_DIR, ignore_errors=True)
+    os.makedirs(WWW_DIR)
+
+    renames = {}
+    embedded = []
+    raw_total = 0
+    gz_total = 0
+
+    for name in sorted(os.listdir(SRC_DIR)):
+        src = os.path.join(SRC_DIR, name)
+        if not os.path.isfile(src) or name.startswith("."):
+            continue
+        if not name.endswith(WEB_EXTENSIONS):
+            shutil.copy2(src, os.path.join(OUT_DIR, name))
+            continue
+        if name == INDEX_FILE:
+            continue
+
+        with open(src, "r", encoding="utf-8") as f:
+            text = f.read()
+        data = minify(name, text).encode("utf-8")
+        target = hashed_name(name, data)
+        renames[name] = "%s/%s" % (ASSET_DIR, target)
+
+        gz, etag = gzip_bytes(os.path.join(WWW_DIR, ASSET_DIR, target + ".gz"), data)
+        embedded.append(("/%s/%s" % (ASSET_DIR, target), name, gz, etag, True))
+        size = len(gz)
+        raw_total += len(text.encode("utf-8"))
+        gz_total += size
+        print("[web] %-22s -> %-32s %7d -> %6d bytes" % (name, target + ".gz", len(text.encode("utf-8")), size))
+
+    index_src = os.path.join(SRC_DIR, INDEX_FILE)
+    if os.path.isfile(index_src):
+        with open(index_src, "r", encoding="utf-8") as f:
+            text = f.read()
+        html = minify_html(text)
+        for old, new in renames.items():
+            html = re.sub(r'((?:src|href)=")%s"' % re.escape(old), r'\g<1>%s"' % new, html)
+        gz, etag = gzip_bytes(os.path.join(WWW_DIR, INDEX_FILE + ".gz"), html.encode("utf-8"))
+        embedded.append(("/", INDEX_FILE, gz, etag, False))
+        embedded.append(("/" + INDEX_FILE, INDEX_FILE, gz, etag, False))
+        size = len(gz)
+        raw_total += len(text.encode("utf-8"))
+        gz_total += size
+        print("[web] %-22s -> %-32s %7d -> %6d bytes" % (INDEX_FILE, INDEX_FILE + ".gz", len(text.encode("utf-8")), size))
+
+    write_embedded_header(embedded)
+    print("[web] first page load: %d bytes (was %d uncompressed), repeat load: index only" % (gz_total, raw_total))
+
+
+build()
+
+if env is not None:
+    env.Append(CPPPATH=[GEN_DIR])
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+# Builds and applies delta OTA patches for Espressif_Delta_Updater
+# (lib/ThingsBoard/Espressif_Delta_Updater.h).
+#
+#   python tools/delta_patch.py diff old.bin new.bin -o update.patch
+#   python tools/delta_patch.py apply old.bin update.patch -o new.bin
+#   python tools/delta_patch.py check old.bin new.bin
+#
+# old.bin is the image the devices are running (keep .pio/build/<env>/firmware.bin
+# of every release), new.bin the release to ship. The patch is uploaded to
+# ThingsBoard as the OTA package in place of new.bin and only applies on top of
+# exactly old.bin; its title and version are the COREIOT_FW_TITLE and
+# COREIOT_FW_VERSION new.bin was built with (include/coreiot.h). `check` builds the patch, reconstructs new.bin from it and
+# prints the transfer size against the full image.
+#
+# Patch layout, little endian: a header with magic "TBD1", source size, target
+# size and the SHA-256 of both images, followed by one zlib stream of records
+#   u32 diff length, u32 extra length, i32 seek,
+#   diff bytes (added to the source bytes modulo 256), extra bytes,
+# after which the source position moves by seek (bsdiff without its three
+# separate bzip2 streams, so the device can apply it in a single pass).
+
+import argparse
+import hashlib
+import struct
+import sys
+import time
+import zlib
+
+MAGIC = b"TBD1"
+HEADER = struct.Struct("<4sII32s32s")
+CONTROL = struct.Struct("<IIi")
+# Must not exceed DELTA_DICTIONARY_SIZE in Espressif_Delta_Updater.cpp
+WINDOW_BITS = 12
+
+KEY = 16             # Shortest exact match that starts a diff region
+STEP = 4             # Source offsets indexed, every STEP bytes
+MAX_CANDIDATES = 8   # Source offsets kept per key, padding repeats endlessly
+CUTOFF = 32          # Mismatch surplus that ends the approximate extension
+
+
+def build_index(old):
+    index = {}
+    for pos in range(0, len(old) - KEY + 1, STEP):
+        key = old[pos:pos + KEY]
+        slot = index.get(key)
+        if slot is None:
+            index[key] = [pos]
+        elif len(slot) < MAX_CANDIDATES:
+            slot.append(pos)
+    return index
+
+
+def common_length(old, o, new, n, limit):
+    length = 0
+    while length < limit:
+        step = min(64, limit - length)
+        if old[o + length:o + length + step] == new[n + length:n + length + step]:
+            length += step
+            continue
+        while old[o + length] == new[n + length]:
+            length += 1
+        break
+    return length
+
+
+def extend(old, o, new, n, limit, direction):
+    # Longest run along this alignment where matches outnumber mismatches, the
+    # mismatches are what changed addresses and constants leave in moved code
+    score = best = best_length = 0
+    length = 0
+    while length < limit:
+        if direction > 0:
+            equal = old[o + length] == new[n + length]
+        else:
+            equal = old[o - length - 1] == new[n - length - 1]
+        length += 1
+        if equal:
+            score += 1
+            if score > best:
+                best, best_length = score, length
+        else:
+            score -= 1
+            if score < best - CUTOFF:
+                break
+    return best_length
+
+
+def find_regions(old, new):
+    # Regions of new that are diffed against old, as (new start, new end, old start)
+    index = build_index(old)
+    regions = []
+    covered = 0
+    delta = 0
+    n = 0
+    while n + KEY <= len(new):
+        best_o, best_length = -1, KEY - 1
+        o = n + delta
+        if 0 <= o < len(old):
+            length = common_length(old, o, new, n, min(len(old) - o, len(new) - n))
+            if length > best_length:
+                best_o, best_length = o, length
+        for o in index.get(new[n:n + KEY], ()):
+            length = common_length(old, o, new, n, min(len(old) - o, len(new) - n))
+            if length > best_length:
+                best_o, best_length = o, length
+        if best_o < 0:
+            n += 1
+            continue
+
+        back = extend(old, best_o, new, n, min(n - covered, best_o), -1)
+        end = n + best_length
+        end += extend(old, best_o + best_length, new, end, min(len(old) - best_o - best_length, len(new) - end), 1)
+        start, delta = n - back, best_o - n
+        if regions and regions[-1][1] == start and regions[-1][2] - regions[-1][0] == delta:
+            start = regions.pop()[0]
+        regions.append((start, end, start + delta))
+        covered = n = end
+    return regions
+
+
+def diff(old, new):
+    regions = find_regions(old, new)
+    # Records start reading the source at offset 0, a leading empty diff seeks to the first region
+    if not regions or regions[0][0] > 0 or regions[0][2] > 0:
+        regions.insert(0, (0, 0, 0))
+    body = bytearray()
+    for i, (start, end, o) in enumerate(regions):
+        extra_end = regions[i + 1][0] if i + 1 < len(regions) else len(new)
+        next_o = regions[i + 1][2] if i + 1 < len(regions) else o + end - start
+        body += CONTROL.pack(end - start, extra_end - end, next_o - (o + end - start))
+        body += bytes((a - b) & 0xFF for a, b in zip(new[start:end], old[o:o + end - start]))
+        body += new[end:extra_end]
+
+    compressor = zlib.compressobj(9, zlib.DEFLATED, WINDOW_BITS, 9)
+    header = HEADER.pack(MAGIC, len(old), len(new), hashlib.sha256(old).digest(), hashlib.sha256(new).digest())
+    return header + compressor.compress(bytes(body)) + compressor.flush(), len(regions)
+
+
+def apply(old, patch):
+    magic, source_size, target_size, source_hash, target_hash = HEADER.unpack_from(patch)
+    if magic != MAGIC:
+        raise ValueError("not a delta patch")
+    if source_size != len(old) or hashlib.sha256(old).digest() != source_hash:
+        raise ValueError("patch was built for a different source image")
+
+    body = zlib.decompress(patch[HEADER.size:], WINDOW_BITS)
+    new = bytearray()
+    pos = 0
+    o = 0
+    while pos < len(body):
+        diff_length, extra_length, seek = CONTROL.unpack_from(body, pos)
+        pos += CONTROL.size
+        if o + diff_length > len(old) or len(new) + diff_length + extra_length > target_size:
+            raise ValueError("record at %d is out of bounds" % (pos - CONTROL.size))
+        new += bytes((a + b) & 0xFF for a, b in zip(body[pos:pos + diff_length], old[o:o + diff_length]))
+        pos += diff_length
+        new += body[pos:pos + extra_length]
+        pos += extra_length
+        o += diff_length + seek
+    if len(new) != target_size or hashlib.sha256(new).digest() != target_hash:
+        raise ValueError("reconstructed image does not match the target hash")
+    return bytes(new)
+
+
+def read(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def write(path, data):
+    with open(path, "wb") as f:
+        f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build and apply delta OTA patches")
+    commands = parser.add_subparsers(dest="command", required=True)
+    for name in ("diff", "check"):
+        command = commands.add_parser(name)
+        command.add_argument("old", help="image running on the devices")
+        command.add_argument("new", help="image to update to")
+        if name == "diff":
+            command.add_argument("-o", "--output", required=True, help="patch file")
+    command = commands.add_parser("apply")
+    command.add_argument("old", help="image the patch was built for")
+    command.add_argument("patch")
+    command.add_argument("-o", "--output", required=True, help="reconstructed image")
+    args = parser.parse_args()
+
+    if args.command == "apply":
+        write(args.output, apply(read(args.old), read(args.patch)))
+        return
+
+    old, new = read(args.old), read(args.new)
+    started = time.time()
+    patch, records = diff(old, new)
+    elapsed = time.time() - started
+    if args.command == "diff":
+        write(args.output, patch)
+    elif apply(old, patch) != new:
+        sys.exit("reconstruction failed")
+    full = max(len(zlib.compress(new, 9)), 1)
+    print("%s: %d B image, %d B deflated, %d B patch (%d records, %.1f%% of the image, %.1f%% of deflated) in %.1f s"
+          % (args.new, len(new), full, len(patch), records, 100.0 * len(patch) / max(len(new), 1), 100.0 * len(patch) / full, elapsed),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+# Decodes the LittleFS time-series store (src/ts_store.cpp) to CSV.
+#
+#   python tools/ts_export.py http://<device-ip> -o history.csv
+#   python tools/ts_export.py path/to/ts/ --from 1700000000 --to 1700086400
+#
+# A URL is read through /api/ts/files and /ts/<segment>; a directory is a copy
+# of /ts pulled off the filesystem image. Block layout and bit codes are
+# documented in include/ts_store.h.
+
+import argparse
+import json
+import os
+import struct
+import sys
+import urllib.request
+
+BLOCK_SIZE = 512
+BLOCK_MAGIC = 0x5354
+HEADER = struct.Struct("<HBBHHII")  # TsBlockHeader_t
+INDEX = struct.Struct("<II")        # TsIndexEntry_t
+
+
+class BitReader:
+    def __init__(self, data, bits):
+        self.data = data
+        self.bits = bits
+        self.pos = 0
+
+    def read(self, count):
+        value = 0
+        for _ in range(count):
+            if self.pos >= self.bits:
+                raise ValueError("bitstream overrun")
+            bit = (self.data[self.pos >> 3] >> (7 - (self.pos & 7))) & 1
+            value = (value << 1) | bit
+            self.pos += 1
+        return value
+
+    def prefix(self, limit):
+        # Number of leading 1 bits, stopping at the first 0 or after `limit`
+        ones = 0
+        while ones < limit and self.read(1):
+            ones += 1
+        return ones
+
+
+def to_float(bits):
+    return struct.unpack("<f", struct.pack("<I", bits))[0]
+
+
+def signed32(value):
+    return value - (1 << 32) if value & 0x80000000 else value
+
+
+def decode_block(block):
+    magic, version, channels, count, bits, first, last = HEADER.unpack_from(block)
+    if magic != BLOCK_MAGIC or version != 1:
+        raise ValueError("bad block header")
+    r = BitReader(block[HEADER.size:], bits)
+
+    prev = [r.read(32) for _ in range(channels)]
+    lead = [None] * channels
+    trail = [0] * channels
+    t, delta = first, 0
+    yield t, [to_float(v) for v in prev]
+
+    for _ in range(count - 1):
+        kind = r.prefix(4)
+        if kind == 0:
+            dod = 0
+        elif kind == 1:
+            dod = r.read(7) - 63
+        elif kind == 2:
+            dod = r.read(9) - 255
+        elif kind == 3:
+            dod = r.read(12) - 2047
+        else:
+            dod = signed32(r.read(32))
+        delta += dod
+        t = (t + delta) & 0xFFFFFFFF
+
+        for ch in range(channels):
+            if r.read(1) == 0:
+                continue
+            if r.read(1) == 0:
+                length = 32 - lead[ch] - trail[ch]
+                prev[ch] ^= r.read(length) << trail[ch]
+            else:
+                lead[ch] = r.read(5)
+                length = r.read(5) + 1
+                trail[ch] = 32 - lead[ch] - length
+                prev[ch] ^= r.read(length) << trail[ch]
+        yield t, [to_float(v) for v in prev]
+
+    if t != last:
+        raise ValueError("decoded end time %d != header %d" % (t, last))
+
+
+class DirSource:
+    def __init__(self, path):
+        self.path = path
+
+    def names(self):
+        return sorted(os.listdir(self.path))
+
+    def read(self, name):
+        with open(os.path.join(self.path, name), "rb") as f:
+            return f.read()
+
+
+class HttpSource:
+    def __init__(self, url):
+        self.url = url.rstrip("/")
+
+    def names(self):
+        with urllib.request.urlopen(self.url + "/api/ts/files") as resp:
+            listing = json.load(resp)
+        return sorted(f["name"] for f in listing["files"])
+
+    def read(self, name):
+        with urllib.request.urlopen("%s/ts/%s" % (self.url, name)) as resp:
+            return resp.read()
+
+
+def export(source, t_from, t_to, out):
+    names = source.names()
+    rows = blocks = skipped = 0
+    out.write("time,temp,humi\n")
+    for name in names:
+        if not name.endswith(".tsd"):
+            continue
+        index_name = name[:-4] + ".tsi"
+        index = source.read(index_name) if index_name in names else b""
+        entries = [INDEX.unpack_from(index, i) for i in range(0, len(index) - INDEX.size + 1, INDEX.size)]
+        # Seek with the index: only fetch segments overlapping the range
+        if entries and (entries[-1][1] < t_from or entries[0][0] >= t_to):
+            continue
+        data = source.read(name)
+        for b in range(len(data) // BLOCK_SIZE):
+            if b < len(entries) and (entries[b][1] < t_from or entries[b][0] >= t_to):
+                continue
+            try:
+                for t, values in decode_block(data[b * BLOCK_SIZE:(b + 1) * BLOCK_SIZE]):
+                    if t_from <= t < t_to:
+                        out.write("%d,%.2f,%.2f\n" % (t, values[0], values[1]))
+                        rows += 1
+                blocks += 1
+            except ValueError as e:
+                skipped += 1
+                print("%s block %d: %s" % (name, b, e), file=sys.stderr)
+    print("%d samples from %d blocks (%d skipped)" % (rows, blocks, skipped), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Export the device time-series store to CSV")
+    parser.add_argument("source", help="device URL (http://...) or a local copy of /ts")
+    parser.add_argument("--from", dest="t_from", type=int, default=0)
+    parser.add_argument("--to", dest="t_to", type=int, default=0xFFFFFFFF)
+    parser.add_argument("-o", "--output", help="CSV file (default stdout)")
+    args = parser.parse_args()
+
+    source = HttpSource(args.source) if args.source.startswith("http") else DirSource(args.source)
+    out = open(args.output, "w") if args.output else sys.stdout
+    try:
+        export(source, args.t_from, args.t_to, out)
+    finally:
+        if args.output:
+            out.close()
+
+
+if __name__ == "__main__":
+    main()